@@ -0,0 +1,306 @@
+#include "bootstrap.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include <time.h>
+#ifdef OMP
+#include <omp.h>
+#endif
+
+#define ZERO 1.e-10
+#define NBIN 4096
+#define NSIGMA 8.
+
+/*------------------------------------------------------------------------------
+ * Constructor of Bootstrap, to propagate the noise of the stresses onto the
+ * elastic constants and the derived moduli by Monte Carlo resampling
+ *------------------------------------------------------------------------------ */
+Bootstrap::Bootstrap(Elastic *elas)
+{
+  memory = new Memory();
+  elastic = elas;
+  sigma_pm = sigma_sym = 0.;
+  npm = nsym = 0;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, free memory
+ *------------------------------------------------------------------------------ */
+Bootstrap::~Bootstrap()
+{
+  delete memory;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to estimate the noise (kB) of each stress component. With independent
+ * noise s on every stress, one has
+ *   2*p0 - p+ - p-           : var = 6 s^2
+ *   a_ij - a_ji, i != j      : var = s^2/(2 eps_j^2) + s^2/(2 eps_i^2)
+ * where a_ij is the unsymmetrized central difference. The first one contains
+ * the curvature of the stress-strain curve as well, so the estimate is rather
+ * on the conservative side. Both are pooled to give s.
+ *------------------------------------------------------------------------------ */
+double Bootstrap::noise()
+{
+  double (*st)[6] = elastic->stress;
+  double *eps = elastic->eps;
+
+  double s2pm = 0.;
+  npm = 0;
+  if (elastic->have[0]){
+    for (int j = 0; j < 6; ++j)
+    for (int i = 0; i < 6; ++i){
+      double d = 2.*st[0][i] - st[2*j+1][i] - st[2*j+2][i];
+      s2pm += d*d/6.;
+      ++npm;
+    }
+  }
+
+  double a[6][6];
+  for (int j = 0; j < 6; ++j)
+  for (int i = 0; i < 6; ++i) a[i][j] = (st[2*j+2][i] - st[2*j+1][i]) * 0.5/eps[j+1];
+
+  double s2sym = 0.;
+  nsym = 0;
+  for (int i = 0; i < 6; ++i)
+  for (int j = i+1; j < 6; ++j){
+    double d = a[i][j] - a[j][i];
+    s2sym += d*d/(0.5/(eps[j+1]*eps[j+1]) + 0.5/(eps[i+1]*eps[i+1]));
+    ++nsym;
+  }
+
+  sigma_pm  = npm  ? sqrt(s2pm/double(npm))   : 0.;
+  sigma_sym = nsym ? sqrt(s2sym/double(nsym)) : 0.;
+
+return sqrt((s2pm + s2sym)/double(npm + nsym));
+}
+
+/*------------------------------------------------------------------------------
+ * Method to do the resampling: each of the nsample resamples perturbs all the
+ * stresses by Gaussian noise of width sig (kB), then goes through the tensor
+ * evaluation, inversion and all derived moduli. Each resample has its own
+ * random stream seeded by its index, so that the result is independent of the
+ * number of threads; the percentiles are obtained from histograms built in a
+ * second pass over the same resamples, so the memory needed stays constant.
+ *------------------------------------------------------------------------------ */
+void Bootstrap::run(int nsample, double sig, unsigned long seed, const char *fname)
+{
+  double est = noise();
+  if (sig < ZERO) sig = est;
+  if (nsample < 2) nsample = 2;
+
+#ifdef OMP
+  double t0 = omp_get_wtime();
+#else
+  double t0 = double(clock())/double(CLOCKS_PER_SEC);
+#endif
+
+  // nominal values
+  double q0[NQUANT];
+  sample(seed, 0., q0);
+
+  // first pass: mean and standard deviation
+  double sum[NQUANT], sum2[NQUANT];
+  for (int iq = 0; iq < NQUANT; ++iq) sum[iq] = sum2[iq] = 0.;
+  int nfail = 0;
+
+#ifdef OMP
+  #pragma omp parallel default(shared)
+#endif
+  {
+    double q[NQUANT], ls[NQUANT], ls2[NQUANT];
+    for (int iq = 0; iq < NQUANT; ++iq) ls[iq] = ls2[iq] = 0.;
+    int lfail = 0;
+#ifdef OMP
+    #pragma omp for schedule(static)
+#endif
+    for (int i = 0; i < nsample; ++i){
+      if (sample(seed + (unsigned long)(i+1), sig, q)){ ++lfail; continue; }
+      for (int iq = 0; iq < NQUANT; ++iq){ ls[iq] += q[iq]; ls2[iq] += q[iq]*q[iq]; }
+    }
+#ifdef OMP
+    #pragma omp critical
+#endif
+    {
+      for (int iq = 0; iq < NQUANT; ++iq){ sum[iq] += ls[iq]; sum2[iq] += ls2[iq]; }
+      nfail += lfail;
+    }
+  }
+  int nok = nsample - nfail;
+  if (nok < 2){
+    printf("\nERROR: all resamples lead to singular elastic constant matrix!\n");
+    return;
+  }
+
+  double mean[NQUANT], std[NQUANT], lo[NQUANT], dq[NQUANT];
+  for (int iq = 0; iq < NQUANT; ++iq){
+    mean[iq] = sum[iq]/double(nok);
+    double var = (sum2[iq] - sum[iq]*mean[iq])/double(nok - 1);
+    std[iq] = var > 0. ? sqrt(var) : 0.;
+    lo[iq] = mean[iq] - NSIGMA*std[iq];
+    dq[iq] = 2.*NSIGMA*std[iq]/double(NBIN);
+  }
+
+  // second pass: histograms of the same resamples, bins 0 and NBIN+1 collect the outliers
+  bigint **hist;
+  memory->create(hist, NQUANT, NBIN+2, "hist");
+  for (int iq = 0; iq < NQUANT; ++iq)
+  for (int ib = 0; ib < NBIN+2; ++ib) hist[iq][ib] = 0;
+
+#ifdef OMP
+  #pragma omp parallel default(shared)
+#endif
+  {
+    double q[NQUANT];
+    bigint **lh;
+    memory->create(lh, NQUANT, NBIN+2, "lh");
+    for (int iq = 0; iq < NQUANT; ++iq)
+    for (int ib = 0; ib < NBIN+2; ++ib) lh[iq][ib] = 0;
+#ifdef OMP
+    #pragma omp for schedule(static)
+#endif
+    for (int i = 0; i < nsample; ++i){
+      if (sample(seed + (unsigned long)(i+1), sig, q)) continue;
+      for (int iq = 0; iq < NQUANT; ++iq){
+        int ib = 0;
+        if (dq[iq] > 0.){
+          double x = (q[iq] - lo[iq])/dq[iq];
+          ib = x < 0. ? 0 : (x >= double(NBIN) ? NBIN+1 : int(x)+1);
+        }
+        ++lh[iq][ib];
+      }
+    }
+#ifdef OMP
+    #pragma omp critical
+#endif
+    {
+      for (int iq = 0; iq < NQUANT; ++iq)
+      for (int ib = 0; ib < NBIN+2; ++ib) hist[iq][ib] += lh[iq][ib];
+    }
+    memory->destroy(lh);
+  }
+
+  // percentiles from the cumulative histograms
+  const int np = 3;
+  double frac[np] = {0.025, 0.5, 0.975};
+  double pct[NQUANT][np];
+  for (int iq = 0; iq < NQUANT; ++iq){
+    for (int ip = 0; ip < np; ++ip){
+      double target = frac[ip] * double(nok);
+      if (dq[iq] <= 0.){ pct[iq][ip] = mean[iq]; continue; }
+
+      bigint cum = 0;
+      pct[iq][ip] = lo[iq] + double(NBIN) * dq[iq];
+      for (int ib = 0; ib <= NBIN+1; ++ib){
+        if (double(cum + hist[iq][ib]) >= target){
+          if (ib == 0) pct[iq][ip] = lo[iq];
+          else if (ib <= NBIN){
+            double f = (target - double(cum))/double(hist[iq][ib]);
+            pct[iq][ip] = lo[iq] + (double(ib-1) + f) * dq[iq];
+          }
+          break;
+        }
+        cum += hist[iq][ib];
+      }
+    }
+  }
+  memory->destroy(hist);
+
+#ifdef OMP
+  double twall = omp_get_wtime() - t0;
+#else
+  double twall = double(clock())/double(CLOCKS_PER_SEC) - t0;
+#endif
+
+  // labels
+  char name[NQUANT][16];
+  int iq = 0;
+  for (int i = 0; i < 6; ++i)
+  for (int j = i; j < 6; ++j) sprintf(name[iq++], "C%d%d", i+1, j+1);
+  for (int i = 0; i < NMOD; ++i) strcpy(name[iq++], Elastic::modname[i]);
+
+  FILE *fp[2] = {stdout, NULL};
+  if (fname){
+    fp[1] = fopen(fname, "w");
+    if (fp[1] == NULL) printf("\nERROR: cannot open file %s for writting!\n", fname);
+  }
+  for (int k = 0; k < 2; ++k){
+    if (fp[k] == NULL) continue;
+    fprintf(fp[k], "\n#"); for (int i = 0; i < 20; ++i) fprintf(fp[k], "====");
+    fprintf(fp[k], "\n# Stress noise from the +/- asymmetry : %g kB (%d samples)\n", sigma_pm, npm);
+    fprintf(fp[k], "# Stress noise from the Cij/Cji mismatch: %g kB (%d samples)\n", sigma_sym, nsym);
+    fprintf(fp[k], "# Pooled estimate: %g kB; noise used: %g kB\n", est, sig);
+    fprintf(fp[k], "# Resamples: %d, of which %d singular; time used: %g seconds\n", nsample, nfail, twall);
+    fprintf(fp[k], "# Moduli in GPa; the 95%% confidence interval is given by [2.5%%, 97.5%%]\n");
+    fprintf(fp[k], "# %-8s %12s %12s %12s %12s %12s %12s\n", "quantity", "nominal", "mean", "std", "2.5%", "median", "97.5%");
+    for (int iq = 0; iq < NQUANT; ++iq)
+      fprintf(fp[k], "  %-8s %12.6f %12.6f %12.6f %12.6f %12.6f %12.6f\n", name[iq], q0[iq], mean[iq], std[iq],
+        pct[iq][0], pct[iq][1], pct[iq][2]);
+    fprintf(fp[k], "#"); for (int i = 0; i < 20; ++i) fprintf(fp[k], "====");
+    fprintf(fp[k], "\n");
+  }
+  if (fp[1]){
+    fclose(fp[1]);
+    printf("Uncertainty info written to file: %s\n", fname);
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to evaluate one resample: the 21 independent Cij followed by the
+ * moduli; returns 1 if the resampled C is singular.
+ *------------------------------------------------------------------------------ */
+int Bootstrap::sample(unsigned long state, double sig, double *q)
+{
+  double st[NSTATE][6], c[6][6], s[6][6];
+  gaussian(state, &st[0][0], NSTATE*6);
+  for (int i = 0; i < NSTATE; ++i)
+  for (int j = 0; j < 6; ++j) st[i][j] = elastic->stress[i][j] + sig * st[i][j];
+
+  elastic->tensor(st, c);
+  if (elastic->invert(c, s)) return 1;
+
+  int iq = 0;
+  for (int i = 0; i < 6; ++i)
+  for (int j = i; j < 6; ++j) q[iq++] = c[i][j];
+  elastic->moduli(c, s, q + iq);
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to generate n standard normal deviates by Box-Muller, from the
+ * splitmix64 generator whose state is seeded by the resample index
+ *------------------------------------------------------------------------------ */
+void Bootstrap::gaussian(unsigned long &state, double *x, int n)
+{
+  // scramble the seed so that the streams of neighboring resamples do not overlap
+  uint64_t z = uint64_t(state) + 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  for (int i = 0; i < n; i += 2){
+    double u[2];
+    for (int k = 0; k < 2; ++k){
+      z += 0x9E3779B97F4A7C15ULL;
+      uint64_t r = z;
+      r = (r ^ (r >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      r = (r ^ (r >> 27)) * 0x94D049BB133111EBULL;
+      r ^= r >> 31;
+      u[k] = (double(r >> 11) + 0.5) * (1./9007199254740992.);
+    }
+    double rr = sqrt(-2.*log(u[0])), th = 2.*M_PI*u[1];
+    x[i] = rr * cos(th);
+    if (i+1 < n) x[i+1] = rr * sin(th);
+  }
+  state = (unsigned long)z;
+
+return;
+}
+
+/*----------------------------------------------------------------------------*/
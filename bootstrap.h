@@ -0,0 +1,29 @@
+#ifndef BOOTSTRAP_H
+#define BOOTSTRAP_H
+
+#include "memory.h"
+#include "elastic.h"
+
+#define NQUANT (21+NMOD)
+
+using namespace std;
+
+class Bootstrap {
+public:
+  Bootstrap(Elastic *);
+  ~Bootstrap();
+
+  double noise();                                 // estimate the stress noise (kB)
+  void run(int, double, unsigned long, const char *);
+
+private:
+  Memory *memory;
+  Elastic *elastic;
+
+  double sigma_pm, sigma_sym;                     // noise estimated from the +/- asymmetry and Cij/Cji mismatch
+  int npm, nsym;
+
+  int sample(unsigned long, double, double *);
+  void gaussian(unsigned long &, double *, int);
+};
+#endif
@@ -0,0 +1,918 @@
+#include "calculator.h"
+#include "zfile.h"
+#include "ecvasp.h"
+#include "stdlib.h"
+#include "string.h"
+#include "math.h"
+#include <ctype.h>
+#include <time.h>
+#include <sys/resource.h>
+#ifdef OMP
+#include <omp.h>
+#endif
+
+#define ZERO 1.e-10
+#define MAXLINE 1024
+#define SEP " \t\r\n\f"
+#define EV2GPA 160.21766208     // eV/A^3 to GPa
+
+// FIRE relaxation of the ions, with unit masses; forces in eV/A
+#define DT0    0.1
+#define DTMAX  0.3
+#define NMIN   5
+#define FINC   1.1
+#define FDEC   0.5
+#define ALPHA0 0.1
+#define FALPHA 0.99
+#define MAXSTEP 0.1             // largest displacement of an atom per step, in A
+
+static double walltime();
+static int match(const char *, const char *);
+static double slope(const double *, int, int);
+
+/*------------------------------------------------------------------------------
+ * Constructor of Calculator, the energy, forces and stress of a configuration
+ * by interatomic potentials: EAM, Lennard-Jones and Morse, or a sum of them.
+ * Cheap enough to pre-screen the strain workflow, and to stand in for VASP.
+ *------------------------------------------------------------------------------ */
+Calculator::Calculator()
+{
+  memory = new Memory();
+  rcut = 0.;
+  nstep = 0;
+  npair = 0;
+  neam = nrho = nr = 0;
+  ename = NULL;
+  drho = dr = rceam = 0.;
+  frho = rhor = z2r = NULL;
+  ntype = 0;
+  emap = NULL;
+  pmap = NULL;
+  natom = nmax = nneigh = nnmax = 0;
+  type = first = num = jlist = NULL;
+  dx = vatom = NULL;
+  rho = fp = eatom = NULL;
+  vol = 0.;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, free memory
+ *------------------------------------------------------------------------------ */
+Calculator::~Calculator()
+{
+  if (ename) delete []ename;
+  if (frho) memory->destroy(frho);
+  if (rhor) memory->destroy(rhor);
+  if (z2r) memory->destroy(z2r);
+  if (emap) memory->destroy(emap);
+  if (pmap) memory->destroy(pmap);
+  if (type) memory->destroy(type);
+  if (first) memory->destroy(first);
+  if (num) memory->destroy(num);
+  if (jlist) memory->destroy(jlist);
+  if (dx) memory->destroy(dx);
+  if (vatom) memory->destroy(vatom);
+  if (rho) memory->destroy(rho);
+  if (fp) memory->destroy(fp);
+  if (eatom) memory->destroy(eatom);
+  delete memory;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read the potential from file, one term per line, '#' to comment:
+ *   lj    A B epsilon sigma rc   # Lennard-Jones (eV, A), shifted to zero at rc
+ *   morse A B D0 alpha r0 rc     # D0[exp(-2a(r-r0)) - 2exp(-a(r-r0))], shifted
+ *   eam   file                   # setfl file of LAMMPS eam/alloy
+ * A and B are element names as in the POSCAR, or the type indices 1, 2, ...
+ * if it has none; '*' matches any. The pair terms are added on top of the EAM,
+ * and a later line overrides an earlier one for the same pair.
+ *------------------------------------------------------------------------------ */
+int Calculator::read(const char *fname)
+{
+  ZFile zf;
+  FILE *fpot = zf.open(fname);
+  if (fpot == NULL){
+    printf("\nFile %s not found!\n", fname);
+    return 1;
+  }
+
+  char str[MAXLINE], *save;
+  int nline = 0, flag = 0;
+  while (flag == 0 && fgets(str, MAXLINE, fpot)){
+    ++nline;
+    char *ptr = strchr(str, '#');
+    if (ptr) *ptr = '\0';
+    char *key = strtok_r(str, SEP, &save);
+    if (key == NULL) continue;
+
+    if (strcmp(key, "lj") == 0 || strcmp(key, "morse") == 0){
+      int style = strcmp(key, "lj") ? 1 : 0;
+      int nval = style ? 4 : 3;
+      if (npair >= MAXPAIR){
+        printf("\nERROR: too many pair terms in %s!\n", fname);
+        flag = 1; break;
+      }
+      char *name[2];
+      double val[4];
+      int n = 0;
+      for (int i = 0; i < 2; ++i) if ((name[i] = strtok_r(NULL, SEP, &save))) ++n;
+      for (int i = 0; i < nval; ++i) if ((ptr = strtok_r(NULL, SEP, &save))){ val[i] = atof(ptr); ++n; }
+      if (n < nval+2 || val[nval-1] <= 0.){
+        printf("\nERROR: wrong %s term on line %d of %s!\n", key, nline, fname);
+        flag = 2; break;
+      }
+      for (int i = 0; i < 2; ++i){
+        strncpy(pname[npair][i], name[i], 15);
+        pname[npair][i][15] = '\0';
+      }
+      pstyle[npair] = style;
+      prc[npair] = val[nval-1];
+      for (int i = 0; i < nval-1; ++i) pcoef[npair][i] = val[i];
+
+      // energy at the cutoff, subtracted so that the energy is continuous
+      double rc = prc[npair], *c = pcoef[npair];
+      if (style == 0){
+        double sr6 = pow(c[1]/rc, 6.);
+        c[3] = 4.*c[0]*sr6*(sr6 - 1.);
+      } else {
+        double ex = exp(-c[1]*(rc - c[2]));
+        c[3] = c[0]*ex*(ex - 2.);
+      }
+      ++npair;
+
+    } else if (strcmp(key, "eam") == 0){
+      if ((ptr = strtok_r(NULL, SEP, &save)) == NULL){
+        printf("\nERROR: no file given to eam on line %d of %s!\n", nline, fname);
+        flag = 2; break;
+      }
+      // relative to the folder of the potential file
+      char file[MAXLINE];
+      const char *slash = strrchr(fname, '/');
+      if (ptr[0] != '/' && slash) snprintf(file, MAXLINE, "%.*s/%s", int(slash-fname), fname, ptr);
+      else snprintf(file, MAXLINE, "%s", ptr);
+      flag = readeam(file);
+
+    } else {
+      printf("\nERROR: unknown term %s on line %d of %s!\n", key, nline, fname);
+      flag = 2;
+    }
+  }
+  if (zf.close()) return 4;
+  if (flag) return flag;
+
+  if (npair == 0 && neam == 0){
+    printf("\nERROR: no potential found in %s!\n", fname);
+    return 3;
+  }
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read the tabulated EAM from a setfl file: three comment lines;
+ * the number of elements and their names; Nrho drho Nr dr cutoff; then for
+ * each element a line of its atomic number, mass, lattice constant and type,
+ * followed by F(rho) and rho(r); then r*phi(r) of each pair i >= j. Numbers
+ * are read regardless of how they are split over lines.
+ *------------------------------------------------------------------------------ */
+int Calculator::readeam(const char *fname)
+{
+  if (neam){
+    printf("\nERROR: only one EAM file is allowed!\n");
+    return 2;
+  }
+  ZFile zf;
+  FILE *fin = zf.open(fname);
+  if (fin == NULL){
+    printf("\nFile %s not found!\n", fname);
+    return 1;
+  }
+
+  char str[MAXLINE], *save;
+  int flag = 0;
+  for (int i = 0; i < 4 && flag == 0; ++i) if (fgets(str, MAXLINE, fin) == NULL) flag = 1;
+  char *ptr = flag ? NULL : strtok_r(str, SEP, &save);
+  int n = ptr ? atoi(ptr) : 0;
+  if (n < 1) flag = 1;
+  else {
+    ename = new char [n][16];
+    for (int i = 0; i < n && flag == 0; ++i){
+      if ((ptr = strtok_r(NULL, SEP, &save)) == NULL) flag = 1;
+      else {
+        strncpy(ename[i], ptr, 15);
+        ename[i][15] = '\0';
+      }
+    }
+  }
+  if (flag == 0 && (fgets(str, MAXLINE, fin) == NULL ||
+    sscanf(str, "%d %lg %d %lg %lg", &nrho, &drho, &nr, &dr, &rceam) != 5 || nrho < 2 || nr < 2)) flag = 1;
+
+  if (flag == 0){
+    memory->create(frho, n, nrho, "frho");
+    memory->create(rhor, n, nr, "rhor");
+    memory->create(z2r, n*(n+1)/2, nr, "z2r");
+
+    for (int i = 0; i < n && flag == 0; ++i){
+      // the header of each element, after the rest of the last line of numbers
+      int len = 0;
+      while (len == 0 && fgets(str, MAXLINE, fin)) len = strspn(str, SEP) < strlen(str);
+      if (len == 0) flag = 1;
+      for (int k = 0; k < nrho && flag == 0; ++k) if (fscanf(fin, "%lg", &frho[i][k]) != 1) flag = 1;
+      for (int k = 0; k < nr && flag == 0; ++k) if (fscanf(fin, "%lg", &rhor[i][k]) != 1) flag = 1;
+    }
+    for (int i = 0; i < n*(n+1)/2 && flag == 0; ++i)
+    for (int k = 0; k < nr && flag == 0; ++k) if (fscanf(fin, "%lg", &z2r[i][k]) != 1) flag = 1;
+  }
+  if (zf.close()) return 3;
+
+  if (flag){
+    printf("\nERROR: wrong or incomplete setfl file %s!\n", fname);
+    return 2;
+  }
+  neam = n;
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to map the types of s onto the elements of the EAM and the pair
+ * terms, by the element names of s, or by the type indices if it has none;
+ * the cutoff is that of the longest term in use.
+ *------------------------------------------------------------------------------ */
+int Calculator::setup(const Structure *s)
+{
+  if (emap) memory->destroy(emap);
+  if (pmap) memory->destroy(pmap);
+  ntype = s->ntype;
+  memory->create(emap, ntype, "emap");
+  memory->create(pmap, ntype, ntype, "pmap");
+
+  char (*name)[16] = new char [ntype][16];
+  char *line = NULL, *save, *ptr = NULL;
+  if (s->element){
+    line = new char [strlen(s->element)+1];
+    strcpy(line, s->element);
+    ptr = strtok_r(line, SEP, &save);
+  }
+  for (int i = 0; i < ntype; ++i){
+    if (ptr){
+      strncpy(name[i], ptr, 15);
+      name[i][15] = '\0';
+      ptr = strtok_r(NULL, SEP, &save);
+    } else sprintf(name[i], "%d", i+1);
+  }
+  if (line) delete []line;
+
+  rcut = 0.;
+  int nused = 0;
+  for (int i = 0; i < ntype; ++i){
+    emap[i] = -1;
+    for (int k = 0; k < neam; ++k) if (strcmp(name[i], ename[k]) == 0) emap[i] = k;
+    if (emap[i] >= 0){
+      rcut = rceam > rcut ? rceam : rcut;
+      ++nused;
+    }
+  }
+  for (int i = 0; i < ntype; ++i)
+  for (int j = 0; j < ntype; ++j){
+    pmap[i][j] = -1;
+    for (int k = 0; k < npair; ++k){
+      if ((match(pname[k][0], name[i]) && match(pname[k][1], name[j])) ||
+          (match(pname[k][0], name[j]) && match(pname[k][1], name[i]))) pmap[i][j] = k;
+    }
+    if (pmap[i][j] >= 0){
+      rcut = prc[pmap[i][j]] > rcut ? prc[pmap[i][j]] : rcut;
+      ++nused;
+    }
+  }
+  for (int i = 0; i < ntype; ++i){
+    int has = emap[i] >= 0;
+    for (int j = 0; j < ntype; ++j) has += pmap[i][j] >= 0;
+    if (has == 0) printf("\nWARNING: no interaction is defined for element %s!\n", name[i]);
+  }
+  delete []name;
+
+  if (nused == 0){
+    printf("\nERROR: no term of the potential matches the elements of the structure!\n");
+    return 1;
+  }
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the Cartesian positions x (A) of s, and its lattice A (A)
+ *------------------------------------------------------------------------------ */
+void Calculator::cart(const Structure *s, double A[3][3], double **x)
+{
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) A[i][j] = s->alat * s->axis[i][j];
+
+  if (x == NULL) return;
+  for (int i = 0; i < s->natom; ++i)
+  for (int j = 0; j < 3; ++j) x[i][j] = s->atpos[i][0]*A[0][j] + s->atpos[i][1]*A[1][j] + s->atpos[i][2]*A[2][j];
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to build the full neighbor lists of s within rcut. The periodic images
+ * needed are generated explicitly, so that cells smaller than the cutoff are
+ * fine, and binned on a grid of the fractional coordinates whose bins are at
+ * least rcut thick; each atom then only looks into the 27 bins around its own.
+ * The lists are counted and then filled, both in parallel over the atoms, into
+ * one compressed array: the neighbors of atom i are first[i] ... + num[i]-1,
+ * with jlist the atom they are an image of and dx their position relative to i.
+ *------------------------------------------------------------------------------ */
+int Calculator::neighbor(const Structure *s)
+{
+  natom = s->natom;
+  if (natom > nmax){
+    nmax = natom;
+    memory->grow(type, nmax, "type");
+    memory->grow(first, nmax, "first");
+    memory->grow(num, nmax, "num");
+    memory->grow(rho, nmax, "rho");
+    memory->grow(fp, nmax, "fp");
+    memory->grow(eatom, nmax, "eatom");
+    if (vatom) memory->destroy(vatom);
+    memory->create(vatom, nmax, 6, "vatom");
+  }
+  int n = 0;
+  for (int ip = 0; ip < s->ntype; ++ip)
+  for (int k = 0; k < s->ntm[ip]; ++k) type[n++] = ip;
+
+  double A[3][3], width[3], w[3], lo[3];
+  int nb[3], nimg[3], nbin[3];
+  cart(s, A, NULL);
+  for (int k = 0; k < 3; ++k){
+    double *a = A[(k+1)%3], *b = A[(k+2)%3], c[3];
+    c[0] = a[1]*b[2] - a[2]*b[1];
+    c[1] = a[2]*b[0] - a[0]*b[2];
+    c[2] = a[0]*b[1] - a[1]*b[0];
+    if (k == 0) vol = fabs(A[0][0]*c[0] + A[0][1]*c[1] + A[0][2]*c[2]);
+    width[k] = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
+  }
+  if (vol < ZERO){
+    printf("\nERROR: the volume of the cell is zero!\n");
+    return 1;
+  }
+  // bins of w in fractional coordinates, one bin of padding on each side; a
+  // single bin thicker than the cell if it is thinner than the cutoff
+  for (int k = 0; k < 3; ++k){
+    width[k] = vol / width[k];
+    nb[k] = int(width[k]/rcut);
+    w[k] = nb[k] > 0 ? 1./double(nb[k]) : rcut/width[k];
+    if (nb[k] < 1) nb[k] = 1;
+    nbin[k] = nb[k] + 2;
+    lo[k] = -w[k];
+    nimg[k] = int(ceil(w[k]*double(nb[k]+1)));
+  }
+
+  // images within the padded cell: count, then store
+  int nghost = 0, *gid = NULL, *gbin = NULL, *self = NULL;
+  double **gx = NULL;
+  memory->create(self, natom, "self");
+  for (int pass = 0; pass < 2; ++pass){
+    if (pass){
+      memory->create(gid, nghost, "gid");
+      memory->create(gbin, nghost, "gbin");
+      memory->create(gx, nghost, 3, "gx");
+      nghost = 0;
+    }
+    for (int i = 0; i < natom; ++i){
+      double f[3];
+      for (int k = 0; k < 3; ++k) f[k] = s->atpos[i][k] - floor(s->atpos[i][k]);
+      for (int n0 = -nimg[0]; n0 <= nimg[0]; ++n0)
+      for (int n1 = -nimg[1]; n1 <= nimg[1]; ++n1)
+      for (int n2 = -nimg[2]; n2 <= nimg[2]; ++n2){
+        double g[3] = {f[0] + n0, f[1] + n1, f[2] + n2};
+        int b[3], in = 1;
+        for (int k = 0; k < 3; ++k){
+          b[k] = int(floor((g[k] - lo[k])/w[k]));
+          in = in && b[k] >= 0 && b[k] < nbin[k];
+        }
+        if (in == 0) continue;
+        if (pass){
+          gid[nghost] = i;
+          gbin[nghost] = (b[0]*nbin[1] + b[1])*nbin[2] + b[2];
+          for (int j = 0; j < 3; ++j) gx[nghost][j] = g[0]*A[0][j] + g[1]*A[1][j] + g[2]*A[2][j];
+          if (n0 == 0 && n1 == 0 && n2 == 0) self[i] = nghost;
+        }
+        ++nghost;
+      }
+    }
+  }
+
+  int ntot = nbin[0]*nbin[1]*nbin[2];
+  int *head, *next;
+  memory->create(head, ntot, "head");
+  memory->create(next, nghost, "next");
+  for (int b = 0; b < ntot; ++b) head[b] = -1;
+  for (int g = nghost-1; g >= 0; --g){
+    next[g] = head[gbin[g]];
+    head[gbin[g]] = g;
+  }
+
+  double rc2 = rcut*rcut;
+  for (int pass = 0; pass < 2; ++pass){
+    if (pass){
+      nneigh = 0;
+      for (int i = 0; i < natom; ++i){
+        first[i] = nneigh;
+        nneigh += num[i];
+      }
+      if (nneigh > nnmax){
+        nnmax = nneigh;
+        if (jlist) memory->destroy(jlist);
+        if (dx) memory->destroy(dx);
+        memory->create(jlist, nnmax, "jlist");
+        memory->create(dx, nnmax, 3, "dx");
+      }
+    }
+
+#ifdef OMP
+    #pragma omp parallel for default(shared) schedule(static)
+#endif
+    for (int i = 0; i < natom; ++i){
+      int gi = self[i], bi = gbin[gi];
+      int b2 = bi % nbin[2], b1 = (bi / nbin[2]) % nbin[1], b0 = bi / (nbin[1]*nbin[2]);
+      double *xi = gx[gi];
+      int m = pass ? first[i] : 0;
+      for (int d0 = -1; d0 <= 1; ++d0)
+      for (int d1 = -1; d1 <= 1; ++d1)
+      for (int d2 = -1; d2 <= 1; ++d2){
+        int b = ((b0+d0)*nbin[1] + b1+d1)*nbin[2] + b2+d2;
+        for (int g = head[b]; g >= 0; g = next[g]){
+          if (g == gi) continue;
+          double d[3] = {gx[g][0]-xi[0], gx[g][1]-xi[1], gx[g][2]-xi[2]};
+          if (d[0]*d[0] + d[1]*d[1] + d[2]*d[2] >= rc2) continue;
+          if (pass){
+            jlist[m] = gid[g];
+            for (int k = 0; k < 3; ++k) dx[m][k] = d[k];
+          }
+          ++m;
+        }
+      }
+      if (pass == 0) num[i] = m;
+    }
+  }
+
+  memory->destroy(head);
+  memory->destroy(next);
+  memory->destroy(self);
+  memory->destroy(gid);
+  memory->destroy(gbin);
+  memory->destroy(gx);
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to compute the energy (eV, returned), the forces f (eV/A, natom x 3)
+ * and the stress sigma (GPa, Voigt order xx yy zz yz xz xy, tension positive)
+ * of s. Each atom is done by a thread over its full neighbor list, with the
+ * EAM in two passes, the densities first; the per-atom energies and virials
+ * are then summed in a fixed order, so that the results do not depend on the
+ * number of threads. For a pair at distance r, with U the energy,
+ *   dU/dr = F'(rho_i) rho_j'(r) + F'(rho_j) rho_i'(r) + phi'(r) + pair'(r),
+ *   sigma_ab = 1/V sum_i 1/2 sum_j dU/dr dx_a dx_b / r.
+ *------------------------------------------------------------------------------ */
+double Calculator::compute(const Structure *s, double **f, double *sigma)
+{
+  if (neighbor(s)) return 0.;
+
+  if (neam){
+#ifdef OMP
+    #pragma omp parallel for default(shared) schedule(static)
+#endif
+    for (int i = 0; i < natom; ++i){
+      rho[i] = fp[i] = eatom[i] = 0.;
+      int ei = emap[type[i]];
+      if (ei < 0) continue;
+      for (int m = first[i]; m < first[i]+num[i]; ++m){
+        int ej = emap[type[jlist[m]]];
+        if (ej < 0) continue;
+        double r = sqrt(dx[m][0]*dx[m][0] + dx[m][1]*dx[m][1] + dx[m][2]*dx[m][2]);
+        if (r >= rceam) continue;
+        double val, der;
+        spline(rhor[ej], nr, dr, r, val, der);
+        rho[i] += val;
+      }
+      spline(frho[ei], nrho, drho, rho[i], eatom[i], fp[i]);
+    }
+  } else for (int i = 0; i < natom; ++i) rho[i] = fp[i] = eatom[i] = 0.;
+
+#ifdef OMP
+  #pragma omp parallel for default(shared) schedule(static)
+#endif
+  for (int i = 0; i < natom; ++i){
+    int ti = type[i], ei = emap[ti];
+    double fi[3] = {0., 0., 0.}, vi[6] = {0., 0., 0., 0., 0., 0.}, ei2 = 0.;
+    for (int m = first[i]; m < first[i]+num[i]; ++m){
+      int j = jlist[m], tj = type[j], ej = emap[tj], k = pmap[ti][tj];
+      double *d = dx[m];
+      double r = sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+      double du = 0.;
+
+      if (k >= 0 && r < prc[k]){
+        double *c = pcoef[k];
+        if (pstyle[k] == 0){
+          double sr6 = pow(c[1]/r, 6.);
+          ei2 += 4.*c[0]*sr6*(sr6 - 1.) - c[3];
+          du += -24.*c[0]*sr6*(2.*sr6 - 1.)/r;
+        } else {
+          double ex = exp(-c[1]*(r - c[2]));
+          ei2 += c[0]*ex*(ex - 2.) - c[3];
+          du += -2.*c[0]*c[1]*ex*(ex - 1.);
+        }
+      }
+
+      if (ei >= 0 && ej >= 0 && r < rceam){
+        double val, rhoi, rhoj, z, dz;
+        spline(rhor[ej], nr, dr, r, val, rhoj);
+        spline(rhor[ei], nr, dr, r, val, rhoi);
+        int a = ei > ej ? ei : ej, b = ei > ej ? ej : ei;
+        spline(z2r[a*(a+1)/2+b], nr, dr, r, z, dz);
+        double phi = z/r;
+        ei2 += phi;
+        du += fp[i]*rhoj + fp[j]*rhoi + (dz - phi)/r;
+      }
+
+      double fpair = du/r;
+      for (int a = 0; a < 3; ++a) fi[a] += fpair*d[a];
+      vi[0] += fpair*d[0]*d[0]; vi[1] += fpair*d[1]*d[1]; vi[2] += fpair*d[2]*d[2];
+      vi[3] += fpair*d[1]*d[2]; vi[4] += fpair*d[0]*d[2]; vi[5] += fpair*d[0]*d[1];
+    }
+    for (int a = 0; a < 3; ++a) f[i][a] = fi[a];
+    for (int a = 0; a < 6; ++a) vatom[i][a] = 0.5*vi[a];
+    eatom[i] += 0.5*ei2;
+  }
+
+  double eng = 0.;
+  for (int a = 0; a < 6; ++a) sigma[a] = 0.;
+  for (int i = 0; i < natom; ++i){
+    eng += eatom[i];
+    for (int a = 0; a < 6; ++a) sigma[a] += vatom[i][a];
+  }
+  for (int a = 0; a < 6; ++a) sigma[a] *= EV2GPA/vol;
+
+return eng;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to evaluate the Hermite cubic through the table f of n values at
+ * spacing h from zero, with the slopes at the knots by finite differences of
+ * fourth order inside and lower orders at the ends, as LAMMPS does; x is
+ * clamped to the table. Gives the value and the derivative at x.
+ *------------------------------------------------------------------------------ */
+void Calculator::spline(double *f, int n, double h, double x, double &val, double &der)
+{
+  double p = x/h;
+  if (p < 0.) p = 0.;
+  if (p > double(n-1)) p = double(n-1);
+  int m = int(p);
+  if (m > n-2) m = n-2;
+  double t = p - double(m), t2 = t*t, t3 = t2*t;
+  double d0 = slope(f, n, m), d1 = slope(f, n, m+1);
+
+  val = (2.*t3 - 3.*t2 + 1.)*f[m] + (t3 - 2.*t2 + t)*d0 + (3.*t2 - 2.*t3)*f[m+1] + (t3 - t2)*d1;
+  der = ((6.*t2 - 6.*t)*f[m] + (3.*t2 - 4.*t + 1.)*d0 + (6.*t - 6.*t2)*f[m+1] + (3.*t2 - 2.*t)*d1)/h;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to relax the ions of s by FIRE, for at most nsw steps, until the
+ * largest force is below -ediffg (eV/A) if ediffg < 0, or the change of the
+ * energy below ediffg (eV) otherwise. Each step goes to out and osz in the
+ * format of OUTCAR and OSZICAR, if not NULL. Returns the number of steps taken.
+ *------------------------------------------------------------------------------ */
+int Calculator::relax(Structure *s, int nsw, double ediffg, FILE *out, FILE *osz)
+{
+  int n = s->natom;
+  double **f, **v, sigma[6], A[3][3], B[3][3];
+  memory->create(f, n, 3, "f");
+  memory->create(v, n, 3, "v");
+  for (int i = 0; i < n; ++i) v[i][0] = v[i][1] = v[i][2] = 0.;
+
+  // inverse of the lattice, to convert Cartesian displacements back
+  cart(s, A, NULL);
+  double det = A[0][0]*(A[1][1]*A[2][2] - A[1][2]*A[2][1]) - A[0][1]*(A[1][0]*A[2][2] - A[1][2]*A[2][0])
+             + A[0][2]*(A[1][0]*A[2][1] - A[1][1]*A[2][0]);
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j)
+    B[j][i] = (A[(i+1)%3][(j+1)%3]*A[(i+2)%3][(j+2)%3] - A[(i+1)%3][(j+2)%3]*A[(i+2)%3][(j+1)%3])/det;
+
+  double dt = DT0, alpha = ALPHA0, eold = 0.;
+  int npos = 0;
+  if (nsw < 1) nsw = 1;
+  for (nstep = 1; ; ++nstep){
+    double eng = compute(s, f, sigma);
+    if (out) outcar(out, s, eng, f, sigma);
+    if (osz){
+      fprintf(osz, "DAV:   1    %.8E   %.5E\n", eng, eng - eold);
+      fprintf(osz, "%4d F= %.8E E0= %.8E  d E =%.6E  mag=     0.0000\n", nstep, eng, eng, nstep > 1 ? eng - eold : eng);
+      fflush(osz);
+    }
+
+    double fmax = 0.;
+    for (int i = 0; i < n; ++i){
+      double f2 = f[i][0]*f[i][0] + f[i][1]*f[i][1] + f[i][2]*f[i][2];
+      fmax = f2 > fmax ? f2 : fmax;
+    }
+    fmax = sqrt(fmax);
+    int done = ediffg < 0. ? fmax < -ediffg : (nstep > 1 && fabs(eng - eold) < ediffg);
+    eold = eng;
+    if (done || nstep >= nsw) break;
+
+    // FIRE: mix the velocities towards the forces while going downhill, stop otherwise
+    double P = 0., vn = 0., fn = 0.;
+    for (int i = 0; i < n; ++i)
+    for (int k = 0; k < 3; ++k){
+      P += f[i][k]*v[i][k];
+      vn += v[i][k]*v[i][k];
+      fn += f[i][k]*f[i][k];
+    }
+    if (P > 0.){
+      double r = fn > ZERO ? sqrt(vn/fn) : 0.;
+      for (int i = 0; i < n; ++i)
+      for (int k = 0; k < 3; ++k) v[i][k] = (1. - alpha)*v[i][k] + alpha*r*f[i][k];
+      if (++npos > NMIN){
+        dt = dt*FINC < DTMAX ? dt*FINC : DTMAX;
+        alpha *= FALPHA;
+      }
+    } else {
+      for (int i = 0; i < n; ++i) v[i][0] = v[i][1] = v[i][2] = 0.;
+      dt *= FDEC;
+      alpha = ALPHA0;
+      npos = 0;
+    }
+
+    for (int i = 0; i < n; ++i){
+      double u[3], un = 0.;
+      for (int k = 0; k < 3; ++k){
+        v[i][k] += dt*f[i][k];
+        u[k] = dt*v[i][k];
+        un += u[k]*u[k];
+      }
+      un = sqrt(un);
+      double scale = un > MAXSTEP ? MAXSTEP/un : 1.;
+      for (int k = 0; k < 3; ++k)
+        s->atpos[i][k] += scale*(u[0]*B[0][k] + u[1]*B[1][k] + u[2]*B[2][k]);
+    }
+  }
+  memory->destroy(f);
+  memory->destroy(v);
+
+return nstep;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to compute C (GPa), unsymmetrized, by central differences of the
+ * stresses of s strained by +/- e[idim] along each Voigt component, with the
+ * same deformation as the script; the ions are relaxed in each state if rlx is
+ * set. asym, if not NULL, gets the largest difference between the one-sided
+ * estimates from the +e and -e states, relative to the largest C.
+ *------------------------------------------------------------------------------ */
+int Calculator::moduli(const Structure *s, const double *e, int rlx, double C[6][6], double *asym)
+{
+  Structure *st = new Structure();
+  double **f, s0[6], sp[6], sn[6];
+  memory->create(f, s->natom, 3, "f");
+  compute(s, f, s0);
+
+  double dmax = 0., cmax = 0.;
+  for (int idim = 1; idim <= 6; ++idim){
+    for (int k = 0; k < 2; ++k){
+      double *sig = k ? sn : sp;
+      s->strain(idim, k ? -e[idim] : e[idim], st);
+      if (rlx) relax(st, NRELAX, FRELAX, NULL, NULL);
+      compute(st, f, sig);
+    }
+    for (int i = 0; i < 6; ++i){
+      C[i][idim-1] = 0.5*(sp[i] - sn[i])/e[idim];
+      double d = fabs((sp[i] - s0[i]) - (s0[i] - sn[i]))/e[idim];
+      dmax = d > dmax ? d : dmax;
+      cmax = fabs(C[i][idim-1]) > cmax ? fabs(C[i][idim-1]) : cmax;
+    }
+  }
+  if (asym) *asym = cmax > ZERO ? dmax/cmax : 0.;
+
+  memory->destroy(f);
+  delete st;
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read IBRION, NSW, ISIF, EDIFFG and POTIM from INCAR, with the
+ * defaults of VASP for those not set; returns 1 if INCAR is not found.
+ *------------------------------------------------------------------------------ */
+int Calculator::incar(const char *fname, int &ibrion, int &nsw, int &isif, double &ediffg, double &potim)
+{
+  nsw = 0; ibrion = isif = -1;
+  ediffg = 1.e-3; potim = 0.015;
+
+  FILE *fin = fopen(fname, "r");
+  if (fin == NULL) return 1;
+
+  char str[MAXLINE], *save, *save2;
+  while (fgets(str, MAXLINE, fin)){
+    str[strcspn(str, "!#")] = '\0';
+    for (char *item = strtok_r(str, ";\n", &save); item; item = strtok_r(NULL, ";\n", &save)){
+      char *key = strtok_r(item, " \t=", &save2);
+      char *val = strtok_r(NULL, " \t=", &save2);
+      if (key == NULL || val == NULL) continue;
+      for (char *p = key; *p; ++p) *p = toupper(*p);
+      if (strcmp(key, "IBRION") == 0) ibrion = atoi(val);
+      else if (strcmp(key, "NSW") == 0) nsw = atoi(val);
+      else if (strcmp(key, "ISIF") == 0) isif = atoi(val);
+      else if (strcmp(key, "EDIFFG") == 0) ediffg = atof(val);
+      else if (strcmp(key, "POTIM") == 0) potim = atof(val);
+    }
+  }
+  fclose(fin);
+  if (ibrion == -1 && nsw > 0) ibrion = 0;
+  if (isif == -1) isif = ibrion == 0 ? 0 : 2;
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write one ionic step to OUTCAR, in the format VASP does, so that
+ * the script and ecvasp read it as they read that of VASP: the stress (in kB,
+ * pressure positive, XX YY ZZ XY YZ ZX), the positions and forces, and the
+ * energy.
+ *------------------------------------------------------------------------------ */
+void Calculator::outcar(FILE *out, const Structure *s, double eng, double **f, double *sigma)
+{
+  static const char *line = " -----------------------------------------------------------------------------------\n";
+  static const int map[6] = {0, 1, 2, 5, 3, 4};
+  double p[6], A[3][3];
+  for (int i = 0; i < 6; ++i) p[i] = -10.*sigma[map[i]];
+
+  fprintf(out, "  FORCE on cell =-STRESS in cart. coord.  units (eV):\n");
+  fprintf(out, "  Direction    XX          YY          ZZ          XY          YZ          ZX\n");
+  fprintf(out, "  Total   ");
+  for (int i = 0; i < 6; ++i) fprintf(out, " %11.5f", p[i]*vol/1602.1766208);
+  fprintf(out, "\n  in kB   ");
+  for (int i = 0; i < 6; ++i) fprintf(out, " %11.5f", p[i]);
+  fprintf(out, "\n  external pressure = %11.2f kB  Pullay stress =        0.00 kB\n\n", (p[0]+p[1]+p[2])/3.);
+
+  cart(s, A, NULL);
+  fprintf(out, " POSITION                                       TOTAL-FORCE (eV/Angst)\n%s", line);
+  for (int i = 0; i < s->natom; ++i){
+    double *x = s->atpos[i], r[3];
+    for (int j = 0; j < 3; ++j) r[j] = x[0]*A[0][j] + x[1]*A[1][j] + x[2]*A[2][j];
+    fprintf(out, " %12.5f %12.5f %12.5f   %14.6f %14.6f %14.6f\n", r[0], r[1], r[2], f[i][0], f[i][1], f[i][2]);
+  }
+  fprintf(out, "%s\n", line);
+
+  fprintf(out, "  FREE ENERGIE OF THE ION-ELECTRON SYSTEM (eV)\n  ---------------------------------------------------\n");
+  fprintf(out, "  free  energy   TOTEN  = %18.8f eV\n\n", eng);
+  fprintf(out, "  energy  without entropy= %18.8f  energy(sigma->0) = %18.8f\n\n", eng, eng);
+  fflush(out);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to stand in for VASP: the structure in poscar is computed as INCAR
+ * asks, into OUTCAR, OSZICAR and CONTCAR of the current folder, in formats
+ * that the script and ecvasp read as they read those of VASP. The ions are
+ * relaxed by FIRE if IBRION = 1, 2 or 3 and NSW > 0; the cell is kept, i.e.,
+ * ISIF = 2. With IBRION = 6 and ISIF >= 3, the elastic moduli are computed by
+ * central differences with strain POTIM, the ionic contribution by relaxing
+ * the ions in each strained state.
+ *------------------------------------------------------------------------------ */
+int Calculator::run(const char *poscar, const char *fincar)
+{
+  double t0 = walltime();
+  clock_t c0 = clock();
+  Structure *s = new Structure();
+  int flag = s->read(poscar);
+  if (flag != ECV_OK){
+    printf("\nERROR: %s in file: %s!\n", ecv_strerror(flag), poscar);
+    delete s;
+    return 1;
+  }
+  if (setup(s)){
+    delete s;
+    return 1;
+  }
+
+  int ibrion, nsw, isif;
+  double ediffg, potim;
+  if (incar(fincar, ibrion, nsw, isif, ediffg, potim)) printf("\nWARNING: %s not found, a static run is done.\n", fincar);
+  int ions = (ibrion == 1 || ibrion == 2 || ibrion == 3) && nsw > 0;
+  if (ions && isif >= 3) printf("\nWARNING: the cell is not relaxed with ISIF = %d, only the ions are.\n", isif);
+
+  FILE *out = fopen("OUTCAR", "w");
+  FILE *osz = fopen("OSZICAR", "w");
+  if (out == NULL || osz == NULL){
+    printf("\nERROR: cannot open OUTCAR or OSZICAR for writting!\n");
+    if (out) fclose(out);
+    if (osz) fclose(osz);
+    delete s;
+    return 1;
+  }
+  fprintf(out, " vasp.5.x.x stand-in: ecvasp -calc\n");
+  fprintf(out, " POSCAR = %s", s->title ? s->title : "\n");
+  fprintf(out, "   IBRION = %d; NSW = %d; ISIF = %d; EDIFFG = %g; POTIM = %g\n\n", ibrion, nsw, isif, ediffg, potim);
+
+  int nion = relax(s, ions ? nsw : 1, ediffg, out, osz);
+
+  if (ibrion == 6 && isif >= 3){
+    static const char *dir[6] = {"XX", "YY", "ZZ", "XY", "YZ", "ZX"};
+    static const int map[6] = {0, 1, 2, 5, 3, 4};
+    double e[7], clamped[6][6], total[6][6];
+    for (int i = 0; i < 7; ++i) e[i] = potim;
+    moduli(s, e, 0, clamped, NULL);
+    moduli(s, e, 1, total, NULL);
+    for (int k = 0; k < 2; ++k){
+      fprintf(out, k ? " TOTAL ELASTIC MODULI (kBar)\n" : " ELASTIC MODULI CONTR FROM IONIC RELAXATION (kBar)\n");
+      fprintf(out, " Direction    XX          YY          ZZ          XY          YZ          ZX\n");
+      fprintf(out, " --------------------------------------------------------------------------------\n");
+      for (int i = 0; i < 6; ++i){
+        fprintf(out, " %-7s", dir[i]);
+        for (int j = 0; j < 6; ++j){
+          int a = map[i], b = map[j];
+          double c = 5.*(total[a][b] + total[b][a]);
+          if (k == 0) c -= 5.*(clamped[a][b] + clamped[b][a]);
+          fprintf(out, " %11.4f", c);
+        }
+        fprintf(out, "\n");
+      }
+      fprintf(out, " --------------------------------------------------------------------------------\n\n");
+    }
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  double cpu = double(clock() - c0)/double(CLOCKS_PER_SEC), wall = walltime() - t0;
+  fprintf(out, "      LOOP+:  cpu time %11.4f: real time %11.4f\n\n", cpu, wall);
+  fprintf(out, " General timing and accounting informations for this job:\n");
+  fprintf(out, " ========================================================\n\n");
+  fprintf(out, "                  Total CPU time used (sec): %14.3f\n", cpu);
+  fprintf(out, "                            Elapsed time (sec): %14.3f\n\n", wall);
+  fprintf(out, "                   Maximum memory used (kb): %14.0f\n", double(usage.ru_maxrss));
+  fclose(out);
+  fclose(osz);
+
+  size_t need = 0;
+  s->write(NULL, 0, &need);
+  char *buf = new char [need];
+  s->write(buf, need, NULL);
+  FILE *fcont = fopen("CONTCAR", "w");
+  if (fcont){
+    fputs(buf, fcont);
+    fclose(fcont);
+  }
+  delete []buf;
+
+  printf(" ecvasp -calc: %d ionic step(s), %d atoms, cutoff %g A, %.3f s\n", nion, s->natom, rcut, wall);
+  delete s;
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * To get the wall time, in seconds
+ *------------------------------------------------------------------------------ */
+static double walltime()
+{
+#ifdef OMP
+  return omp_get_wtime();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return double(ts.tv_sec) + 1.e-9*double(ts.tv_nsec);
+#endif
+}
+
+/*------------------------------------------------------------------------------
+ * To match an element name of a pair term, '*' for any
+ *------------------------------------------------------------------------------ */
+static int match(const char *pat, const char *name)
+{
+return strcmp(pat, "*") == 0 || strcmp(pat, name) == 0;
+}
+
+/*------------------------------------------------------------------------------
+ * To estimate the slope, per knot, of table f of n values at knot m
+ *------------------------------------------------------------------------------ */
+static double slope(const double *f, int n, int m)
+{
+  if (m == 0) return f[1] - f[0];
+  if (m == n-1) return f[n-1] - f[n-2];
+  if (m == 1 || m == n-2) return 0.5*(f[m+1] - f[m-1]);
+
+return ((f[m-2] - f[m+2]) + 8.*(f[m+1] - f[m-1]))/12.;
+}
+
+/*----------------------------------------------------------------------------*/
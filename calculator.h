@@ -0,0 +1,64 @@
+#ifndef CALCULATOR_H
+#define CALCULATOR_H
+
+#include "memory.h"
+#include "structure.h"
+#include "stdio.h"
+
+#define MAXPAIR 64
+#define NRELAX 500
+#define FRELAX -1.e-4
+
+using namespace std;
+
+class Calculator {
+public:
+  Calculator();
+  ~Calculator();
+
+  int read(const char *);       // read the potential: lj, morse and eam lines
+  int setup(const Structure *); // map the types of the structure onto the elements of the potential
+  double compute(const Structure *, double **, double *); // energy (eV), forces (eV/A), stress (GPa)
+  int relax(Structure *, int, double, FILE *, FILE *); // relax the ions by FIRE
+  int moduli(const Structure *, const double *, int, double [6][6], double *); // C (GPa) by central difference
+  int run(const char *, const char *); // stand-in for VASP: POSCAR and INCAR to OUTCAR, OSZICAR, CONTCAR
+
+  double rcut;                  // largest cutoff, in Angstrom
+  int nstep;                    // number of ionic steps of the last relaxation
+
+private:
+  Memory *memory;
+
+  // pair terms
+  int npair;
+  int pstyle[MAXPAIR];          // 0, Lennard-Jones; 1, Morse
+  char pname[MAXPAIR][2][16];   // element names of each pair term
+  double pcoef[MAXPAIR][4];     // eps sigma, or D0 alpha r0; and the energy shift at rc
+  double prc[MAXPAIR];
+
+  // EAM, in the setfl format of LAMMPS eam/alloy
+  int neam, nrho, nr;
+  char (*ename)[16];            // element names of the setfl file
+  double drho, dr, rceam;
+  double **frho, **rhor, **z2r; // tables of F(rho), rho(r) and r*phi(r)
+
+  // type maps of the current structure
+  int ntype;
+  int *emap;                    // type -> element of the EAM, -1 if none
+  int **pmap;                   // type pair -> pair term, -1 if none
+
+  // neighbor lists, full, built on periodic images of the cell
+  int natom, nmax, nneigh, nnmax;
+  int *type, *first, *num, *jlist;
+  double **dx;
+  double *rho, *fp, *eatom, **vatom;
+  double vol;
+
+  int readeam(const char *);
+  void spline(double *, int, double, double, double &, double &);
+  int neighbor(const Structure *);
+  void cart(const Structure *, double [3][3], double **);
+  int incar(const char *, int &, int &, int &, double &, double &);
+  void outcar(FILE *, const Structure *, double, double **, double *);
+};
+#endif
@@ -1,24 +1,77 @@
 #include "driver.h"
+#include "elastic.h"
+#include "surface.h"
+#include "texture.h"
+#include "bootstrap.h"
+#include "fidelity.h"
+#include "toec.h"
+#include "relax.h"
+#include "monitor.h"
+#include "calculator.h"
+#include "pilot.h"
+#include "ecvasp.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
 #include <ctype.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <errno.h>
 
 #define ZERO 1.e-10
-#define MAXLINE 1024
 #define STRAIN 0.008
 #define NSRATIO 1.8
+#define TSTRAIN 0.02
+#define KSPRING 10.
+#define TOLERANCE 0.2
+#define LINEAR 0.01
+#define KCONV 0.01
 
 /*------------------------------------------------------------------------------
  * Constructor of driver, main menu
  *------------------------------------------------------------------------------ */
 Driver::Driver(int narg, char** arg)
 {
-  ntm = NULL;
   memory = NULL;
-  axis = dispmat = newaxis = atpos = NULL;
-  for (int i = 0; i < 7; ++i) disp[i] = 0.;
-  poscar = fname = title = element = NULL;
+  ref = strained = NULL;
+  for (int i = 0; i < 7; ++i) disp[i] = etoec[i] = 0.;
+  poscar = fname = cijfile = infofile = NULL;
+  ngrid[0] = 181; ngrid[1] = 360;
+  rho = noise = 0.;
+  nsample = 100000;
+  seed = 1234567;
+  npress = birch = scratch = tune = 0;
+  press = NULL;
+  zip = NULL;
+  mf = 0;
+  for (int i = 0; i < 7; ++i) mfcol[i] = 0;
+  lowfile = highfile = NULL;
+  toec = 0;
+  toecfile = NULL;
+  perf = 0;
+  perffile = NULL;
+  timer = NULL;
+  relax = 0;
+  kspring = KSPRING;
+  forcefile[0] = forcefile[1] = mirrorfile[0] = mirrorfile[1] = NULL;
+  clampfile = relaxfile = NULL;
+  ib6 = bench = 0;
+  modfile = benchdir[0] = benchdir[1] = NULL;
+  reduce = 0;
+  inc = 0;
+  incfile = NULL;
+  tol = TOLERANCE;
+  texfile[0] = texfile[1] = NULL;
+  calcfile = potfile = screenfile = NULL;
+  pilotfile = NULL;
+  nslot = 0;
+  nretry = NRETRY;
+  kdens = 0.;
+  nkconv = 0;
+  kconv = NULL;
+  kconvdir = NULL;
+  kmesh = NULL;
+  status = 0;
 
   // analyse command line options
   int iarg = 1;
@@ -73,6 +126,273 @@ Driver::Driver(int narg, char** arg)
       if (++iarg >= narg) help();
       disp[4] = fabs(atof(arg[iarg]));
 
+    } else if (strcmp(arg[iarg], "-s") == 0){ // directional properties from Cij
+      if (++iarg >= narg) help();
+      if (cijfile) delete []cijfile;
+      cijfile = new char [strlen(arg[iarg])+1];
+      strcpy(cijfile, arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-texture") == 0){ // textured polycrystal
+      if (iarg+2 >= narg) help();
+      for (int i = 0; i < 2; ++i){
+        if (texfile[i]) delete []texfile[i];
+        ++iarg;
+        texfile[i] = new char [strlen(arg[iarg])+1];
+        strcpy(texfile[i], arg[iarg]);
+      }
+
+    } else if (strcmp(arg[iarg], "-grid") == 0){ // grid size for directional properties
+      if (iarg+2 >= narg) help();
+      ngrid[0] = atoi(arg[++iarg]);
+      ngrid[1] = atoi(arg[++iarg]);
+
+    } else if (strcmp(arg[iarg], "-rho") == 0){ // mass density
+      if (++iarg >= narg) help();
+      rho = fabs(atof(arg[iarg]));
+
+    } else if (strcmp(arg[iarg], "-u") == 0){ // uncertainty from info.dat
+      if (++iarg >= narg) help();
+      if (infofile) delete []infofile;
+      infofile = new char [strlen(arg[iarg])+1];
+      strcpy(infofile, arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-n") == 0){ // number of resamples
+      if (++iarg >= narg) help();
+      nsample = atoi(arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-noise") == 0){ // stress noise in kB
+      if (++iarg >= narg) help();
+      noise = fabs(atof(arg[iarg]));
+
+    } else if (strcmp(arg[iarg], "-seed") == 0){ // seed for resampling
+      if (++iarg >= narg) help();
+      seed = strtoul(arg[iarg], NULL, 10);
+
+    } else if (strcmp(arg[iarg], "-p") == 0){ // pressure sweep
+      if (++iarg >= narg) help();
+      char *str = new char [strlen(arg[iarg])+1];
+      strcpy(str, arg[iarg]);
+      if (press) delete []press;
+      press = new double [strlen(str)/2+1];
+      npress = 0;
+      char *ptr = strtok(str, " ,;\t");
+      while (ptr){
+        press[npress++] = atof(ptr);
+        ptr = strtok(NULL, " ,;\t");
+      }
+      delete []str;
+      if (npress < 1) help();
+
+    } else if (strcmp(arg[iarg], "-kmesh") == 0){ // explicit k-mesh of the reference cell
+      if (++iarg >= narg) help();
+      kdens = fabs(atof(arg[iarg]));
+
+    } else if (strcmp(arg[iarg], "-kconv") == 0){ // k-point convergence series
+      if (++iarg >= narg) help();
+      char *str = new char [strlen(arg[iarg])+1];
+      strcpy(str, arg[iarg]);
+      if (kconv) delete []kconv;
+      kconv = new double [strlen(str)/2+1];
+      nkconv = 0;
+      char *ptr = strtok(str, " ,;\t");
+      while (ptr){
+        if (atof(ptr) > ZERO) kconv[nkconv++] = atof(ptr);
+        ptr = strtok(NULL, " ,;\t");
+      }
+      delete []str;
+      if (nkconv < 2){
+        printf("\nERROR: at least two k-mesh lengths are needed for -kconv!\n");
+        help();
+      }
+      // from the coarsest to the densest, the last being the reference
+      for (int i = 1; i < nkconv; ++i)
+      for (int j = i; j > 0 && kconv[j] < kconv[j-1]; --j){
+        double r = kconv[j]; kconv[j] = kconv[j-1]; kconv[j-1] = r;
+      }
+
+    } else if (strcmp(arg[iarg], "-kconvc") == 0){ // compare the k-point convergence series
+      if (++iarg >= narg) help();
+      if (kconvdir) delete []kconvdir;
+      kconvdir = new char [strlen(arg[iarg])+1];
+      strcpy(kconvdir, arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-birch") == 0){ // pressure corrected Cij
+      birch = 1;
+
+    } else if (strcmp(arg[iarg], "-tune") == 0){ // tune the parallel settings
+      tune = 1;
+
+    } else if (strcmp(arg[iarg], "-scratch") == 0){ // run in node-local scratch
+      scratch = 1;
+
+    } else if (strcmp(arg[iarg], "-zip") == 0){ // compressor of the archives
+      if (++iarg >= narg) help();
+      if (strcmp(arg[iarg], "gzip") && strcmp(arg[iarg], "zstd")) help();
+      if (zip) delete []zip;
+      zip = new char [strlen(arg[iarg])+1];
+      strcpy(zip, arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-mf") == 0){ // multi-fidelity mode
+      if (++iarg >= narg) help();
+      char *str = new char [strlen(arg[iarg])+1];
+      strcpy(str, arg[iarg]);
+      char *ptr = strtok(str, " ,;\t");
+      while (ptr){
+        int idim = atoi(ptr);
+        if (idim >= 1 && idim <= 6) mfcol[idim] = 1;
+        ptr = strtok(NULL, " ,;\t");
+      }
+      delete []str;
+      mf = 0;
+      for (int i = 1; i <= 6; ++i) mf += mfcol[i];
+      if (mf == 0){
+        printf("\nERROR: no Voigt component (1-6) selected by -mf!\n");
+        help();
+      }
+      mf = 1;
+
+    } else if (strcmp(arg[iarg], "-mfc") == 0){ // multi-fidelity correction
+      if (iarg+2 >= narg) help();
+      if (lowfile) delete []lowfile;
+      if (highfile) delete []highfile;
+      ++iarg;
+      lowfile = new char [strlen(arg[iarg])+1];
+      strcpy(lowfile, arg[iarg]);
+      ++iarg;
+      highfile = new char [strlen(arg[iarg])+1];
+      strcpy(highfile, arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-perf") == 0){ // record the timings
+      perf = 1;
+
+    } else if (strcmp(arg[iarg], "-report") == 0){ // report the timings
+      if (++iarg >= narg) help();
+      if (perffile) delete []perffile;
+      perffile = new char [strlen(arg[iarg])+1];
+      strcpy(perffile, arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-relax") == 0){ // relaxed-ion constants
+      relax = 1;
+
+    } else if (strcmp(arg[iarg], "-kspring") == 0){ // effective spring constant
+      if (++iarg >= narg) help();
+      kspring = fabs(atof(arg[iarg]));
+
+    } else if (strcmp(arg[iarg], "-predict") == 0){ // first order guess of the internal relaxation
+      if (iarg+2 >= narg) help();
+      for (int i = 0; i < 2; ++i){
+        if (forcefile[i]) delete []forcefile[i];
+        ++iarg;
+        forcefile[i] = new char [strlen(arg[iarg])+1];
+        strcpy(forcefile[i], arg[iarg]);
+      }
+
+    } else if (strcmp(arg[iarg], "-mirror") == 0){ // guess from the opposite strain
+      if (iarg+2 >= narg) help();
+      for (int i = 0; i < 2; ++i){
+        if (mirrorfile[i]) delete []mirrorfile[i];
+        ++iarg;
+        mirrorfile[i] = new char [strlen(arg[iarg])+1];
+        strcpy(mirrorfile[i], arg[iarg]);
+      }
+
+    } else if (strcmp(arg[iarg], "-relaxc") == 0){ // internal strain contribution
+      if (iarg+2 >= narg) help();
+      if (clampfile) delete []clampfile;
+      if (relaxfile) delete []relaxfile;
+      ++iarg;
+      clampfile = new char [strlen(arg[iarg])+1];
+      strcpy(clampfile, arg[iarg]);
+      ++iarg;
+      relaxfile = new char [strlen(arg[iarg])+1];
+      strcpy(relaxfile, arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-reduce") == 0){ // primitive and Niggli reduced cell
+      reduce = 1;
+
+    } else if (strcmp(arg[iarg], "-inc") == 0){ // incremental analysis
+      inc = 1;
+
+    } else if (strcmp(arg[iarg], "-incc") == 0){ // check the states available
+      if (++iarg >= narg) help();
+      if (incfile) delete []incfile;
+      incfile = new char [strlen(arg[iarg])+1];
+      strcpy(incfile, arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-tol") == 0){ // tolerance of the checks
+      if (++iarg >= narg) help();
+      tol = fabs(atof(arg[iarg]));
+
+    } else if (strcmp(arg[iarg], "-ibrion6") == 0){ // single run with IBRION = 6
+      ib6 = 1;
+
+    } else if (strcmp(arg[iarg], "-outcar") == 0){ // elastic moduli from OUTCAR of IBRION = 6
+      if (++iarg >= narg) help();
+      if (modfile) delete []modfile;
+      modfile = new char [strlen(arg[iarg])+1];
+      strcpy(modfile, arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-bench") == 0){ // IBRION = 6 against the strain set
+      bench = 1;
+
+    } else if (strcmp(arg[iarg], "-benchc") == 0){ // compare the two
+      if (iarg+2 >= narg) help();
+      for (int i = 0; i < 2; ++i){
+        if (benchdir[i]) delete []benchdir[i];
+        ++iarg;
+        benchdir[i] = new char [strlen(arg[iarg])+1];
+        strcpy(benchdir[i], arg[iarg]);
+      }
+
+    } else if (strcmp(arg[iarg], "-calc") == 0){ // stand in for VASP by a potential
+      if (++iarg >= narg) help();
+      if (calcfile) delete []calcfile;
+      calcfile = new char [strlen(arg[iarg])+1];
+      strcpy(calcfile, arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-pot") == 0){ // the script to run with a potential
+      if (++iarg >= narg) help();
+      if (potfile) free(potfile);
+      potfile = realpath(arg[iarg], NULL);
+      if (potfile == NULL){
+        printf("\nFile %s not found!\n", arg[iarg]);
+        help();
+      }
+
+    } else if (strcmp(arg[iarg], "-screen") == 0){ // pre-screen the strains with a potential
+      if (++iarg >= narg) help();
+      if (screenfile) delete []screenfile;
+      screenfile = new char [strlen(arg[iarg])+1];
+      strcpy(screenfile, arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-pilot") == 0){ // run the states of many structures as one job
+      if (++iarg >= narg) help();
+      if (pilotfile) delete []pilotfile;
+      pilotfile = new char [strlen(arg[iarg])+1];
+      strcpy(pilotfile, arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-slots") == 0){ // tasks of the pilot job run at a time
+      if (++iarg >= narg) help();
+      nslot = atoi(arg[iarg]);
+
+    } else if (strcmp(arg[iarg], "-retry") == 0){ // retries of each failed task of the pilot job
+      if (++iarg >= narg) help();
+      nretry = atoi(arg[iarg]);
+      if (nretry < 0) nretry = 0;
+
+    } else if (strcmp(arg[iarg], "-toec") == 0){ // third order elastic constants
+      toec = 1;
+
+    } else if (strcmp(arg[iarg], "-etoec") == 0){ // strain of the third order states
+      if (++iarg >= narg) help();
+      etoec[0] = fabs(atof(arg[iarg]));
+
+    } else if (strcmp(arg[iarg], "-toecfit") == 0){ // fit the third order elastic constants
+      if (++iarg >= narg) help();
+      if (toecfile) delete []toecfile;
+      toecfile = new char [strlen(arg[iarg])+1];
+      strcpy(toecfile, arg[iarg]);
+
     } else {
       if (poscar) delete []poscar;
       poscar = new char [strlen(arg[iarg])+1];
@@ -92,25 +412,190 @@ Driver::Driver(int narg, char** arg)
   if (disp[0] < ZERO) disp[0] = STRAIN;
   for (int i = 1; i <= 3; ++i) if (disp[i] < ZERO) disp[i] = disp[0];
   for (int i = 4; i <= 6; ++i) if (disp[i] < ZERO) disp[i] = disp[0]*NSRATIO;
+  if (etoec[0] < ZERO) etoec[0] = TSTRAIN;
+  for (int i = 1; i <= 6; ++i) etoec[i] = i <= 3 ? etoec[0] : etoec[0]*NSRATIO;
+
+  memory = new Memory();
+  if (perf || perffile) timer = new Perf();
+
+  // timings recorded in perf.dat into JSON and Prometheus reports, no script will be written
+  if (perffile){
+    if (fname == NULL){
+      fname = new char[5];
+      strcpy(fname, "perf");
+    }
+    timing("report");
+    if (timer->read(perffile) == 0) timer->report(fname);
+    return;
+  }
+
+  // directional properties from Cij, no script will be written
+  if (cijfile){
+    if (fname == NULL){
+      fname = new char[12];
+      strcpy(fname, "surface.dat");
+    }
+    timing("surface");
+    surface();
+    return;
+  }
+
+  // elastic constants of the textured polycrystal, no script will be written
+  if (texfile[0]){
+    timing("texture");
+    texture();
+    return;
+  }
+
+  // uncertainty of Cij and moduli from info.dat, no script will be written
+  if (infofile){
+    timing("uncertainty");
+    uncertainty();
+    return;
+  }
+
+  // multi-fidelity correction of Cij, no script will be written
+  if (lowfile){
+    timing("fidelity");
+    fidelity();
+    return;
+  }
+
+  // elastic moduli computed by VASP itself, no script will be written
+  if (modfile){
+    timing("outcar");
+    readmoduli();
+    return;
+  }
+
+  // cost and results of IBRION = 6 against the strain set, no script will be written
+  if (benchdir[0]){
+    timing("benchc");
+    benchcmp();
+    return;
+  }
+
+  // convergence of Cij against the k-point density, no script will be written
+  if (kconvdir){
+    timing("kconvc");
+    kconvcmp();
+    return;
+  }
+
+  // partial Cij and sanity checks of the states available, no script will be written
+  if (incfile){
+    timing("incc");
+    incremental();
+    return;
+  }
+
+  // relaxed-ion versus clamped-ion constants, no script will be written
+  if (clampfile){
+    timing("relaxc");
+    relaxed();
+    return;
+  }
+
+  // starting positions of the relaxation of a strained state, no script will be written
+  if (forcefile[0] || mirrorfile[0]){
+    if (fname == NULL){
+      fname = new char[12];
+      strcpy(fname, "POSCAR.pred");
+    }
+    timing("guess");
+    guess();
+    return;
+  }
+
+  // third order elastic constants from stress.dat, no script will be written
+  if (toecfile){
+    if (fname == NULL){
+      fname = new char[9];
+      strcpy(fname, "toec.dat");
+    }
+    timing("toecfit");
+    toecfit();
+    return;
+  }
+
+  // the structure computed by a potential in place of VASP, no script will be written
+  if (calcfile){
+    timing("calc");
+    calc();
+    return;
+  }
+
+  // strains pre-screened by a potential, no script will be written
+  if (screenfile){
+    timing("readpos");
+    if ( readpos() ) help();
+    timing("screen");
+    screen();
+    return;
+  }
+
+  // the states of many structures run as one pilot job, no script will be written
+  if (pilotfile){
+    if (fname == NULL){
+      fname = new char[10];
+      strcpy(fname, "pilot.dat");
+    }
+    timing("pilot");
+    pilot();
+    return;
+  }
 
   if (fname == NULL){
     fname = new char[6];
     strcpy(fname, "ecrun");
   }
+  if (zip == NULL){
+    zip = new char[5];
+    strcpy(zip, "gzip");
+  }
+  if (relax && mf){
+    printf("\nWARNING: -mf is not available together with -relax, ignored.\n");
+    mf = 0;
+  }
+  if (potfile && npress > 0){
+    printf("\nWARNING: -pot cannot relax the cell as -p needs, ignored.\n");
+    free(potfile);
+    potfile = NULL;
+  }
+  if (potfile && tune){
+    printf("\nWARNING: -tune is not needed with -pot, ignored.\n");
+    tune = 0;
+  }
+  if ((kdens > 0. || nkconv > 0) && (toec || bench || ib6)){
+    printf("\nWARNING: -kmesh and -kconv are only available for the strain set of Cij, ignored.\n");
+    kdens = 0.;
+    nkconv = 0;
+  }
+  if (nkconv > 0 && npress > 0){
+    printf("\nWARNING: -kconv is not available together with -p, ignored.\n");
+    nkconv = 0;
+  }
 
-  memory = new Memory();
   // read the POSCAR
+  timing("readpos");
   if ( readpos() ) help();
 
   // write the script
-  generate();
+  timing("generate");
+  if (npress > 0) sweep();
+  else if (nkconv > 0) kseries();
+  else if (toec) thirdorder();
+  else if (bench) benchmark();
+  else if (ib6) singlerun();
+  else generate();
 
   // write out related info
   printf("\n"); for (int i = 0; i < 20; ++i) printf("====");
   printf("\nEquilibrium config read from : %s\n", poscar);
   printf("Script info written to file  : %s\n", fname);
   printf("Displacement info            : ");
-  for (int i = 1; i <= 6; ++i) printf(" %g", disp[i]);
+  for (int i = 1; i <= 6; ++i) printf(" %g", toec ? etoec[i] : disp[i]);
+  if (kmesh) printf("\nExplicit k-mesh (all states) : %d x %d x %d", kmesh->nk[0], kmesh->nk[1], kmesh->nk[2]);
   printf("\n"); for (int i = 0; i < 20; ++i) printf("====");
   printf("\n");
   
@@ -118,20 +603,45 @@ return;
 }
 
 /*------------------------------------------------------------------------------
- * Method to count # of words in a string, without destroying the string
+ * Deconstructor, free memory
  *------------------------------------------------------------------------------ */
 Driver::~Driver()
 {
-  if (ntm) memory->destroy(ntm);
-  if (axis) memory->destroy(axis);
-  if (atpos) memory->destroy(atpos);
-  if (newaxis) memory->destroy(newaxis);
-  if (dispmat) memory->destroy(dispmat);
-
   if (fname)  delete []fname;
-  if (title)  delete []title;
   if (poscar) delete []poscar;
-  if (element) delete []element;
+  if (cijfile) delete []cijfile;
+  if (infofile) delete []infofile;
+  if (press) delete []press;
+  if (zip) delete []zip;
+  if (lowfile) delete []lowfile;
+  if (highfile) delete []highfile;
+  if (toecfile) delete []toecfile;
+  if (perffile) delete []perffile;
+  for (int i = 0; i < 2; ++i){
+    if (forcefile[i]) delete []forcefile[i];
+    if (mirrorfile[i]) delete []mirrorfile[i];
+  }
+  if (clampfile) delete []clampfile;
+  if (relaxfile) delete []relaxfile;
+  if (modfile) delete []modfile;
+  if (incfile) delete []incfile;
+  for (int i = 0; i < 2; ++i) if (texfile[i]) delete []texfile[i];
+  for (int i = 0; i < 2; ++i) if (benchdir[i]) delete []benchdir[i];
+  if (calcfile) delete []calcfile;
+  if (potfile) free(potfile);
+  if (screenfile) delete []screenfile;
+  if (pilotfile) delete []pilotfile;
+  if (kconv) delete []kconv;
+  if (kconvdir) delete []kconvdir;
+  if (kmesh) delete kmesh;
+
+  // -report alone times itself for the report only, perf.dat is its input
+  if (timer){
+    if (perf) timer->append("perf.dat");
+    delete timer;
+  }
+  ecv_structure_free(strained);
+  ecv_structure_free(ref);
 
   if (memory) delete memory;
 return;
@@ -142,85 +652,34 @@ return;
  *------------------------------------------------------------------------------ */
 int Driver::readpos()
 {
-  char str[MAXLINE];
-  // open the file
-  FILE *fp = fopen(poscar, "r");
-  if (fp == NULL){
+  // compressed one is read via streaming decompression
+  ecv_structure_free(ref);
+  int flag = ecv_structure_read(poscar, &ref);
+  if (flag == ECV_ERR_FILE){
     printf("\nFile %s not found!\n", poscar);
-    return 1;
-  }
-  
-  fgets(str, MAXLINE, fp);
-  int n = strlen(str);
-  title = new char [n+1];
-  strcpy(title, str);
-  
-  fgets(str, MAXLINE, fp);
-  alat = atof(strtok(str, " \n\t\r\f"));
-
-  memory->create(axis, 3, 3, "axis");
-  memory->create(dispmat, 3, 3, "dispmat");
-  memory->create(newaxis, 3, 3, "newaxis");
-  for (int i = 0; i < 3; ++i){
-    fgets(str, MAXLINE, fp);
-    axis[i][0] = atof(strtok(str,  " \n\t\r\f"));
-    axis[i][1] = atof(strtok(NULL, " \n\t\r\f"));
-    axis[i][2] = atof(strtok(NULL, " \n\t\r\f"));
-  }
-
-  fgets(str, MAXLINE, fp);
-  n = strlen(str);
-  element = new char [n+1];
-  strcpy(element, str);
-  n = count_words(str);
-
-  char *ptr = strtok(str, " \n\t\r\f");
-  if (isalpha(ptr[0])){
-    fgets(str, MAXLINE, fp);
-    n = count_words(str);
-    ptr = strtok(str, " \n\t\r\f");
-
-  } else {
-    delete []element; element = NULL;
-  }
-  ntm = new int[n];
-  ntype = n;
-  natom = 0;
-  for (int i = 0; i < n; ++i){
-    ntm[i] = atoi(ptr);
-    natom += ntm[i];
-
-    ptr = strtok(NULL, " \n\t\r\f");
-  }
-  if (natom < 1){
-    printf("\nERROR: no atom is identified in file: %s\n!", poscar);
-    return 2;
-  }
-  memory->create(atpos, natom, 3, "atpos");
-
-  fgets(str, MAXLINE, fp);
-  ptr = strtok(str, " \n\t\r\f");
-  if (ptr[0] == 'S' || ptr[0] == 's'){
-    fgets(str, MAXLINE, fp);
-    ptr = strtok(str, " \n\t\r\f");
-  }
-  if (ptr[0] == 'C' || ptr[0] == 'c' || ptr[0] == 'K' || ptr[0] == 'k'){
+    return flag;
+  } else if (flag == ECV_ERR_CARTESIAN){
     printf("\nERROR: the positions read from %s are in cartesian coordinate,\n", poscar);
     printf("while I expect fractional/direct!\n");
-
-    return 3;
+    return flag;
+  } else if (flag != ECV_OK){
+    printf("\nERROR: %s in file: %s!\n", ecv_strerror(flag), poscar);
+    return flag;
   }
 
-  for (int i = 0; i < natom; ++i){
-    fgets(str, MAXLINE, fp);
-    ptr = strtok(str, " \n\t\r\f");
-    for (int ii = 0; ii < 3; ++ii){
-      atpos[i][ii] = atof(ptr);
-      ptr = strtok(NULL, " \n\t\r\f");
+  // the strains are applied in the Cartesian frame of the POSCAR, which the
+  // reduced cell keeps; the Cij thus need no rotation back
+  if (reduce){
+    int n0 = 0, n1 = 0;
+    ecv_structure_natom(ref, &n0);
+    if (ecv_structure_reduce(ref, 1.e-3, NULL) != ECV_OK) printf("\nWARNING: failed to reduce the cell of %s.\n", poscar);
+    else {
+      ecv_structure_natom(ref, &n1);
+      printf("\nCell of %s reduced from %d to %d atoms, Niggli reduced; KPOINTS should\n", poscar, n0, n1);
+      printf("suit the reduced cell, whose lattice vectors are in the POSCAR of each state.\n");
     }
   }
-  fclose(fp);
-    
+
 return 0;
 }
 
@@ -245,6 +704,12 @@ void Driver::generate()
   fprintf(fp,"#     SIGMA  = 0.2 # for metals;\n#\n");
   fprintf(fp,"#     ISMEAR = -5  # for insulators.\n");
   fprintf(fp,"#\n# 2, Dense enough k-mesh.\n");
+  if (kdens > 0.){
+    fprintf(fp,"#  The KPOINTS of each state is written here: the Gamma centered mesh of the\n");
+    fprintf(fp,"#  reference cell for length %g A, as an explicit list in reciprocal lattice\n", kdens);
+    fprintf(fp,"#  units, i.e., mapped onto each strained cell; the +/- states of a component\n");
+    fprintf(fp,"#  share the same k-points and weights, reduced by their common rotations.\n");
+  }
   fprintf(fp,"#\n# 3, The strain should be large enough to avoid noise, but small enough to\n");
   fprintf(fp,"#  keep elasticity.\n");
   fprintf(fp,"#===========================================================================\n");
@@ -252,90 +717,108 @@ void Driver::generate()
   fprintf(fp,"   np=$1\nelse\n   np=2\nfi\n#\n");
   fprintf(fp,"if [[ -f %cPOSCAR%c && ! -f \"POSCAR_ini\" ]]; then\n", char(34), char(34));
   fprintf(fp,"   cp POSCAR POSCAR_ini\nfi\n#\n");
-  fprintf(fp,"VASP=%cmpirun -np ${np} v533%c\n", char(34), char(34));
+  if (kdens > 0.){
+    fprintf(fp,"if [[ -f %cKPOINTS%c && ! -f \"KPOINTS_ini\" ]]; then\n", char(34), char(34));
+    fprintf(fp,"   cp KPOINTS KPOINTS_ini\nfi\n#\n");
+  }
+  writevasp(fp, "${np}");
+  if (mf){
+    fprintf(fp,"#\n# Multi-fidelity mode: all states are first computed with INCAR.low (cheap\n");
+    fprintf(fp,"# settings), then the +/- strains of component(s)");
+    for (int i = 1; i <= 6; ++i) if (mfcol[i]) fprintf(fp," %d", i);
+    fprintf(fp,"\n# are redone with INCAR.high; the cheap Cij are then corrected by ecvasp -mfc.\n");
+    fprintf(fp,"ECVASP=%cecvasp%c\n", char(34), char(34));
+    fprintf(fp,"cp INCAR.low INCAR\n");
+    if (tune) fprintf(fp,"cp INCAR.low INCAR_ini\n");
+  }
+  if (perf){
+    fprintf(fp,"#\n# The timings of each state are appended to perf.dat, and reported at the end\n");
+    fprintf(fp,"# in perf.json and perf.prom; the latter is also copied into PROMDIR if set,\n");
+    fprintf(fp,"# e.g., the folder of the textfile collector of the node exporter.\n");
+    if (mf == 0) fprintf(fp,"ECVASP=%cecvasp%c\n", char(34), char(34));
+  }
+  if (relax){
+    fprintf(fp,"#\n# Relaxed-ion mode: each strained state is computed with the ions clamped, into\n");
+    fprintf(fp,"# info_clamped.dat, and then relaxed with ISIF = 2. The relaxation of the positive\n");
+    fprintf(fp,"# strain starts from the first order prediction (f - f0)/k of ecvasp -predict,\n");
+    fprintf(fp,"# with k = %g eV/A^2; that of the negative strain from the mirrored relaxation\n", kspring);
+    fprintf(fp,"# of the positive one. info.dat and Cij.dat are those of the relaxed ions.\n");
+    if (perf == 0) fprintf(fp,"ECVASP=%cecvasp%c\n", char(34), char(34));
+  }
+  if (scratch) writescratch(fp);
+  if (tune) writetune(fp);
+  if (inc) writecheck(fp);
   fprintf(fp,"#\necho %cThe as-provided configuration (equilibrium state expected)%c\n", char(34), char(34));
 
-  writepos(axis, fp);
+  int laue0 = 1;
+  if (tune){
+    laue0 = laue(ref);
+    fprintf(fp,"set_par 1\n");
+  }
+  writekpts(fp, 0);
+  writepos(ref, fp, "eq");
 
-  fprintf(fp,"press=`grep -B1 'external pressure' OUTCAR|head -1`\n");
-  fprintf(fp,"pxx0=`echo ${press}|awk '{print $3}'`\n");
-  fprintf(fp,"pyy0=`echo ${press}|awk '{print $4}'`\n");
-  fprintf(fp,"pzz0=`echo ${press}|awk '{print $5}'`\n");
-  fprintf(fp,"pxy0=`echo ${press}|awk '{print $6}'`\n");
-  fprintf(fp,"pyz0=`echo ${press}|awk '{print $7}'`\n");
-  fprintf(fp,"pxz0=`echo ${press}|awk '{print $8}'`\n");
-  fprintf(fp,"eng0=`grep 'energy  without' OUTCAR|tail -1|awk '{print $4}'`\n");
+  readpress(fp, "0");
+  fprintf(fp,"eng0=`%s 'energy  without' %s|tail -1|awk '{print $4}'`\n", grep, outcar);
   fprintf(fp,"echo %c0   0  ${pxx0} ${pyy0} ${pzz0} ${pxy0} ${pxz0} ${pyz0} ${eng0}%c\n", char(34), char(34));
   fprintf(fp,"echo %c# Information on elastic constants calculations, since: `date`%c >> info.dat\n", char(34), char(34));
   fprintf(fp,"echo %c0   0  ${pxx0} ${pyy0} ${pzz0} ${pxy0} ${pxz0} ${pyz0} ${eng0}%c >> info.dat\n", char(34), char(34));
-  fprintf(fp,"cp -p DOSCAR DOSCAR.eq\n");
+  if (scratch == 0) fprintf(fp,"cp -p DOSCAR DOSCAR.eq\n");
+  if (relax){
+    if (scratch == 0) fprintf(fp,"cp OUTCAR OUTCAR.eq\n");
+    fprintf(fp,"echo %c# Clamped-ion states of the relaxed-ion mode, since: `date`%c > info_clamped.dat\n", char(34), char(34));
+    fprintf(fp,"echo %c0   0  ${pxx0} ${pyy0} ${pzz0} ${pxy0} ${pxz0} ${pyz0} ${eng0}%c >> info_clamped.dat\n", char(34), char(34));
+  }
   
   double eps[7];
+  char label[8];
   for (int idim = 1; idim <= 6; ++idim){
     for (int i = 1; i < 7; ++i) eps[i] = 0.; eps[idim] = disp[idim];
     fprintf(fp,"# Now to compute that for eps = [%g %g %g %g %g %g]\necho\n",  eps[1], eps[2], eps[3], eps[4], eps[5], eps[6]);
     fprintf(fp,"echo %cNow to compute that for eps = [%g %g %g %g %g %g]%c\n", char(34), eps[1], eps[2], eps[3], eps[4], eps[5], eps[6], char(34));
     fprintf(fp,"eps=%c%lg%c\n", char(34), disp[idim], char(34));
-    for (int i = 0; i < 3; ++i)
-    for (int j = 0; j < 3; ++j) dispmat[i][j] = 0.;
-
-    for (int i = 0; i < 3; ++i) dispmat[i][i] = 1.;
+    strain(idim, disp[idim]);
+    if (tune) fprintf(fp,"set_par %g\n", double(laue0)/double(laue(strained)));
+    sprintf(label, "%dp", idim);
+    writekpts(fp, idim);
+    writepos(strained, fp, label);
+    if (relax) relaxpos(fp, idim, disp[idim], label);
 
-    if (idim <= 3) dispmat[idim-1][idim-1] += disp[idim];
-    if (idim == 4) dispmat[2][1] = disp[idim];
-    if (idim == 5) dispmat[2][0] = disp[idim];
-    if (idim == 6) dispmat[1][0] = disp[idim];
-
-    matmul();
-    writepos(newaxis, fp);
-
-    fprintf(fp,"press=`grep -B1 'external pressure' OUTCAR|head -1`\n");
-    fprintf(fp,"pxx=`echo ${press}|awk '{print $3}'`\n");
-    fprintf(fp,"pyy=`echo ${press}|awk '{print $4}'`\n");
-    fprintf(fp,"pzz=`echo ${press}|awk '{print $5}'`\n");
-    fprintf(fp,"pxy=`echo ${press}|awk '{print $6}'`\n");
-    fprintf(fp,"pyz=`echo ${press}|awk '{print $7}'`\n");
-    fprintf(fp,"pxz=`echo ${press}|awk '{print $8}'`\n");
+    readpress(fp, "");
     fprintf(fp,"C1%dpos=`echo ${pxx} ${pxx0} ${eps} | awk '{print ($2 - ($1))/($3)}'`\n", idim);
     fprintf(fp,"C2%dpos=`echo ${pyy} ${pyy0} ${eps} | awk '{print ($2 - ($1))/($3)}'`\n", idim);
     fprintf(fp,"C3%dpos=`echo ${pzz} ${pzz0} ${eps} | awk '{print ($2 - ($1))/($3)}'`\n", idim);
     fprintf(fp,"C4%dpos=`echo ${pyz} ${pyz0} ${eps} | awk '{print ($2 - ($1))/($3)}'`\n", idim);
     fprintf(fp,"C5%dpos=`echo ${pxz} ${pxz0} ${eps} | awk '{print ($2 - ($1))/($3)}'`\n", idim);
     fprintf(fp,"C6%dpos=`echo ${pxy} ${pxy0} ${eps} | awk '{print ($2 - ($1))/($3)}'`\n", idim);
-    fprintf(fp,"eng%dp=`grep 'energy  without' OUTCAR|tail -1|awk '{print $4}'`\n", idim);
-    fprintf(fp,"mag=`tail -1 OSZICAR|grep 'mag'|awk '{print $10}'`\n");
+    fprintf(fp,"eng%dp=`%s 'energy  without' %s|tail -1|awk '{print $4}'`\n", idim, grep, outcar);
+    fprintf(fp,"mag=`tail -1 %s|grep 'mag'|awk '{print $10}'`\n", oszicar);
     fprintf(fp,"echo %c%d %g  ${pxx} ${pyy} ${pzz} ${pxy} ${pxz} ${pyz} ${eng%dp} ${mag}%c\n", char(34), idim, eps[idim], idim, char(34));
     fprintf(fp,"echo %c%d %g  ${pxx} ${pyy} ${pzz} ${pxy} ${pxz} ${pyz} ${eng%dp} ${mag}%c >> info.dat\n", char(34), idim, eps[idim], idim, char(34));
+    if (inc) fprintf(fp,"check_state\n");
 
     eps[idim] = -disp[idim];
     fprintf(fp,"# Now to compute that for eps = [%g %g %g %g %g %g]\necho\n",  eps[1], eps[2], eps[3], eps[4], eps[5], eps[6]);
     fprintf(fp,"echo %cNow to compute that for eps = [%g %g %g %g %g %g]%c\n", char(34), eps[1], eps[2], eps[3], eps[4], eps[5], eps[6], char(34));
     fprintf(fp,"eps=%c%lg%c\n", char(34), -disp[idim], char(34));
-    if (idim <= 3) dispmat[idim-1][idim-1] -= disp[idim] + disp[idim];
-    if (idim == 4) dispmat[2][1] = -disp[idim];
-    if (idim == 5) dispmat[2][0] = -disp[idim];
-    if (idim == 6) dispmat[1][0] = -disp[idim];
-
-    matmul();
-    writepos(newaxis, fp);
-
-    fprintf(fp,"press=`grep -B1 'external pressure' OUTCAR|head -1`\n");
-    fprintf(fp,"pxx=`echo ${press}|awk '{print $3}'`\n");
-    fprintf(fp,"pyy=`echo ${press}|awk '{print $4}'`\n");
-    fprintf(fp,"pzz=`echo ${press}|awk '{print $5}'`\n");
-    fprintf(fp,"pxy=`echo ${press}|awk '{print $6}'`\n");
-    fprintf(fp,"pyz=`echo ${press}|awk '{print $7}'`\n");
-    fprintf(fp,"pxz=`echo ${press}|awk '{print $8}'`\n");
+    strain(idim, -disp[idim]);
+    if (tune) fprintf(fp,"set_par %g\n", double(laue0)/double(laue(strained)));
+    sprintf(label, "%dn", idim);
+    writepos(strained, fp, label);
+    if (relax) relaxpos(fp, idim, -disp[idim], label);
+
+    readpress(fp, "");
     fprintf(fp,"C1%dneg=`echo ${pxx} ${pxx0} ${eps} | awk '{print ($2 - ($1))/($3)}'`\n", idim);
     fprintf(fp,"C2%dneg=`echo ${pyy} ${pyy0} ${eps} | awk '{print ($2 - ($1))/($3)}'`\n", idim);
     fprintf(fp,"C3%dneg=`echo ${pzz} ${pzz0} ${eps} | awk '{print ($2 - ($1))/($3)}'`\n", idim);
     fprintf(fp,"C4%dneg=`echo ${pyz} ${pyz0} ${eps} | awk '{print ($2 - ($1))/($3)}'`\n", idim);
     fprintf(fp,"C5%dneg=`echo ${pxz} ${pxz0} ${eps} | awk '{print ($2 - ($1))/($3)}'`\n", idim);
     fprintf(fp,"C6%dneg=`echo ${pxy} ${pxy0} ${eps} | awk '{print ($2 - ($1))/($3)}'`\n", idim);
-    fprintf(fp,"eng%dn=`grep 'energy  without' OUTCAR|tail -1|awk '{print $4}'`\n", idim);
-    fprintf(fp,"mag=`tail -1 OSZICAR|grep 'mag'|awk '{print $10}'`\n");
+    fprintf(fp,"eng%dn=`%s 'energy  without' %s|tail -1|awk '{print $4}'`\n", idim, grep, outcar);
+    fprintf(fp,"mag=`tail -1 %s|grep 'mag'|awk '{print $10}'`\n", oszicar);
     fprintf(fp,"echo %c%d %g  ${pxx} ${pyy} ${pzz} ${pxy} ${pxz} ${pyz} ${eng%dn} ${mag}%c\n", char(34), idim, eps[idim], idim, char(34));
     fprintf(fp,"echo %c%d %g  ${pxx} ${pyy} ${pzz} ${pxy} ${pxz} ${pyz} ${eng%dn} ${mag}%c >> info.dat\n", char(34), idim, eps[idim], idim, char(34));
+    if (inc) fprintf(fp,"check_state\n");
 
     fprintf(fp,"C1%d=`echo ${C1%dpos} ${C1%dneg}|awk '{print ($1+$2)/2.}'`\n", idim, idim, idim);
     fprintf(fp,"C2%d=`echo ${C2%dpos} ${C2%dneg}|awk '{print ($1+$2)/2.}'`\n", idim, idim, idim);
@@ -438,9 +921,31 @@ void Driver::generate()
   fprintf(fp, "echo \"   Young's modulus of polycrystal    : ${YOUN}\" >> info.dat \n");
   fprintf(fp, "echo \"   B/G ration (< 1.75, brittle)      : ${BRIT}\" >> info.dat \n");
   fprintf(fp, "echo \"#-+------------------------------------------------------\" >> info.dat\n");
+  if (birch){
+    // Finite differences of the Cauchy stress at hydrostatic pressure P give the Birch
+    // (stress-strain) coefficients B, which govern stability and wave propagation and
+    // are used above. The thermodynamic ones follow from
+    //   C_ijkl = B_ijkl + P(d_ik d_jl + d_il d_jk - d_ij d_kl)
+    fprintf(fp, "P0=`echo ${pxx0} ${pyy0} ${pzz0}|awk '{printf \"%%12.6f\", ($1+$2+$3)/30.}'`\n");
+    fprintf(fp, "echo \"   Reference pressure (GPa)          : ${P0}\" >> info.dat \n");
+    fprintf(fp, "echo \"# The Cij above are the Birch coefficients at pressure P; the thermodynamic ones:\" >> info.dat\n");
+    const char *ij[] = {"11", "22", "33", "44", "55", "66", "12", "13", "23"};
+    for (int i = 0; i < 9; ++i){
+      fprintf(fp, "echo ${C%sall} ${P0}|awk '{printf \"   Thermodynamic C%s (GPa)           : %%12.6f\\n\", $1%c$2}' >> info.dat\n",
+        ij[i], ij[i], i < 6 ? '+' : '-');
+    }
+    fprintf(fp, "echo \"#-+------------------------------------------------------\" >> info.dat\n");
+  }
+  fprintf(fp, "cp .elas.mat.dat Cij.dat\n");
   fprintf(fp, "rm -rf .elas.*mat.dat\n");
+  if (relax) fprintf(fp, "${ECVASP} -relaxc info_clamped.dat info.dat >> info.dat\n");
   fprintf(fp, "\ncat info.dat\n\n");
-  fprintf(fp, "rm -rf CHG* CONTCAR EIGENVAL IBZKPT OSZICAR OUTCAR PCDAT vasprun.xml WAVECAR XDATCAR\n");
+  if (mf) highstage(fp, laue0);
+  if (perf) perfreport(fp);
+  if (tune) fprintf(fp, "cp INCAR_ini INCAR\n");
+  if (kdens > 0.) fprintf(fp, "if [ -f KPOINTS_ini ]; then cp KPOINTS_ini KPOINTS; fi\n");
+  if (scratch == 0) fprintf(fp, "rm -rf CHG* CONTCAR EIGENVAL IBZKPT OSZICAR OUTCAR PCDAT vasprun.xml WAVECAR XDATCAR\n");
+  if (relax) fprintf(fp, "rm -rf OUTCAR.eq POSCAR.[1-6][pn] CONTCAR.[1-6]p\n");
   fprintf(fp, "#\nexit 0\n");
 
   char str[MAXLINE];
@@ -451,81 +956,1573 @@ return;
 }
 
 /*------------------------------------------------------------------------------
- * Method to write one frame of the dump file to a new file
+ * Method to generate the script to compute the elastic constants at a series
+ * of pressures. The cell is relaxed at each pressure, warm-started from the
+ * CONTCAR/WAVECAR of the previous pressure; the strain workflow for the relaxed
+ * cell is then generated by ecvasp itself, with the Birch correction on, and
+ * launched in background so that it runs concurrently with later pressures.
  *------------------------------------------------------------------------------ */
-void Driver::matmul()
+void Driver::sweep()
 {
-  for (int i = 0; i < 3; ++i)
-  for (int j = 0; j < 3; ++j) newaxis[i][j] = 0.;
-
-  for (int i = 0; i < 3; ++i)
-  for (int j = 0; j < 3; ++j){
-    for (int m = 0; m <3; ++m) newaxis[i][j] += axis[i][m] * dispmat[m][j];
+  FILE *fp = fopen(fname, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return;
   }
+
+  fprintf(fp,"#!/bin/bash\n#\n# Script to compute the elastic constants at a series of pressures based on VASP.\n");
+  fprintf(fp,"#===========================================================================\n");
+  fprintf(fp,"# INCAR (for static calculations), KPOINTS and POTCAR are expected in the\n");
+  fprintf(fp,"# current folder. For each pressure P (GPa), the cell is relaxed in folder\n");
+  fprintf(fp,"# P<P> with ISIF = 3 and PSTRESS = 10*P, starting from the CONTCAR/WAVECAR\n");
+  fprintf(fp,"# of the previous pressure; the strain workflow is then generated by ecvasp\n");
+  fprintf(fp,"# for the relaxed cell and runs in background, so that up to maxjobs strain\n");
+  fprintf(fp,"# sets run concurrently with the relaxations of the later pressures. Each job\n");
+  fprintf(fp,"# takes np processes, i.e., up to (maxjobs+1)*np processes are needed.\n#\n");
+  fprintf(fp,"# Usage: %s [np] [maxjobs]\n", fname);
+  fprintf(fp,"#===========================================================================\n");
+  fprintf(fp,"if [ %c$#%c -gt %c0%c ]; then\n", char(34), char(34), char(34), char(34));
+  fprintf(fp,"   np=$1\nelse\n   np=2\nfi\n");
+  fprintf(fp,"if [ %c$#%c -gt %c1%c ]; then\n", char(34), char(34), char(34), char(34));
+  fprintf(fp,"   maxjobs=$2\nelse\n   maxjobs=2\nfi\n#\n");
+  writevasp(fp, "${np}");
+  fprintf(fp,"ECVASP=%cecvasp%c\n", char(34), char(34));
+  fprintf(fp,"plist=%c", char(34));
+  for (int i = 0; i < npress; ++i) fprintf(fp,"%s%g", i ? " " : "", press[i]);
+  fprintf(fp,"%c\n", char(34));
+  fprintf(fp,"root=`pwd`\nprev=%c%c\n#\n", char(34), char(34));
+
+  fprintf(fp,"for P in ${plist}; do\n");
+  fprintf(fp,"   dir=${root}/P${P}\n   mkdir -p ${dir}/relax; cd ${dir}\n");
+  fprintf(fp,"   echo\n   echo %cNow to relax the cell at pressure ${P} GPa%c\n", char(34), char(34));
+  fprintf(fp,"   cp ${root}/KPOINTS ${root}/POTCAR .\n");
+  fprintf(fp,"   if [ -z %c${prev}%c ]; then\n", char(34), char(34));
+  fprintf(fp,"      cp ${root}/POSCAR POSCAR\n      rm -rf WAVECAR\n");
+  fprintf(fp,"   else\n      cp ${prev}/relax/CONTCAR POSCAR\n");
+  fprintf(fp,"      mv ${prev}/relax/WAVECAR WAVECAR\n   fi\n");
+  fprintf(fp,"   grep -v -i -E '^ *(ISIF|IBRION|NSW|EDIFFG|PSTRESS|ISTART) *=' ${root}/INCAR > INCAR\n");
+  fprintf(fp,"   pstress=`echo ${P}|awk '{print $1*10.}'`\n");
+  fprintf(fp,"   cat >> INCAR << EOF\nISIF    = 3\nIBRION  = 2\nNSW     = 100\nEDIFFG  = -1.e-3\nPSTRESS = ${pstress}\nEOF\n");
+  fprintf(fp,"   # relax twice so that the basis set is consistent with the final cell\n");
+  fprintf(fp,"   for iter in 1 2; do\n      ${VASP}\n      cp CONTCAR POSCAR\n   done\n");
+  fprintf(fp,"   mv INCAR OUTCAR OSZICAR CONTCAR WAVECAR relax/\n");
+  fprintf(fp,"   cp ${root}/INCAR INCAR\n");
+  fprintf(fp,"   ${ECVASP} -xx %g -yy %g -zz %g -yz %g -xz %g -xy %g -birch%s",
+    disp[1], disp[2], disp[3], disp[4], disp[5], disp[6], perf ? " -perf" : "");
+  if (relax) fprintf(fp," -relax -kspring %g", kspring);
+  if (inc) fprintf(fp," -inc -tol %g", tol);
+  if (scratch) fprintf(fp," -scratch -zip %s", zip);
+  if (tune) fprintf(fp," -tune");
+  if (kdens > 0.) fprintf(fp," -kmesh %g", kdens);
+  fprintf(fp," -o ecrun relax/CONTCAR > /dev/null\n");
+  fprintf(fp,"   while [ `jobs -rp|wc -l` -ge ${maxjobs} ]; do sleep 30; done\n");
+  fprintf(fp,"   echo %cNow to compute the elastic constants at pressure ${P} GPa in background%c\n", char(34), char(34));
+  fprintf(fp,"   ( ./ecrun ${np} > ecrun.log 2>&1 ) &\n");
+  fprintf(fp,"   prev=${dir}\n   cd ${root}\ndone\nwait\nrm -rf ${prev}/relax/WAVECAR\n#\n");
+
+  fprintf(fp,"echo %c# P(GPa) P0(GPa) C11 C22 C33 C12 C13 C23 C44 C55 C66 KVRH GVRH%c > press.dat\n", char(34), char(34));
+  fprintf(fp,"for P in ${plist}; do\n");
+  fprintf(fp,"   awk -v P=${P} '/Elastic Constant C/{c[$3]=$5} /Voigt-Reuss-Hill bulk/{k=$NF} ");
+  fprintf(fp,"/Voigt-Reuss-Hill shear/{g=$NF} /Reference pressure/{p0=$NF} ");
+  fprintf(fp,"END{print P, p0, c[%cC11%c], c[%cC22%c], c[%cC33%c], c[%cC12%c], c[%cC13%c], c[%cC23%c], ",
+    char(34), char(34), char(34), char(34), char(34), char(34), char(34), char(34), char(34), char(34), char(34), char(34));
+  fprintf(fp,"c[%cC44%c], c[%cC55%c], c[%cC66%c], k, g}' P${P}/info.dat >> press.dat\n",
+    char(34), char(34), char(34), char(34), char(34), char(34));
+  fprintf(fp,"done\n\ncat press.dat\n#\nexit 0\n");
+  fclose(fp);
+
+  char str[MAXLINE];
+  sprintf(str, "chmod +x ./%s", fname);
+  system(str);
+
 return;
 }
 
 /*------------------------------------------------------------------------------
- * Method to write one frame of the dump file to a new file
+ * Method to generate the script to converge the elastic constants against the
+ * k-point density: for each length of the series, the strain workflow with the
+ * explicit k-mesh of that length is generated by ecvasp and run in its folder,
+ * one after another; the Cij are then compared by ecvasp -kconvc.
  *------------------------------------------------------------------------------ */
-void Driver::writepos(double **ax, FILE *fp)
+void Driver::kseries()
 {
-  fprintf(fp,"cat > POSCAR << EOF\n");
-  fprintf(fp,"%s%20.14f\n", title, alat);
-  for (int i = 0; i < 3; ++i) fprintf(fp,"%20.14f %20.14f %20.14f\n", ax[i][0], ax[i][1], ax[i][2]);
-  if (element) fprintf(fp,"%s", element);
-  for (int i = 0; i < ntype; ++i) fprintf(fp, "%d ", ntm[i]);
-  fprintf(fp,"\nDirect\n");
-  for (int i = 0; i < natom; ++i) fprintf(fp, "%20.14f %20.14f %20.14f\n", atpos[i][0], atpos[i][1], atpos[i][2]);
-  fprintf(fp,"EOF\ncat POSCAR\n# Now to do the calculations\nrm -rf WAVECAR\n${VASP}\n");
+  FILE *fp = fopen(fname, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return;
+  }
+
+  fprintf(fp,"#!/bin/bash\n#\n# Script to converge the elastic constants against the k-point density.\n");
+  fprintf(fp,"#===========================================================================\n");
+  fprintf(fp,"# INCAR (for static calculations) and POTCAR are expected in the current\n");
+  fprintf(fp,"# folder. For each k-mesh length R (A) of the series, the strain workflow is\n");
+  fprintf(fp,"# generated by ecvasp -kmesh R in folder K<R>, with the same explicit k-mesh\n");
+  fprintf(fp,"# of the reference cell for all states, and run there; the Cij of the series\n");
+  fprintf(fp,"# are then compared against those of the densest mesh into kconv.dat.\n#\n");
+  fprintf(fp,"# Usage: %s [np]\n", fname);
+  fprintf(fp,"#===========================================================================\n");
+  fprintf(fp,"if [ %c$#%c -gt %c0%c ]; then\n", char(34), char(34), char(34), char(34));
+  fprintf(fp,"   np=$1\nelse\n   np=2\nfi\n#\n");
+  fprintf(fp,"ECVASP=%cecvasp%c\n", char(34), char(34));
+  fprintf(fp,"klist=%c", char(34));
+  for (int i = 0; i < nkconv; ++i) fprintf(fp,"%s%g", i ? " " : "", kconv[i]);
+  fprintf(fp,"%c\n", char(34));
+  fprintf(fp,"root=`pwd`\ndirs=%c%c\n#\n", char(34), char(34));
+
+  fprintf(fp,"for R in ${klist}; do\n");
+  fprintf(fp,"   dir=K${R}\n   mkdir -p ${dir}; cd ${dir}\n");
+  fprintf(fp,"   echo\n   echo %cNow to compute the elastic constants with k-mesh length ${R} A%c\n", char(34), char(34));
+  fprintf(fp,"   for f in INCAR POTCAR; do\n      if [ -f ${root}/${f} ]; then cp ${root}/${f} .; fi\n   done\n");
+  fprintf(fp,"   cp %s%s POSCAR\n", poscar[0] == '/' ? "" : "${root}/", poscar);
+  fprintf(fp,"   ${ECVASP} -xx %g -yy %g -zz %g -yz %g -xz %g -xy %g -kmesh ${R}%s%s",
+    disp[1], disp[2], disp[3], disp[4], disp[5], disp[6], reduce ? " -reduce" : "", perf ? " -perf" : "");
+  if (relax) fprintf(fp," -relax -kspring %g", kspring);
+  if (inc) fprintf(fp," -inc -tol %g", tol);
+  if (scratch) fprintf(fp," -scratch -zip %s", zip);
+  if (tune) fprintf(fp," -tune");
+  if (potfile) fprintf(fp," -pot %s", potfile);
+  fprintf(fp," -o ecrun POSCAR > /dev/null\n");
+  fprintf(fp,"   ./ecrun ${np} > ecrun.log 2>&1\n");
+  fprintf(fp,"   dirs=%c${dirs} ${dir}%c\n   cd ${root}\ndone\n#\n", char(34), char(34));
+  fprintf(fp,"${ECVASP} -kconvc %c${dirs}%c -o kconv.dat\n", char(34), char(34));
+  fprintf(fp,"\ncat kconv.dat\n#\nexit 0\n");
+  fclose(fp);
+
+  char str[MAXLINE];
+  sprintf(str, "chmod +x ./%s", fname);
+  system(str);
 
 return;
 }
 
 /*------------------------------------------------------------------------------
- * To display help info
+ * Method to generate the script to compute the third order elastic constants.
+ * Besides the reference and the +/- states of each Voigt component, which are
+ * those of generate() and are taken from info.dat if it holds all of them at
+ * the same strains, -etoec rather than -e as larger ones suit, the cell is
+ * strained along each pair of components, (+/-)(e_a + e_b); of these, only
+ * one state per orbit of the point group is computed, as the others follow
+ * by symmetry. All states run concurrently, each in its own folder, and their
+ * deformation gradients and stresses are collected into stress.dat, to which
+ * the constants are then fitted by ecvasp -toecfit.
  *------------------------------------------------------------------------------ */
-void Driver::help()
+void Driver::thirdorder()
 {
-  printf("\nCode to generate the script for elastic constants calculations based on vasp.\n");
-  printf("\nUsage:\n    ecvasp [options] [poscar]\n\nAvailable options:\n");
-  printf("    -h       To display this help info;\n");
-  printf("    -e       To define the strain; by default: %g\n", STRAIN);
-  printf("    -xx      To define the strain of eps_{xx}; by default: %g\n", STRAIN);
-  printf("    -yy      To define the strain of eps_{yy}; by default: %g\n", STRAIN);
-  printf("    -zz      To define the strain of eps_{zz}; by default: %g\n", STRAIN);
-  printf("    -xy      To define the strain of eps_{xy}; by default: %g\n", NSRATIO*STRAIN);
-  printf("    -xz      To define the strain of eps_{xz}; by default: %g\n", NSRATIO*STRAIN);
-  printf("    -yz      To define the strain of eps_{yz}; by default: %g\n", NSRATIO*STRAIN);
-  printf("    poscar   POSCAR or CONTCAR of vasp; by default: POSCAR\n");
-  printf("\n\n");
+  FILE *fp = fopen(fname, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return;
+  }
+
+  double Rc[ECV_MAXROT][3][3];
+  int nrot = rotations(Rc);
+
+  // states strained along two components, one per orbit of the point group
+  int npair = 0, pair[60][3];
+  double E[60][3][3];
+  for (int a = 1; a <= 6; ++a)
+  for (int b = a+1; b <= 6; ++b)
+  for (int k = 0; k < 2; ++k){
+    double D[3][3], sgn = k ? -1. : 1.;
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) D[i][j] = double(i == j);
+    ecv_strain_matrix(a, sgn*etoec[a], &D[0][0]);
+    ecv_strain_matrix(b, sgn*etoec[b], &D[0][0]);
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) E[npair][i][j] = 0.5*(D[i][j] + D[j][i]) - double(i == j);
+
+    int equiv = 0;
+    for (int ip = 0; ip < npair && equiv == 0; ++ip)
+    for (int ir = 0; ir < nrot && equiv == 0; ++ir){
+      double dmax = 0.;
+      for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 3; ++j){
+        double r = 0.;
+        for (int m = 0; m < 3; ++m)
+        for (int n = 0; n < 3; ++n) r += Rc[ir][i][m] * E[ip][m][n] * Rc[ir][j][n];
+        dmax = fabs(r - E[npair][i][j]) > dmax ? fabs(r - E[npair][i][j]) : dmax;
+      }
+      if (dmax < 1.e-6) equiv = 1;
+    }
+    if (equiv) continue;
+
+    pair[npair][0] = a; pair[npair][1] = b; pair[npair][2] = k;
+    ++npair;
+  }
+
+  fprintf(fp,"#!/bin/bash\n#\n# Script to compute the second and third order elastic constants based on VASP.\n");
+  fprintf(fp,"#===========================================================================\n");
+  fprintf(fp,"# INCAR, KPOINTS and POTCAR are expected in the current folder. Each state\n");
+  fprintf(fp,"# runs in its own folder T<label>, up to maxjobs at the same time with np\n");
+  fprintf(fp,"# processes each. The reference and the +/- states of each Voigt component\n");
+  fprintf(fp,"# are those of the second order workflow, and are taken from info.dat if it\n");
+  fprintf(fp,"# holds all of them at the strains of -etoec, %g (normal) and %g (shear).\n", etoec[1], etoec[4]);
+  fprintf(fp,"# Of the 30 states strained along two components, %d are computed, one per\n", npair);
+  fprintf(fp,"# orbit of the point group of order %d. The constants are fitted to the\n", nrot);
+  fprintf(fp,"# deformation gradients and stresses collected in stress.dat.\n#\n");
+  fprintf(fp,"# Usage: %s [np] [maxjobs]\n", fname);
+  fprintf(fp,"#===========================================================================\n");
+  fprintf(fp,"if [ %c$#%c -gt %c0%c ]; then\n", char(34), char(34), char(34), char(34));
+  fprintf(fp,"   np=$1\nelse\n   np=2\nfi\n");
+  fprintf(fp,"if [ %c$#%c -gt %c1%c ]; then\n", char(34), char(34), char(34), char(34));
+  fprintf(fp,"   maxjobs=$2\nelse\n   maxjobs=2\nfi\n#\n");
+  fprintf(fp,"if [[ -f %cPOSCAR%c && ! -f \"POSCAR_ini\" ]]; then\n", char(34), char(34));
+  fprintf(fp,"   cp POSCAR POSCAR_ini\nfi\n#\n");
+  writevasp(fp, "${np}");
+  fprintf(fp,"ECVASP=%cecvasp%c\n", char(34), char(34));
+  fprintf(fp,"run_state()\n{\n");
+  fprintf(fp,"   while [ `jobs -rp|wc -l` -ge ${maxjobs} ]; do sleep 10; done\n");
+  fprintf(fp,"   mkdir -p T$1\n   cp INCAR KPOINTS POTCAR T$1/\n   mv POSCAR T$1/POSCAR\n");
+  fprintf(fp,"   echo %cNow to compute state $1 in background%c\n", char(34), char(34));
+  if (perf){
+    fprintf(fp,"   ( cd T$1 && tstart=`date +%%s.%%N` && ${VASP} > vasp.log 2>&1\n");
+    fprintf(fp,"     date +%%s.%%N|awk -v t=${tstart} '{printf \"%%.3f\\n\", $1-t}' > wall ) &\n}\n");
+  } else fprintf(fp,"   ( cd T$1 && ${VASP} > vasp.log 2>&1 ) &\n}\n");
+  fprintf(fp,"get_state()\n{\n");
+  fprintf(fp,"   press=`grep -B1 'external pressure' T$1/OUTCAR|head -1`\n");
+  fprintf(fp,"   eng=`grep 'energy  without' T$1/OUTCAR|tail -1|awk '{print $4}'`\n");
+  fprintf(fp,"   echo $1 $2 `echo ${press}|awk '{print $3,$4,$5,$6,$8,$7}'` ${eng} >> stress.dat\n");
+  if (perf){
+    fprintf(fp,"   wall=`cat T$1/wall`\n");
+    strcpy(grep, "grep");
+    strcpy(outcar, "T$1/OUTCAR");
+    strcpy(oszicar, "T$1/OSZICAR");
+    perfstate(fp, "$1");
+  }
+  fprintf(fp,"}\n");
+  fprintf(fp,"info_state()\n{\n");
+  fprintf(fp,"   awk -v d=$2 -v e=$3 -v s=\"$1 $4\" '$1==d && $2==e && NF>=9{l=s\" \"$3\" \"$4\" \"$5\" \"$6\" \"$7\" \"$8\" \"$9} ");
+  fprintf(fp,"END{if (l != \"\") print l}' info.dat >> stress.dat\n}\n#\n");
+
+  // F = D^T of each state, row major
+  char label[60][8], Fstr[60][MAXLINE];
+  double eps[60];
+  int nstate = 0, idim[60];
+  for (int id = 0; id <= 6; ++id)
+  for (int k = 0; k < 2; ++k){
+    if (id == 0 && k) continue;
+    double D[3][3];
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) D[i][j] = double(i == j);
+    eps[nstate] = 0.;
+    if (id == 0) strcpy(label[nstate], "eq");
+    else {
+      eps[nstate] = k ? -etoec[id] : etoec[id];
+      ecv_strain_matrix(id, eps[nstate], &D[0][0]);
+      sprintf(label[nstate], "%d%c", id, k ? 'n' : 'p');
+    }
+    idim[nstate] = id;
+    int n = 0;
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) n += sprintf(Fstr[nstate]+n, "%s%.10g", n ? " " : "", D[j][i]);
+    ++nstate;
+  }
+  for (int ip = 0; ip < npair; ++ip){
+    int a = pair[ip][0], b = pair[ip][1];
+    double D[3][3], sgn = pair[ip][2] ? -1. : 1.;
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) D[i][j] = double(i == j);
+    ecv_strain_matrix(a, sgn*etoec[a], &D[0][0]);
+    ecv_strain_matrix(b, sgn*etoec[b], &D[0][0]);
+    sprintf(label[nstate], "%d%d%c", a, b, pair[ip][2] ? 'n' : 'p');
+    idim[nstate] = -1;
+    int n = 0;
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) n += sprintf(Fstr[nstate]+n, "%s%.10g", n ? " " : "", D[j][i]);
+    ++nstate;
+  }
+
+  // info.dat is taken only if it holds all the second order states at the
+  // strains of this script, as those of another amplitude do not match
+  char list[MAXLINE];
+  int len = 0;
+  for (int is = 0; is < 13; ++is) len += sprintf(list+len, "%s%d %g", len ? " " : "", idim[is], eps[is]);
+  fprintf(fp,"# The second order states, unless all available in info.dat at the same strains\n");
+  fprintf(fp,"use_info=0\nif [ -f info.dat ]; then\n");
+  fprintf(fp,"   nmiss=`awk -v s=%c%s%c 'BEGIN{n=split(s,a,\" \")} !/^ *#/ && NF>=9{for (i=1; i<n; i+=2) ", char(34), list, char(34));
+  fprintf(fp,"if ($1+0==a[i]+0 && $2+0==a[i+1]+0) f[i]=1} END{m=0; for (i=1; i<n; i+=2) if (!(i in f)) ++m; print m}' info.dat`\n");
+  fprintf(fp,"   if [ ${nmiss} -eq 0 ]; then\n      use_info=1\n   else\n");
+  fprintf(fp,"      echo %cWARNING: ${nmiss} of the 13 second order states missing in info.dat at the strains of -etoec, all recomputed.%c\n", char(34), char(34));
+  fprintf(fp,"   fi\nfi\n");
+  fprintf(fp,"if [ ${use_info} -eq 0 ]; then\n");
+  for (int is = 0; is < 13; ++is){
+    if (idim[is] == 0) writecell(ref, fp);
+    else {
+      strain(idim[is], eps[is]);
+      writecell(strained, fp);
+    }
+    fprintf(fp,"run_state %s\n", label[is]);
+  }
+  fprintf(fp,"fi\n#\n# The states strained along two components\n");
+  for (int is = 13; is < nstate; ++is){
+    int ip = is - 13;
+    double D[3][3], sgn = pair[ip][2] ? -1. : 1.;
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) D[i][j] = double(i == j);
+    ecv_strain_matrix(pair[ip][0], sgn*etoec[pair[ip][0]], &D[0][0]);
+    ecv_strain_matrix(pair[ip][1], sgn*etoec[pair[ip][1]], &D[0][0]);
+    ecv_structure *st = NULL;
+    ecv_deform(ref, &D[0][0], &st);
+    writecell(st, fp);
+    ecv_structure_free(st);
+    fprintf(fp,"run_state %s\n", label[is]);
+  }
+  fprintf(fp,"wait\ncp POSCAR_ini POSCAR\n#\n");
+
+  fprintf(fp,"echo %c# label F11 F12 F13 F21 F22 F23 F31 F32 F33 pxx pyy pzz pxy pxz pyz energy%c > stress.dat\n", char(34), char(34));
+  fprintf(fp,"if [ ${use_info} -eq 1 ]; then\n");
+  for (int is = 0; is < 13; ++is)
+    fprintf(fp,"   info_state %s %d %g %c%s%c\n", label[is], idim[is], eps[is], char(34), Fstr[is], char(34));
+  fprintf(fp,"else\n");
+  for (int is = 0; is < 13; ++is) fprintf(fp,"   get_state %s %c%s%c\n", label[is], char(34), Fstr[is], char(34));
+  fprintf(fp,"fi\n");
+  for (int is = 13; is < nstate; ++is) fprintf(fp,"get_state %s %c%s%c\n", label[is], char(34), Fstr[is], char(34));
+
+  fprintf(fp,"#\n${ECVASP} -toecfit stress.dat -o toec.dat POSCAR\n");
+  if (perf) perfreport(fp);
+  fprintf(fp,"\ncat toec.dat\n#\nexit 0\n");
+  fclose(fp);
+
+  char str[MAXLINE];
+  sprintf(str, "chmod +x ./%s", fname);
+  system(str);
 
-  exit(0);
 return;
 }
 
 /*------------------------------------------------------------------------------
- * Method to count # of words in a string, without destroying the string
+ * Method to generate the script to compute the elastic constants in a single
+ * run of VASP with IBRION = 6 and ISIF = 3, i.e., by the finite differences of
+ * VASP itself, which uses the symmetry of the crystal and includes the ionic
+ * relaxation contribution. The elastic moduli are then read from OUTCAR by
+ * ecvasp -outcar into Cij.dat and info.dat.
  *------------------------------------------------------------------------------ */
-int Driver::count_words(const char *line)
+void Driver::singlerun()
 {
-  int n = strlen(line) + 1;
-  char *copy;
-  memory->create(copy, n, "copy");
-  strcpy(copy,line);
+  FILE *fp = fopen(fname, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return;
+  }
 
-  char *ptr;
-  if (ptr = strchr(copy,'#')) *ptr = '\0';
+  fprintf(fp,"#!/bin/bash\n#\n# Script to compute the elastic constants in a single run of VASP (IBRION = 6).\n");
+  fprintf(fp,"#===========================================================================\n");
+  fprintf(fp,"# INCAR (for static calculations), KPOINTS and POTCAR are expected in the\n");
+  fprintf(fp,"# current folder; IBRION, ISIF, NFREE, POTIM and NSW are overridden for the run\n");
+  fprintf(fp,"# and INCAR is restored afterwards. The strains are chosen by VASP, the ionic\n");
+  fprintf(fp,"# displacements are +/- POTIM (A). The relaxed-ion Cij go to Cij.dat, the\n");
+  fprintf(fp,"# clamped-ion ones and the ionic contribution are reported in info.dat.\n");
+  fprintf(fp,"#===========================================================================\n");
+  fprintf(fp,"if [ %c$#%c -gt %c0%c ]; then\n", char(34), char(34), char(34), char(34));
+  fprintf(fp,"   np=$1\nelse\n   np=2\nfi\n#\n");
+  fprintf(fp,"if [[ -f %cPOSCAR%c && ! -f \"POSCAR_ini\" ]]; then\n", char(34), char(34));
+  fprintf(fp,"   cp POSCAR POSCAR_ini\nfi\n#\n");
+  writevasp(fp, "${np}");
+  fprintf(fp,"ECVASP=%cecvasp%c\n", char(34), char(34));
+  if (scratch) writescratch(fp);
+  if (tune){
+    writetune(fp);
+    fprintf(fp,"set_par 1\n");
+  }
+  fprintf(fp,"#\ncp INCAR INCAR.static\n");
+  fprintf(fp,"grep -v -i -E '^ *(IBRION|ISIF|NFREE|POTIM|NSW) *=' INCAR.static > INCAR\n");
+  fprintf(fp,"printf %cIBRION = 6\\nISIF = 3\\nNFREE = 2\\nPOTIM = 0.015\\nNSW = 1\\n%c >> INCAR\n", char(34), char(34));
+  fprintf(fp,"echo %cThe elastic constants by IBRION = 6 on the as-provided configuration%c\n", char(34), char(34));
+  writepos(ref, fp, "ib6");
+  fprintf(fp,"mv INCAR.static INCAR\n");
+  if (tune) fprintf(fp,"cp INCAR_ini INCAR\n");
+  fprintf(fp,"#\n");
+  fprintf(fp,"echo %c# Information on elastic constants calculations by IBRION = 6, since: `date`%c > info.dat\n", char(34), char(34));
+  fprintf(fp,"${ECVASP} -outcar %s -o Cij.dat >> info.dat\n", outcar);
+  if (perf) perfreport(fp);
+  fprintf(fp,"\ncat info.dat\n");
+  if (scratch == 0) fprintf(fp, "rm -rf CHG* CONTCAR EIGENVAL IBZKPT PCDAT WAVECAR XDATCAR\n");
+  fprintf(fp, "#\nexit 0\n");
+  fclose(fp);
+
+  char str[MAXLINE];
+  sprintf(str, "chmod +x ./%s", fname);
+  system(str);
 
-  if (strtok(copy," \t\n\r\f") == NULL) {
-    memory->sfree(copy);
-    return 0;
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the line that defines how VASP is run, with np processes;
+ * with -pot, the potential stands in for VASP, with np threads.
+ *------------------------------------------------------------------------------ */
+void Driver::writevasp(FILE *fp, const char *np)
+{
+  if (potfile){
+    fprintf(fp,"#\n# The interatomic potential in %s stands in for VASP.\n", potfile);
+    fprintf(fp,"VASP=%cenv OMP_NUM_THREADS=%s ecvasp -calc %s%c\n", char(34), np, potfile, char(34));
+  } else fprintf(fp,"VASP=%cmpirun -np %s v533%c\n", char(34), np, char(34));
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to generate the script to benchmark the single run of IBRION = 6
+ * against the strain set on the same structure: both are generated by ecvasp
+ * with the timings recorded, and run one after the other in bench/multi and
+ * bench/single; their costs and Cij are then compared by ecvasp -benchc. As
+ * IBRION = 6 gives the relaxed-ion constants, the strain set is run with the
+ * ions relaxed as well.
+ *------------------------------------------------------------------------------ */
+void Driver::benchmark()
+{
+  FILE *fp = fopen(fname, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return;
   }
-  n = 1;
-  while (strtok(NULL," \t\n\r\f")) ++n;
 
-  memory->sfree(copy);
-  return n;
+  char opt[MAXLINE];
+  int n = 0;
+  if (scratch) n += sprintf(opt+n, " -scratch -zip %s", zip);
+  if (tune) n += sprintf(opt+n, " -tune");
+  opt[n] = '\0';
+  char pot[MAXLINE];
+  if (potfile) snprintf(pot, MAXLINE, " -pot %s", potfile);
+  else pot[0] = '\0';
+
+  fprintf(fp,"#!/bin/bash\n#\n# Script to benchmark the elastic constants by IBRION = 6 against the strain set.\n");
+  fprintf(fp,"#===========================================================================\n");
+  fprintf(fp,"# INCAR (for static calculations), KPOINTS and POTCAR are expected in the\n");
+  fprintf(fp,"# current folder. The strain set (relaxed ions) runs in bench/multi and the\n");
+  fprintf(fp,"# single run of IBRION = 6 in bench/single, one after the other with np\n");
+  fprintf(fp,"# processes; their timings and Cij are compared in bench.dat.\n#\n");
+  fprintf(fp,"# Usage: %s [np]\n", fname);
+  fprintf(fp,"#===========================================================================\n");
+  fprintf(fp,"if [ %c$#%c -gt %c0%c ]; then\n", char(34), char(34), char(34), char(34));
+  fprintf(fp,"   np=$1\nelse\n   np=2\nfi\n#\n");
+  fprintf(fp,"ECVASP=%cecvasp%c\n", char(34), char(34));
+  fprintf(fp,"for mode in multi single; do\n");
+  fprintf(fp,"   mkdir -p bench/${mode}\n   cp INCAR KPOINTS POTCAR bench/${mode}/\n");
+  fprintf(fp,"   cp %s bench/${mode}/POSCAR\ndone\n#\n", poscar);
+  fprintf(fp,"echo %cNow to compute the elastic constants by the strain set%c\n", char(34), char(34));
+  fprintf(fp,"( cd bench/multi && ${ECVASP} -xx %g -yy %g -zz %g -yz %g -xz %g -xy %g -relax -kspring %g -perf%s%s -o ecrun POSCAR > /dev/null && ./ecrun ${np} > ecrun.log 2>&1 )\n",
+    disp[1], disp[2], disp[3], disp[4], disp[5], disp[6], kspring, opt, pot);
+  fprintf(fp,"echo %cNow to compute the elastic constants by IBRION = 6%c\n", char(34), char(34));
+  fprintf(fp,"( cd bench/single && ${ECVASP} -ibrion6 -perf%s%s -o ecrun POSCAR > /dev/null && ./ecrun ${np} > ecrun.log 2>&1 )\n", opt, pot);
+  fprintf(fp,"#\n${ECVASP} -benchc bench/multi bench/single -o bench.dat\n");
+  fprintf(fp,"\ncat bench.dat\n#\nexit 0\n");
+  fclose(fp);
+
+  char str[MAXLINE];
+  sprintf(str, "chmod +x ./%s", fname);
+  system(str);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the configuration strained by e along Voigt component idim in
+ * strained
+ *------------------------------------------------------------------------------ */
+void Driver::strain(int idim, double e)
+{
+  ecv_structure_free(strained);
+  ecv_strain(ref, idim, e, &strained);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the high precision stage of the multi-fidelity mode: the
+ * results of the cheap run are kept as info_low.dat and Cij_low.dat, the
+ * selected strains are redone with INCAR.high into info_high.dat, and the
+ * corrected Cij.dat is then evaluated by ecvasp -mfc. As the correction takes
+ * central differences of the +/- states, the equilibrium state is not redone.
+ *------------------------------------------------------------------------------ */
+void Driver::highstage(FILE *fp, int laue0)
+{
+  fprintf(fp,"#\n# High precision stage of the multi-fidelity mode\n");
+  fprintf(fp,"mv info.dat info_low.dat\nmv Cij.dat Cij_low.dat\n");
+  fprintf(fp,"cp INCAR.high %s\n", tune ? "INCAR_ini" : "INCAR");
+  fprintf(fp,"echo %c# High precision states of the multi-fidelity mode, since: `date`%c > info_high.dat\n", char(34), char(34));
+
+  char label[8];
+  for (int idim = 1; idim <= 6; ++idim){
+    if (mfcol[idim] == 0) continue;
+    for (int k = 0; k < 2; ++k){
+      double e = k ? -disp[idim] : disp[idim];
+      fprintf(fp,"echo\necho %cHigh precision calculation for eps_%d = %g%c\n", char(34), idim, e, char(34));
+      strain(idim, e);
+      if (tune) fprintf(fp,"set_par %g\n", double(laue0)/double(laue(strained)));
+      sprintf(label, "%d%cH", idim, k ? 'n' : 'p');
+      if (k == 0) writekpts(fp, idim);
+      writepos(strained, fp, label);
+
+      readpress(fp, "");
+      fprintf(fp,"eng=`%s 'energy  without' %s|tail -1|awk '{print $4}'`\n", grep, outcar);
+      fprintf(fp,"mag=`tail -1 %s|grep 'mag'|awk '{print $10}'`\n", oszicar);
+      fprintf(fp,"echo %c%d %g  ${pxx} ${pyy} ${pzz} ${pxy} ${pxz} ${pyz} ${eng} ${mag}%c >> info_high.dat\n", char(34), idim, e, char(34));
+    }
+  }
+  fprintf(fp,"cat info_high.dat\n");
+  fprintf(fp,"cp info_low.dat info.dat\n");
+  fprintf(fp,"${ECVASP} -mfc info_low.dat info_high.dat -o Cij.dat >> info.dat\n");
+  fprintf(fp,"\ncat info.dat\n\n");
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write one frame of the dump file to a new file
+ *------------------------------------------------------------------------------ */
+void Driver::writepos(const ecv_structure *s, FILE *fp, const char *label)
+{
+  writecell(s, fp);
+  runstate(fp, label);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the lines that run VASP for state label on the POSCAR present
+ *------------------------------------------------------------------------------ */
+void Driver::runstate(FILE *fp, const char *label)
+{
+  if (perf) fprintf(fp,"tstart=`date +%%s.%%N`\n");
+  if (scratch) fprintf(fp,"cat POSCAR\n# Now to do the calculations\nrun_vasp %s\n", label);
+  else fprintf(fp,"cat POSCAR\n# Now to do the calculations\nrm -rf WAVECAR\n${VASP}\n");
+
+  source(label);
+  if (perf){
+    fprintf(fp,"wall=`date +%%s.%%N|awk -v t=${tstart} '{printf \"%%.3f\", $1-t}'`\n");
+    perfstate(fp, label);
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the relaxed-ion stage of the state strained by e along Voigt
+ * component idim, just computed with the ions clamped: its stresses go to
+ * info_clamped.dat, and the ions are then relaxed from the positions guessed
+ * by ecvasp -predict for e > 0, or -mirror for e < 0; should the guess fail,
+ * the clamped positions are kept as the start.
+ *------------------------------------------------------------------------------ */
+void Driver::relaxpos(FILE *fp, int idim, double e, const char *label)
+{
+  readpress(fp, "");
+  fprintf(fp,"eng=`%s 'energy  without' %s|tail -1|awk '{print $4}'`\n", grep, outcar);
+  fprintf(fp,"mag=`tail -1 %s|grep 'mag'|awk '{print $10}'`\n", oszicar);
+  fprintf(fp,"echo %c%d %g  ${pxx} ${pyy} ${pzz} ${pxy} ${pxz} ${pyz} ${eng} ${mag}%c >> info_clamped.dat\n", char(34), idim, e, char(34));
+
+  fprintf(fp,"# Now to relax the ions\ncp POSCAR POSCAR.%s\n", label);
+  if (e > 0.) fprintf(fp,"${ECVASP} -predict %s %s -kspring %g -o POSCAR POSCAR.%s\n",
+    scratch ? "states/OUTCAR.eq.${ZEXT}" : "OUTCAR.eq", outcar, kspring, label);
+  else if (scratch) fprintf(fp,"${ECVASP} -mirror POSCAR.%dp states/CONTCAR.%dpR -o POSCAR POSCAR.%s\n", idim, idim, label);
+  else fprintf(fp,"${ECVASP} -mirror POSCAR.%dp CONTCAR.%dp -o POSCAR POSCAR.%s\n", idim, idim, label);
+
+  fprintf(fp,"cp INCAR INCAR.static\n");
+  fprintf(fp,"grep -v -i -E '^ *(ISIF|IBRION|NSW|EDIFFG) *=' INCAR.static > INCAR\n");
+  fprintf(fp,"printf %cISIF = 2\\nIBRION = 1\\nNSW = 60\\nEDIFFG = -1.e-3\\n%c >> INCAR\n", char(34), char(34));
+  char str[16];
+  sprintf(str, "%sR", label);
+  runstate(fp, str);
+  fprintf(fp,"mv INCAR.static INCAR\n");
+  if (scratch == 0 && e > 0.) fprintf(fp,"cp CONTCAR CONTCAR.%s\n", label);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the lines that extract the stress components of the state
+ * just computed into pxx<sfx>, pyy<sfx>, ...
+ *------------------------------------------------------------------------------ */
+void Driver::readpress(FILE *fp, const char *sfx)
+{
+  // the last ionic step, in case of relaxation
+  if (relax) fprintf(fp,"press=`%s -B1 'external pressure' %s|tail -2|head -1`\n", grep, outcar);
+  else fprintf(fp,"press=`%s -B1 'external pressure' %s|head -1`\n", grep, outcar);
+  fprintf(fp,"pxx%s=`echo ${press}|awk '{print $3}'`\n", sfx);
+  fprintf(fp,"pyy%s=`echo ${press}|awk '{print $4}'`\n", sfx);
+  fprintf(fp,"pzz%s=`echo ${press}|awk '{print $5}'`\n", sfx);
+  fprintf(fp,"pxy%s=`echo ${press}|awk '{print $6}'`\n", sfx);
+  fprintf(fp,"pyz%s=`echo ${press}|awk '{print $7}'`\n", sfx);
+  fprintf(fp,"pxz%s=`echo ${press}|awk '{print $8}'`\n", sfx);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the lines that record the timings of the state just computed
+ * into perf.dat: wall time (set by the caller in ${wall}), CPU time, number of
+ * SCF iterations, sum of the LOOP+ timings and max RSS.
+ *------------------------------------------------------------------------------ */
+void Driver::perfstate(FILE *fp, const char *label)
+{
+  fprintf(fp,"cpu=`%s 'Total CPU time used' %s|tail -1|awk '{print $NF}'`\n", grep, outcar);
+  fprintf(fp,"rss=`%s 'Maximum memory used' %s|tail -1|awk '{print $NF}'`\n", grep, outcar);
+  fprintf(fp,"nscf=`grep -c -E '^(DAV|RMM|CG|SDA|DIA|EDWAV):' %s`\n", oszicar);
+  fprintf(fp,"loop=`%s 'LOOP+' %s|awk '{c+=$4; r+=$NF} END{printf \"%%.3f %%.3f\", c, r}'`\n", grep, outcar);
+  fprintf(fp,"echo \"%s ${wall} ${cpu:-0} ${nscf:-0} ${loop} ${rss:-0}\" >> perf.dat\n", label);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the lines that report the timings in perf.dat at the end
+ *------------------------------------------------------------------------------ */
+void Driver::perfreport(FILE *fp)
+{
+  fprintf(fp,"${ECVASP} -report perf.dat -o perf\n");
+  fprintf(fp,"if [ -n \"${PROMDIR}\" ]; then\n");
+  fprintf(fp,"   cp perf.prom ${PROMDIR}/.ecvasp.$$ && mv ${PROMDIR}/.ecvasp.$$ ${PROMDIR}/ecvasp_`basename ${PWD}`.prom\n");
+  fprintf(fp,"fi\n");
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to start timing a phase of ecvasp, if asked for
+ *------------------------------------------------------------------------------ */
+void Driver::timing(const char *name)
+{
+  if (timer) timer->start(name);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the here-document that creates the POSCAR of configuration s
+ *------------------------------------------------------------------------------ */
+void Driver::writecell(const ecv_structure *s, FILE *fp)
+{
+  size_t need = 0;
+  ecv_structure_write(s, NULL, 0, &need);
+  if (need < 1) return;
+  char *buf = new char [need];
+  ecv_structure_write(s, buf, need, NULL);
+  fprintf(fp,"cat > POSCAR << EOF\n%sEOF\n", buf);
+  delete []buf;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the here-document that creates the explicit KPOINTS for the
+ * reference state (idim = 0), or for both the +e and -e states of Voigt
+ * component idim, reduced by the rotations common to the two strained cells
+ *------------------------------------------------------------------------------ */
+void Driver::writekpts(FILE *fp, int idim)
+{
+  if (kdens <= 0.) return;
+  if (kmesh == NULL) kmesh = new KMesh(ecv_structure_cell(ref), kdens);
+
+  double lat[2][3][3];
+  int nlat = idim ? 2 : 1;
+  for (int k = 0; k < nlat; ++k){
+    ecv_structure *st = NULL;
+    if (idim) ecv_strain(ref, idim, k ? -disp[idim] : disp[idim], &st);
+    ecv_structure_lattice(idim ? st : ref, &lat[k][0][0]);
+    ecv_structure_free(st);
+  }
+  kmesh->reduce(lat, nlat);
+
+  char label[16];
+  if (idim) sprintf(label, "%dp and %dn", idim, idim);
+  else strcpy(label, "eq");
+  fprintf(fp,"cat > KPOINTS << EOF\n");
+  kmesh->write(fp, label);
+  fprintf(fp,"EOF\n");
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the function run_vasp that runs a state in node-local
+ * scratch and archives its outputs in folder states
+ *------------------------------------------------------------------------------ */
+void Driver::writescratch(FILE *fp)
+{
+  fprintf(fp,"#\n# Each state runs in node-local scratch; only the outputs needed are copied\n");
+  fprintf(fp,"# back into folder states, with OUTCAR and vasprun.xml compressed by %s.\n", zip);
+  fprintf(fp,"ZIP=%c%s -q -c%c\n", char(34), zip, char(34));
+  fprintf(fp,"ZGREP=%c%s%c\n", char(34), strcmp(zip, "zstd") ? "zgrep" : "zstdgrep", char(34));
+  fprintf(fp,"ZEXT=%c%s%c\n", char(34), strcmp(zip, "zstd") ? "gz" : "zst", char(34));
+  fprintf(fp,"SCRATCH=${TMPDIR:-/tmp}/ecvasp.$$\n");
+  fprintf(fp,"mkdir -p ${SCRATCH} states\n");
+  fprintf(fp,"trap %crm -rf ${SCRATCH}%c EXIT\n", char(34), char(34));
+  fprintf(fp,"run_vasp()\n{\n");
+  fprintf(fp,"   rm -rf ${SCRATCH}/*\n");
+  fprintf(fp,"   cp INCAR KPOINTS POTCAR POSCAR ${SCRATCH}/\n");
+  fprintf(fp,"   (cd ${SCRATCH} && ${VASP})\n");
+  fprintf(fp,"   ${ZIP} ${SCRATCH}/OUTCAR > states/OUTCAR.$1.${ZEXT}\n");
+  fprintf(fp,"   [ -f ${SCRATCH}/vasprun.xml ] && ${ZIP} ${SCRATCH}/vasprun.xml > states/vasprun.$1.xml.${ZEXT}\n");
+  fprintf(fp,"   cp ${SCRATCH}/OSZICAR states/OSZICAR.$1\n");
+  if (relax) fprintf(fp,"   cp ${SCRATCH}/CONTCAR states/CONTCAR.$1\n");
+  fprintf(fp,"   rm -rf ${SCRATCH}/*\n}\n");
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the stage that tunes the number of MPI ranks, NCORE and
+ * KPAR: the equilibrium cell is run for a few SCF steps under each candidate
+ * setting and the one with the least time per SCF step is taken. The timings
+ * go to tune.dat, the choice to ~/.ecvasp/tune.db, which is looked up first
+ * for a previous choice on the same number of cores and a similar number of
+ * atoms. Function set_par then writes the INCAR for each state, with KPAR
+ * scaled by the ratio of the estimated number of irreducible k-points of the
+ * state to that of the equilibrium one, which is the ratio of the orders of
+ * their Laue groups.
+ *------------------------------------------------------------------------------ */
+void Driver::writetune(FILE *fp)
+{
+  fprintf(fp,"#\n# Tuning of the parallel settings\n");
+  int natom = 0;
+  ecv_structure_natom(ref, &natom);
+  fprintf(fp,"natom=%d\n", natom);
+  fprintf(fp,"TUNEDB=${HOME}/.ecvasp/tune.db\n");
+  fprintf(fp,"if [ ! -f INCAR_ini ]; then\n   cp INCAR INCAR_ini\nfi\n");
+  fprintf(fp,"set_incar()\n{\n");
+  fprintf(fp,"   grep -v -i -E '^ *(NCORE|NPAR|KPAR) *=' INCAR_ini > INCAR\n");
+  fprintf(fp,"   echo %cNCORE = $1%c >> INCAR\n", char(34), char(34));
+  fprintf(fp,"   echo %cKPAR  = $2%c >> INCAR\n}\n", char(34), char(34));
+  fprintf(fp,"set_par()\n{\n");
+  fprintf(fp,"   kp=`echo ${kpar} $1 ${nkeq} $((ranks/ncore))|awk '{t=$1*$2; if ($3>0 && t>$3*$2) t=$3*$2; ");
+  fprintf(fp,"k=1; for (d=1; d<=$4; ++d) if ($4%%d==0 && d<=t) k=d; print k}'`\n");
+  fprintf(fp,"   set_incar ${ncore} ${kp}\n}\n");
+  fprintf(fp,"best=`awk -v n=${natom} -v np=${np} '!/^#/ && $1==np && $2>=0.8*n && $2<=1.25*n {l=$0} END{print l}' ${TUNEDB} 2> /dev/null`\n");
+  fprintf(fp,"if [ -n %c${best}%c ]; then\n", char(34), char(34));
+  fprintf(fp,"   echo %cParallel settings taken from ${TUNEDB}: ${best}%c\n", char(34), char(34));
+  fprintf(fp,"else\n");
+  fprintf(fp,"   echo %cTuning the parallel settings on the equilibrium configuration%c\n", char(34), char(34));
+  writecell(ref, fp);
+  fprintf(fp,"   echo %c# np ranks NCORE KPAR NKPTS time_per_SCF_step(s)%c > tune.dat\n", char(34), char(34));
+  fprintf(fp,"   for ranks in ${np} $((np/2)); do\n");
+  fprintf(fp,"      [ ${ranks} -lt 1 ] && continue\n");
+  fprintf(fp,"      for ncore in 1 2 4 8; do\n");
+  fprintf(fp,"         for kpar in 1 2 4; do\n");
+  fprintf(fp,"            [ $((ranks %% (ncore*kpar))) -ne 0 ] && continue\n");
+  fprintf(fp,"            set_incar ${ncore} ${kpar}\n");
+  fprintf(fp,"            grep -v -i -E '^ *(NELM|NELMIN|NELMDL|NSW|IBRION|LWAVE|LCHARG) *=' INCAR > INCAR.tmp\n");
+  fprintf(fp,"            mv INCAR.tmp INCAR\n");
+  fprintf(fp,"            printf %cNELM = 5\\nNELMIN = 5\\nNELMDL = -1\\nNSW = 0\\nIBRION = -1\\nLWAVE = .FALSE.\\nLCHARG = .FALSE.\\n%c >> INCAR\n", char(34), char(34));
+  fprintf(fp,"            rm -rf WAVECAR OUTCAR\n");
+  fprintf(fp,"            mpirun -np ${ranks} v533 > /dev/null 2>&1\n");
+  fprintf(fp,"            t=`grep 'LOOP:' OUTCAR 2> /dev/null|awk 'NR>1{s+=$NF; ++n} END{if (n>0) printf %c%%g%c, s/n}'`\n", char(34), char(34));
+  fprintf(fp,"            nk=`grep 'NKPTS =' OUTCAR 2> /dev/null|head -1|awk '{print $4}'`\n");
+  fprintf(fp,"            [ -n %c${t}%c ] && echo %c${np} ${ranks} ${ncore} ${kpar} ${nk} ${t}%c >> tune.dat\n", char(34), char(34), char(34), char(34));
+  fprintf(fp,"         done\n      done\n   done\n");
+  fprintf(fp,"   cat tune.dat\n");
+  fprintf(fp,"   best=`awk '!/^#/' tune.dat|sort -g -k6|head -1|awk -v n=${natom} -v d=$(date +%%F) '{print $1, n, $5, $2, $3, $4, $6, d}'`\n");
+  fprintf(fp,"   if [ -n %c${best}%c ]; then\n", char(34), char(34));
+  fprintf(fp,"      mkdir -p `dirname ${TUNEDB}`\n");
+  fprintf(fp,"      [ -f ${TUNEDB} ] || echo %c# np natom NKPTS ranks NCORE KPAR time_per_SCF_step(s) date%c > ${TUNEDB}\n", char(34), char(34));
+  fprintf(fp,"      echo ${best} >> ${TUNEDB}\n");
+  fprintf(fp,"      echo %c# chosen: ${best}%c >> tune.dat\n", char(34), char(34));
+  fprintf(fp,"   else\n      best=%c${np} ${natom} 0 ${np} 1 1 0%c\n   fi\n", char(34), char(34));
+  fprintf(fp,"   rm -rf OUTCAR OSZICAR CHG* EIGENVAL IBZKPT PCDAT vasprun.xml XDATCAR CONTCAR DOSCAR\nfi\n");
+  fprintf(fp,"set -- ${best}\nnkeq=$3; ranks=$4; ncore=$5; kpar=$6\n");
+  fprintf(fp,"echo %cParallel settings: ranks = ${ranks}, NCORE = ${ncore}, KPAR = ${kpar}%c\n", char(34), char(34));
+  fprintf(fp,"VASP=%cmpirun -np ${ranks} v533%c\n", char(34), char(34));
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write function check_state of the incremental analysis, called
+ * after each strained state: the states in info.dat so far are checked by
+ * ecvasp -incc, with the partial Cij and the checks written to partial.dat,
+ * and the script is aborted if any check fails.
+ *------------------------------------------------------------------------------ */
+void Driver::writecheck(FILE *fp)
+{
+  fprintf(fp,"#\n# Incremental analysis: after each strained state, the Cij columns available are\n");
+  fprintf(fp,"# checked for sign, +/- consistency, Cij/Cji mismatch and the Born criteria that\n");
+  fprintf(fp,"# can be evaluated, with a relative tolerance of %g, and reported in partial.dat;\n", tol);
+  fprintf(fp,"# the remaining states are aborted once a check fails.\n");
+  if (mf == 0 && perf == 0 && relax == 0) fprintf(fp,"ECVASP=%cecvasp%c\n", char(34), char(34));
+  fprintf(fp,"check_state()\n{\n");
+  fprintf(fp,"   ${ECVASP} -incc info.dat -tol %g -o partial.dat > /dev/null\n", tol);
+  fprintf(fp,"   if [ $? -eq 2 ]; then\n");
+  fprintf(fp,"      echo %cChecks failed on the states so far, the remaining ones are aborted:%c\n", char(34), char(34));
+  fprintf(fp,"      cat partial.dat\n");
+  if (tune) fprintf(fp,"      cp INCAR_ini INCAR\n");
+  fprintf(fp,"      exit 1\n   fi\n}\n");
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to evaluate the order of the Laue group of configuration s, used to
+ * estimate the number of irreducible k-points
+ *------------------------------------------------------------------------------ */
+int Driver::laue(const ecv_structure *s)
+{
+  int nrot = 0, n = 1;
+  ecv_structure_symmetry(s, 1.e-3, &nrot, &n, NULL);
+
+return n;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the rotations of the point group of the configuration read,
+ * in Cartesian coordinates; returns the order of the group.
+ *------------------------------------------------------------------------------ */
+int Driver::rotations(double Rc[][3][3])
+{
+  int n = 0;
+  ecv_structure_symmetry(ref, 1.e-3, &n, NULL, &Rc[0][0][0]);
+
+return n;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to define where the script reads the outputs of state label from:
+ * in the submission folder, or the compressed ones archived in folder states
+ *------------------------------------------------------------------------------ */
+void Driver::source(const char *label)
+{
+  if (scratch){
+    strcpy(grep, "${ZGREP}");
+    sprintf(outcar, "states/OUTCAR.%s.${ZEXT}", label);
+    sprintf(oszicar, "states/OSZICAR.%s", label);
+  } else {
+    strcpy(grep, "grep");
+    strcpy(outcar, "OUTCAR");
+    strcpy(oszicar, "OSZICAR");
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to evaluate the directional elastic properties from the Cij matrix
+ *------------------------------------------------------------------------------ */
+void Driver::surface()
+{
+  Elastic *elastic = new Elastic();
+  if ( elastic->read(cijfile) ){
+    delete elastic;
+    return;
+  }
+
+  if (rho < ZERO){
+    FILE *fp = fopen(poscar, "r");
+    if (fp){
+      fclose(fp);
+      if (readpos() == 0 && ecv_structure_density(ref, &rho) != ECV_OK)
+        printf("\nWARNING: element names missing or unknown in %s, mass density not evaluated.\n", poscar);
+    }
+  }
+
+  Surface *surf = new Surface(elastic, rho);
+  surf->compute(ngrid[0], ngrid[1], fname);
+
+  delete surf;
+  delete elastic;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to average the single crystal Cij over the orientations of the grains
+ * of a textured polycrystal; the report goes to screen, and to file fname if set.
+ *------------------------------------------------------------------------------ */
+void Driver::texture()
+{
+  Elastic *elastic = new Elastic();
+  if ( elastic->read(texfile[0]) == 0 ){
+    Texture *tex = new Texture(elastic);
+    if (tex->compute(texfile[1]) == 0){
+      tex->output(stdout);
+      if (fname) tex->write(fname);
+    }
+    delete tex;
+  }
+  delete elastic;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to estimate the uncertainties of Cij and the derived moduli
+ *------------------------------------------------------------------------------ */
+void Driver::uncertainty()
+{
+  Elastic *elastic = new Elastic();
+  if ( elastic->read_info(infofile) == 0 ){
+    Bootstrap *boot = new Bootstrap(elastic);
+    boot->run(nsample, noise, seed, fname);
+    delete boot;
+  }
+  delete elastic;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to correct the Cij from cheap calculations by those states redone at
+ * high precision; the report goes to screen, the corrected Cij to file fname
+ * if set.
+ *------------------------------------------------------------------------------ */
+void Driver::fidelity()
+{
+  Elastic *low = new Elastic();
+  Elastic *high = new Elastic();
+  status = 1;
+  int nmiss = low->load_info(lowfile);
+  if (nmiss > 0) printf("\nERROR: %d of the 12 strained states are missing in %s!\n", nmiss, lowfile);
+
+  if (nmiss == 0 && high->load_info(highfile) >= 0){
+    Fidelity *mfc = new Fidelity(low, high);
+    if (mfc->correct() == 0){
+      mfc->output(stdout);
+      if (fname) mfc->write(fname);
+      status = 0;
+    }
+    delete mfc;
+  }
+  delete high;
+  delete low;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to fit the second and third order elastic constants to the states in
+ * stress.dat, augmented by the point group of poscar; the report goes to
+ * screen and to file fname.
+ *------------------------------------------------------------------------------ */
+void Driver::toecfit()
+{
+  if ( readpos() ) return;
+  double Rc[ECV_MAXROT][3][3];
+  int nrot = rotations(Rc);
+
+  Toec *fit = new Toec();
+  if (fit->read(toecfile) == 0){
+    fit->symmetry(nrot, Rc);
+    if (fit->fit() == 0){
+      fit->output(stdout);
+      fit->write(fname);
+    }
+  }
+  delete fit;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to set the starting positions of the ionic relaxation of the clamped
+ * strained cell in poscar, predicted from the forces by -predict, or mirrored
+ * from the relaxation of the opposite strain by -mirror; written to fname.
+ *------------------------------------------------------------------------------ */
+void Driver::guess()
+{
+  status = 1;
+  ecv_structure *s = NULL;
+  Relax *rlx = new Relax();
+  int flag = ecv_structure_read(poscar, &s);
+  if (flag == ECV_OK){
+    if (forcefile[0]) flag = rlx->predict(ecv_structure_cell(s), forcefile[0], forcefile[1], kspring);
+    else {
+      ecv_structure *clamped = NULL, *relaxed = NULL;
+      flag = ecv_structure_read(mirrorfile[0], &clamped);
+      if (flag == ECV_OK) flag = ecv_structure_read(mirrorfile[1], &relaxed);
+      if (flag == ECV_OK) flag = rlx->mirror(ecv_structure_cell(s), ecv_structure_cell(clamped), ecv_structure_cell(relaxed));
+      ecv_structure_free(relaxed);
+      ecv_structure_free(clamped);
+    }
+  }
+
+  if (flag == ECV_OK){
+    size_t need = 0;
+    ecv_structure_write(s, NULL, 0, &need);
+    char *buf = new char [need];
+    ecv_structure_write(s, buf, need, NULL);
+    FILE *fp = fopen(fname, "w");
+    if (fp){
+      fputs(buf, fp);
+      fclose(fp);
+      printf("Starting positions written to %s, max displacement: %g A\n", fname, rlx->umax);
+      status = 0;
+    } else printf("\nERROR: cannot open file %s for writting!\n", fname);
+    delete []buf;
+
+  } else printf("\nERROR: %s, starting positions not set!\n", ecv_strerror(flag));
+
+  delete rlx;
+  ecv_structure_free(s);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to compare the relaxed-ion constants with the clamped-ion ones, i.e.,
+ * to get the internal strain contribution; the report goes to screen, and to
+ * file fname if set.
+ *------------------------------------------------------------------------------ */
+void Driver::relaxed()
+{
+  status = 1;
+  Elastic *clamped = new Elastic();
+  Elastic *relaxed = new Elastic();
+  if (clamped->read_info(clampfile) == 0 && relaxed->read_info(relaxfile) == 0){
+    Relax *rlx = new Relax();
+    rlx->output(stdout, clamped, relaxed);
+    status = 0;
+    if (fname){
+      FILE *fp = fopen(fname, "w");
+      if (fp){
+        rlx->output(fp, clamped, relaxed);
+        fclose(fp);
+      } else {
+        printf("\nERROR: cannot open file %s for writting!\n", fname);
+        status = 1;
+      }
+    }
+    delete rlx;
+  }
+  delete relaxed;
+  delete clamped;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read the elastic moduli computed by VASP with IBRION = 6 from its
+ * OUTCAR; the report goes to screen, the relaxed-ion Cij to file fname if set.
+ *------------------------------------------------------------------------------ */
+void Driver::readmoduli()
+{
+  status = 1;
+  Elastic *total = new Elastic();
+  double ion[6][6];
+  if (total->read_outcar(modfile, ion) == 0){
+    status = 0;
+    double dmax = 0.;
+    for (int i = 0; i < 6; ++i)
+    for (int j = 0; j < 6; ++j) dmax = fabs(ion[i][j]) > dmax ? fabs(ion[i][j]) : dmax;
+
+    if (dmax > ZERO){
+      Elastic *clamped = new Elastic();
+      for (int i = 0; i < 6; ++i)
+      for (int j = 0; j < 6; ++j) clamped->C[i][j] = total->C[i][j] - ion[i][j];
+      if (clamped->compliance() == 0){
+        Relax *rlx = new Relax();
+        rlx->output(stdout, clamped, total);
+        delete rlx;
+      } else status = 1;
+      delete clamped;
+
+    } else total->output(stdout);
+
+    if (fname && total->write(fname)) status = 1;
+  }
+  delete total;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to compare the cost and Cij of the strain set in folder benchdir[0]
+ * with those of the single run of IBRION = 6 in benchdir[1], from the perf.dat
+ * and Cij.dat of each; the report goes to screen, and to file fname if set.
+ *------------------------------------------------------------------------------ */
+void Driver::benchcmp()
+{
+  Perf *perfs[2];
+  Elastic *cij[2];
+  double total[2][NPERF];
+  int nstate[2], flag = 0;
+  char str[MAXLINE];
+  for (int k = 0; k < 2; ++k){
+    perfs[k] = new Perf();
+    cij[k] = new Elastic();
+    sprintf(str, "%s/perf.dat", benchdir[k]);
+    flag += perfs[k]->read(str);
+    nstate[k] = perfs[k]->totals(total[k]);
+    sprintf(str, "%s/Cij.dat", benchdir[k]);
+    flag += cij[k]->read(str);
+  }
+
+  FILE *fp = NULL;
+  if (flag == 0 && fname) fp = fopen(fname, "w");
+  for (int ip = 0; flag == 0 && ip < 2; ++ip){
+    FILE *out = ip ? fp : stdout;
+    if (out == NULL) continue;
+
+    fprintf(out, "# Benchmark of the strain set (%s) against IBRION = 6 (%s)\n", benchdir[0], benchdir[1]);
+    fprintf(out, "# %-18s %14s %14s %10s\n", "quantity", "strain set", "IBRION = 6", "ratio");
+    fprintf(out, "  %-18s %14d %14d %10.3f\n", "vasp_runs", nstate[0], nstate[1], nstate[1] ? double(nstate[0])/double(nstate[1]) : 0.);
+    for (int i = 0; i < NPERF; ++i)
+      fprintf(out, "  %-18s %14.6g %14.6g %10.3f\n", Perf::name(i), total[0][i], total[1][i],
+        fabs(total[1][i]) > ZERO ? total[0][i]/total[1][i] : 0.);
+
+    double dmax = 0.;
+    fprintf(out, "# Cij of the strain set minus those of IBRION = 6 (GPa):\n");
+    for (int i = 0; i < 6; ++i){
+      for (int j = 0; j < 6; ++j){
+        double d = cij[0]->C[i][j] - cij[1]->C[i][j];
+        dmax = fabs(d) > dmax ? fabs(d) : dmax;
+        fprintf(out, " %10.2f", d);
+      }
+      fprintf(out, "\n");
+    }
+    fprintf(out, "# Max deviation: %g GPa\n", dmax);
+
+    double m[2][NMOD];
+    for (int k = 0; k < 2; ++k) cij[k]->moduli(cij[k]->C, cij[k]->S, m[k]);
+    fprintf(out, "# Derived moduli:   strain set   IBRION = 6   difference\n");
+    for (int k = 0; k < NMOD; ++k)
+      fprintf(out, "#   %-8s = %12g %12g %12g\n", Elastic::modname[k], m[0][k], m[1][k], m[0][k] - m[1][k]);
+  }
+  if (fp) fclose(fp);
+
+  for (int k = 0; k < 2; ++k){
+    delete perfs[k];
+    delete cij[k];
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to compare the Cij of the k-point convergence series in the folders
+ * listed in kconvdir, from the coarsest to the densest mesh, against those of
+ * the densest; the mesh of each is read from the first line of its KPOINTS.
+ * The series is converged from the first folder whose Cij and those of all the
+ * denser ones are within KCONV of the largest C of the densest mesh.
+ *------------------------------------------------------------------------------ */
+void Driver::kconvcmp()
+{
+  status = 1;
+  char *str = new char [strlen(kconvdir)+1];
+  strcpy(str, kconvdir);
+  int ndir = 0;
+  char *dirs[MAXLINE];
+  char *ptr = strtok(str, " ,;\t");
+  while (ptr && ndir < MAXLINE){
+    dirs[ndir++] = ptr;
+    ptr = strtok(NULL, " ,;\t");
+  }
+  if (ndir < 2){
+    printf("\nERROR: at least two folders are needed for -kconvc!\n");
+    delete []str;
+    return;
+  }
+
+  Elastic **cij = new Elastic* [ndir];
+  int (*mesh)[3] = new int [ndir][3];
+  int flag = 0;
+  char line[MAXLINE];
+  for (int k = 0; k < ndir; ++k){
+    cij[k] = new Elastic();
+    sprintf(line, "%s/Cij.dat", dirs[k]);
+    flag += cij[k]->read(line);
+
+    mesh[k][0] = mesh[k][1] = mesh[k][2] = 0;
+    sprintf(line, "%s/KPOINTS", dirs[k]);
+    FILE *fp = fopen(line, "r");
+    if (fp){
+      if (fgets(line, MAXLINE, fp)) sscanf(line, "Mesh %d x %d x %d", &mesh[k][0], &mesh[k][1], &mesh[k][2]);
+      fclose(fp);
+    }
+  }
+
+  // from the coarsest to the densest mesh, whatever the order given; the
+  // densest one is the reference
+  for (int k = 1; k < ndir; ++k)
+  for (int l = k; l > 0 && mesh[l][0]*mesh[l][1]*mesh[l][2] < mesh[l-1][0]*mesh[l-1][1]*mesh[l-1][2]; --l){
+    char *d = dirs[l]; dirs[l] = dirs[l-1]; dirs[l-1] = d;
+    Elastic *e = cij[l]; cij[l] = cij[l-1]; cij[l-1] = e;
+    for (int i = 0; i < 3; ++i){
+      int n = mesh[l][i]; mesh[l][i] = mesh[l-1][i]; mesh[l-1][i] = n;
+    }
+  }
+
+  double cmax = 0., dmax[MAXLINE], m[NMOD];
+  Elastic *dense = cij[ndir-1];
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) cmax = fabs(dense->C[i][j]) > cmax ? fabs(dense->C[i][j]) : cmax;
+  for (int k = 0; k < ndir; ++k){
+    dmax[k] = 0.;
+    for (int i = 0; i < 6; ++i)
+    for (int j = 0; j < 6; ++j){
+      double d = fabs(cij[k]->C[i][j] - dense->C[i][j]);
+      dmax[k] = d > dmax[k] ? d : dmax[k];
+    }
+  }
+  int conv = ndir-1;
+  while (conv > 0 && dmax[conv-1] <= KCONV*cmax) --conv;
+
+  FILE *fp = NULL;
+  if (flag == 0 && fname) fp = fopen(fname, "w");
+  for (int ip = 0; flag == 0 && ip < 2; ++ip){
+    FILE *out = ip ? fp : stdout;
+    if (out == NULL) continue;
+
+    fprintf(out, "# Convergence of Cij (GPa) against the k-point density, relative to %s\n", dirs[ndir-1]);
+    fprintf(out, "# %-12s %-12s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n", "folder", "mesh",
+      "C11", "C22", "C33", "C12", "C13", "C23", "C44", "C55", "C66", "KVRH", "GVRH", "dCmax", "dC/C");
+    for (int k = 0; k < ndir; ++k){
+      char nk[32];
+      sprintf(nk, "%dx%dx%d", mesh[k][0], mesh[k][1], mesh[k][2]);
+      double (*C)[6] = cij[k]->C;
+      cij[k]->moduli(cij[k]->C, cij[k]->S, m);
+      fprintf(out, "  %-12s %-12s %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8.3f %8.5f\n",
+        dirs[k], nk, C[0][0], C[1][1], C[2][2], C[0][1], C[0][2], C[1][2], C[3][3], C[4][4], C[5][5],
+        m[2], m[5], dmax[k], cmax > ZERO ? dmax[k]/cmax : 0.);
+    }
+    if (conv < ndir-1) fprintf(out, "# Converged to %g of the largest C from %s on.\n", KCONV, dirs[conv]);
+    else fprintf(out, "# Not converged to %g of the largest C within the series; denser meshes are needed.\n", KCONV);
+  }
+  if (fp) fclose(fp);
+  if (flag == 0) status = 0;
+
+  for (int k = 0; k < ndir; ++k) delete cij[k];
+  delete []cij;
+  delete []mesh;
+  delete []str;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to check the strained states available in incfile, i.e., an info.dat
+ * being written by the script; the partial Cij and the checks go to screen,
+ * and to file fname if set. The exit status is 2 if any check fails, so that
+ * the script can abort the remaining states, or 1 if the file cannot be used.
+ *------------------------------------------------------------------------------ */
+void Driver::incremental()
+{
+  status = 1;
+  Elastic *elastic = new Elastic();
+  if (elastic->load_info(incfile) >= 0){
+    Monitor *mon = new Monitor(elastic);
+    int nfail = mon->check(tol);
+    if (nfail >= 0){
+      mon->output(stdout);
+      if (fname) mon->write(fname);
+      status = nfail > 0 ? 2 : 0;
+    }
+    delete mon;
+  }
+  delete elastic;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to compute poscar by the potential in calcfile in place of VASP, as
+ * INCAR asks, into OUTCAR, OSZICAR and CONTCAR of the current folder
+ *------------------------------------------------------------------------------ */
+void Driver::calc()
+{
+  Calculator *pot = new Calculator();
+  status = 1;
+  if (pot->read(calcfile) == 0 && pot->run(poscar, "INCAR") == 0) status = 0;
+  delete pot;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to pre-screen the strains of the script by the potential in
+ * screenfile: C is computed, with the same deformations as the script, at
+ * 1/4 to 4 times the strains set, with the ions relaxed if -relax is set. The
+ * change from half the strain and the +/- asymmetry, both relative to the
+ * largest C, show where the response stops being linear. The report goes to
+ * screen, C at the strains set to file fname if set.
+ *------------------------------------------------------------------------------ */
+void Driver::screen()
+{
+  static const int ij[9][2] = {{0,0}, {1,1}, {2,2}, {0,1}, {0,2}, {1,2}, {3,3}, {4,4}, {5,5}};
+  const int nscale = 5;
+  const double scale[nscale] = {0.25, 0.5, 1., 2., 4.};
+  double C[nscale][6][6], asym[nscale], change[nscale], e[7];
+
+  status = 1;
+  const Structure *cell = ecv_structure_cell(ref);
+  int natom = 0;
+  ecv_structure_natom(ref, &natom);
+  Calculator *pot = new Calculator();
+  if (pot->read(screenfile) || pot->setup(cell)){
+    delete pot;
+    return;
+  }
+
+  double **f, sigma[6], fmax = 0.;
+  memory->create(f, natom, 3, "f");
+  double eng = pot->compute(cell, f, sigma);
+  for (int i = 0; i < natom; ++i){
+    double f2 = f[i][0]*f[i][0] + f[i][1]*f[i][1] + f[i][2]*f[i][2];
+    fmax = f2 > fmax ? f2 : fmax;
+  }
+  memory->destroy(f);
+
+  printf("\n# Strains pre-screened by the potential in %s, cutoff %g A, with the ions %s\n",
+    screenfile, pot->rcut, relax ? "relaxed" : "clamped");
+  printf("# Reference state: %g eV/atom, max force %g eV/A, stress (GPa, xx yy zz yz xz xy):\n#  ",
+    eng/double(natom), sqrt(fmax));
+  for (int i = 0; i < 6; ++i) printf(" %.4f", sigma[i]);
+  printf("\n#%6s %8s %8s", "scale", "e_norm", "e_shear");
+  for (int k = 0; k < 9; ++k){
+    char str[24];
+    snprintf(str, sizeof(str), "C%d%d", ij[k][0]+1, ij[k][1]+1);
+    printf(" %8s", str);
+  }
+  printf(" %8s %8s\n", "+/-", "dC");
+
+  int best = -1;
+  for (int k = 0; k < nscale; ++k){
+    for (int i = 1; i <= 6; ++i) e[i] = scale[k]*disp[i];
+    pot->moduli(cell, e, relax, C[k], &asym[k]);
+
+    double dmax = 0., cmax = 0.;
+    for (int i = 0; i < 6; ++i)
+    for (int j = 0; j < 6; ++j){
+      cmax = fabs(C[k][i][j]) > cmax ? fabs(C[k][i][j]) : cmax;
+      if (k) dmax = fabs(C[k][i][j] - C[k-1][i][j]) > dmax ? fabs(C[k][i][j] - C[k-1][i][j]) : dmax;
+    }
+    change[k] = cmax > ZERO ? dmax/cmax : 0.;
+    if (k && change[k] < LINEAR && best == k-1) best = k;
+    if (k == 0) best = 0;
+
+    printf(" %6g %8.4g %8.4g", scale[k], e[1], e[4]);
+    for (int m = 0; m < 9; ++m) printf(" %8.2f", 0.5*(C[k][ij[m][0]][ij[m][1]] + C[k][ij[m][1]][ij[m][0]]));
+    if (k) printf(" %8.4f %8.4f\n", asym[k], change[k]);
+    else printf(" %8.4f %8s\n", asym[k], "-");
+  }
+  printf("# +/-: largest difference of the one-sided estimates from the +e and -e states;\n");
+  printf("# dC: largest change from half the strain; both relative to the largest C.\n");
+  if (best >= 2) printf("# The strains set (scale 1) are within the linear regime, to %g, up to scale %g.\n", LINEAR, scale[best]);
+  else printf("# WARNING: C changes by more than %g below the strains set; scale %g or less is advised.\n", LINEAR, scale[best]);
+
+  Elastic *elastic = new Elastic();
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) elastic->C[i][j] = 0.5*(C[2][i][j] + C[2][j][i]);
+  if (elastic->compliance() == 0){
+    printf("\n# Elastic constants by the potential at the strains set:\n");
+    elastic->output(stdout);
+    if (fname) elastic->write(fname);
+    status = 0;
+  }
+  delete elastic;
+  delete pot;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to run the reference and strained states of all the POSCARs listed in
+ * pilotfile as one pilot job: each state is a task in pilot/<name>/<state>,
+ * with <name> the path of its POSCAR, '/' replaced by '_', and the INCAR,
+ * KPOINTS and POTCAR of the folder of the POSCAR if there is an INCAR there, of
+ * the current folder otherwise. The tasks are run by $VASP, or by the potential
+ * of -pot, nslot at a time; the summary goes to file fname.
+ *------------------------------------------------------------------------------ */
+void Driver::pilot()
+{
+  status = 1;
+  FILE *fp = fopen(pilotfile, "r");
+  if (fp == NULL){
+    printf("\nFile %s not found!\n", pilotfile);
+    return;
+  }
+  char str[MAXLINE];
+  int nlist = 0;
+  while (fgets(str, MAXLINE, fp)) ++nlist;
+  rewind(fp);
+
+  if (mkdir("pilot", 0755) && errno != EEXIST){
+    printf("\nERROR: cannot create folder pilot!\n");
+    fclose(fp);
+    return;
+  }
+
+  Pilot *job = new Pilot(nlist);
+  int nerr = 0;
+  while (fgets(str, MAXLINE, fp)){
+    char *path = strtok(str, " \t\r\n");
+    if (path == NULL || path[0] == '#') continue;
+
+    ecv_structure *st = NULL;
+    int flag = ecv_structure_read(path, &st);
+    if (flag != ECV_OK){
+      printf("\nERROR: %s in file: %s, skipped!\n", ecv_strerror(flag), path);
+      ++nerr;
+      continue;
+    }
+    if (reduce && ecv_structure_reduce(st, 1.e-3, NULL) != ECV_OK)
+      printf("\nWARNING: failed to reduce the cell of %s.\n", path);
+
+    char name[MAXLINE], dir[MAXLINE], src[MAXLINE];
+    const char *ptr = path;
+    while (ptr[0] == '.' && ptr[1] == '/') ptr += 2;
+    strcpy(name, ptr);
+    for (char *p = name; *p; ++p) if (*p == '/') *p = '_';
+    snprintf(dir, MAXLINE, "pilot/%s", name);
+
+    strcpy(src, path);
+    char *slash = strrchr(src, '/');
+    if (slash) *slash = '\0';
+    else strcpy(src, ".");
+    snprintf(dir, MAXLINE, "%s/INCAR", src);
+    if (access(dir, F_OK)) strcpy(src, ".");
+    snprintf(dir, MAXLINE, "pilot/%s", name);
+
+    if (job->add(ecv_structure_cell(st), name, dir, src, disp) < 0) ++nerr;
+    ecv_structure_free(st);
+  }
+  fclose(fp);
+  if (job->nstruct < 1){
+    printf("\nERROR: no structure read from %s!\n", pilotfile);
+    delete job;
+    return;
+  }
+
+  char cmd[MAXLINE];
+  if (potfile) snprintf(cmd, MAXLINE, "env OMP_NUM_THREADS=1 ecvasp -calc %s", potfile);
+  else if (getenv("VASP")) snprintf(cmd, MAXLINE, "%s", getenv("VASP"));
+  else strcpy(cmd, "mpirun -np 1 v533");
+  if (nslot < 1) nslot = int(sysconf(_SC_NPROCESSORS_ONLN));
+
+  int nleft = job->run(cmd, nslot, nretry, tol, inc, fname);
+  printf("\nSummary of the pilot job written to: %s\n", fname);
+  if (nleft == 0 && nerr == 0) status = 0;
+  delete job;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * To display help info
+ *------------------------------------------------------------------------------ */
+void Driver::help()
+{
+  printf("\nCode to generate the script for elastic constants calculations based on vasp.\n");
+  printf("\nUsage:\n    ecvasp [options] [poscar]\n\nAvailable options:\n");
+  printf("    -h       To display this help info;\n");
+  printf("    -e       To define the strain; by default: %g\n", STRAIN);
+  printf("    -xx      To define the strain of eps_{xx}; by default: %g\n", STRAIN);
+  printf("    -yy      To define the strain of eps_{yy}; by default: %g\n", STRAIN);
+  printf("    -zz      To define the strain of eps_{zz}; by default: %g\n", STRAIN);
+  printf("    -xy      To define the strain of eps_{xy}; by default: %g\n", NSRATIO*STRAIN);
+  printf("    -xz      To define the strain of eps_{xz}; by default: %g\n", NSRATIO*STRAIN);
+  printf("    -yz      To define the strain of eps_{yz}; by default: %g\n", NSRATIO*STRAIN);
+  printf("    -s file  To evaluate the directional Young's modulus, shear modulus, linear\n");
+  printf("             compressibility and sound velocities from the Cij matrix in file\n");
+  printf("             (Cij.dat as written by the script); no script will be written;\n");
+  printf("    -grid nt np  To define the (theta, phi) grid for -s; by default: 181 360\n");
+  printf("    -rho     To define the mass density (g/cm^3) for -s; by default, evaluated\n");
+  printf("             from poscar if the element names are available there;\n");
+  printf("    -texture cij ori  To evaluate the textured Voigt, Reuss, Hill estimates and\n");
+  printf("             the Hashin-Shtrikman bounds of the polycrystal from the Cij matrix in\n");
+  printf("             file cij and the grain orientations in file ori, Bunge Euler angles\n");
+  printf("             phi1 Phi phi2 [weight] in degrees, or EBSD data in *.ang or *.ctf\n");
+  printf("             format; no script will be written;\n");
+  printf("    -u file  To estimate the uncertainties of Cij and the derived moduli by Monte\n");
+  printf("             Carlo resampling of the stresses in file (info.dat as written by\n");
+  printf("             the script); no script will be written;\n");
+  printf("    -n       To define the number of resamples for -u; by default: 100000\n");
+  printf("    -noise   To define the stress noise (kB) for -u; by default, estimated from\n");
+  printf("             the +/- asymmetry and the Cij/Cji mismatch;\n");
+  printf("    -seed    To define the seed of the random generator for -u; by default: 1234567\n");
+  printf("    -p list  To write the script for a pressure sweep instead, with the list of\n");
+  printf("             pressures (GPa) separated by comma, e.g., -p 0,10,20;\n");
+  printf("    -birch   To report also the thermodynamic Cij at the reference pressure;\n");
+  printf("             turned on by the script of -p for each pressure;\n");
+  printf("    -tune    To tune the MPI ranks, NCORE and KPAR on the equilibrium cell before\n");
+  printf("             the strained runs; the choice is kept in ~/.ecvasp/tune.db for reuse;\n");
+  printf("    -scratch To run each state in node-local scratch ($TMPDIR), only OUTCAR, OSZICAR\n");
+  printf("             and vasprun.xml are copied back, compressed, into folder states;\n");
+  printf("    -zip     To define the compressor for -scratch, gzip or zstd; by default: gzip\n");
+  printf("    -mf list To run the full strain set with INCAR.low, then the +/- strains of\n");
+  printf("             the Voigt components in list (e.g., 1,2,3) with INCAR.high, and to\n");
+  printf("             correct the cheap Cij by the latter ones;\n");
+  printf("    -mfc low high  To correct the Cij from the info.dat of the low fidelity states\n");
+  printf("             by the high fidelity ones as done by -mf; no script will be written;\n");
+  printf("    -relax   To relax the ions of each strained state as well (ISIF = 2), for the\n");
+  printf("             relaxed-ion Cij; the clamped-ion ones and the internal strain part are\n");
+  printf("             reported too; not available with -mf;\n");
+  printf("    -kspring To define the effective spring constant (eV/A^2) to predict the internal\n");
+  printf("             relaxation for -relax and -predict; by default: %g\n", KSPRING);
+  printf("    -predict f0 f  To displace the ions of the clamped strained cell in poscar by\n");
+  printf("             (f - f0)/k, with f0 and f the forces in the OUTCAR of the equilibrium\n");
+  printf("             and the strained states; no script will be written;\n");
+  printf("    -mirror c r  To displace the ions of the clamped strained cell in poscar by the\n");
+  printf("             opposite of the relaxation from cell c to r, those of the opposite\n");
+  printf("             strain; no script will be written;\n");
+  printf("    -relaxc c r  To report the clamped-ion and relaxed-ion Cij from the info.dat of\n");
+  printf("             each, and their difference; no script will be written;\n");
+  printf("    -reduce  To reduce the cell read to the primitive one and Niggli reduce it before\n");
+  printf("             the strains are applied; the Cartesian frame, and thus that of the Cij,\n");
+  printf("             is kept. Not for magnetic cells with MAGMOM set per atom in INCAR;\n");
+  printf("    -inc     To check the Cij columns available after each strained state (sign,\n");
+  printf("             +/- consistency, Cij/Cji mismatch, Born criteria of the columns so\n");
+  printf("             far), reported in partial.dat, and to abort the script if any fails;\n");
+  printf("    -incc file  To check the strained states available in file (info.dat, maybe\n");
+  printf("             incomplete) as done by -inc; the exit status is 2 if any check fails,\n");
+  printf("             no script will be written;\n");
+  printf("    -tol     To define the relative tolerance of the checks of -inc; by default: %g\n", TOLERANCE);
+  printf("    -ibrion6 To write the script for a single run of VASP with IBRION = 6 and\n");
+  printf("             ISIF = 3 instead, whose relaxed-ion Cij are read by -outcar; -scratch\n");
+  printf("             and -tune apply to it as well;\n");
+  printf("    -outcar file  To read the elastic moduli from the OUTCAR of IBRION = 6, with the\n");
+  printf("             ionic relaxation part reported separately; no script will be written;\n");
+  printf("    -bench   To write the script to benchmark -ibrion6 against the strain set with\n");
+  printf("             -relax, both timed by -perf and compared by -benchc;\n");
+  printf("    -benchc multi single  To compare the timings and Cij in the two folders of\n");
+  printf("             the -bench script; no script will be written;\n");
+  printf("    -toec    To write the script for the third order elastic constants instead,\n");
+  printf("             with the states strained along two components reduced by symmetry;\n");
+  printf("    -etoec   To define the strain of -toec, %g times for the shear components;\n", NSRATIO);
+  printf("             by default: %g. info.dat is reused only at the same strains;\n", TSTRAIN);
+  printf("    -toecfit file  To fit the second and third order elastic constants to the\n");
+  printf("             states in file (stress.dat as written by the -toec script), with the\n");
+  printf("             point group of poscar; no script will be written;\n");
+  printf("    -calc pot  To compute poscar by the interatomic potential (EAM, Lennard-Jones,\n");
+  printf("             Morse) in file pot in place of VASP, as INCAR asks, into OUTCAR, OSZICAR\n");
+  printf("             and CONTCAR; the ions are relaxed by FIRE, the cell is kept;\n");
+  printf("    -pot pot To write the script with the potential in pot in place of VASP, e.g.,\n");
+  printf("             to test the workflow locally; not available with -p;\n");
+  printf("    -screen pot  To compute the Cij by the potential in pot at 1/4 to 4 times the\n");
+  printf("             strains set, with -relax as well, to check that they are within the\n");
+  printf("             linear regime; no script will be written;\n");
+  printf("    -kmesh R To write the KPOINTS of each state in the script: the Gamma centered\n");
+  printf("             mesh of the reference cell for length R (A), as the Auto mode of VASP,\n");
+  printf("             listed explicitly so that all states share its k-points; those of the\n");
+  printf("             +/- states of each component are reduced by their common rotations;\n");
+  printf("    -kconv \"R1 R2 ...\"  To write the script to converge the Cij against the\n");
+  printf("             k-point density, running the -kmesh workflow for each of two or more\n");
+  printf("             lengths R, from the shortest on;\n");
+  printf("    -kconvc \"dir1 dir2 ...\"  To compare the Cij of the -kconv folders, ordered by\n");
+  printf("             the mesh in their KPOINTS, against the densest; no script will be written;\n");
+  printf("    -pilot list  To run the reference and strained states of all the POSCARs in\n");
+  printf("             file list (one per line) as one pilot job in the current allocation,\n");
+  printf("             each state a task in pilot/<name>/<state> run by $VASP (or by -pot),\n");
+  printf("             -slots at a time, idle slots stealing the queued tasks of the others;\n");
+  printf("             failed tasks are retried, the results streamed to the info.dat and\n");
+  printf("             Cij.dat of each structure and to the summary in file <o> (pilot.dat),\n");
+  printf("             with -inc dropping the remaining states of a structure failing a check;\n");
+  printf("             the ions are clamped; no script will be written;\n");
+  printf("    -slots n To define the number of tasks run at a time by -pilot; by default, the\n");
+  printf("             number of processors online;\n");
+  printf("    -retry n To define the number of retries of each failed task of -pilot; by\n");
+  printf("             default: %d\n", NRETRY);
+  printf("    -perf    To record the timings of each state (wall, CPU, SCF iterations, LOOP+,\n");
+  printf("             max RSS) in perf.dat, reported at the end in perf.json and perf.prom;\n");
+  printf("             the phases of ecvasp itself are timed and kept in perf.dat as well;\n");
+  printf("    -report file  To report the timings in file (perf.dat) in JSON and Prometheus\n");
+  printf("             textfile formats, as <o>.json and <o>.prom; no script will be written;\n");
+  printf("    -o       To define the output file name; by default: ecrun, or surface.dat\n");
+  printf("             for -s, toec.dat for -toecfit, perf for -report, POSCAR.pred for\n");
+  printf("             -predict/-mirror, pilot.dat for -pilot; the -u/-mfc/-relaxc/-outcar\n");
+  printf("             /-benchc/-incc/-texture/-screen/-kconvc results are only written to\n");
+  printf("             screen if not set.\n");
+  printf("    poscar   POSCAR or CONTCAR of vasp; by default: POSCAR\n");
+  printf("\n\n");
+
+  exit(0);
+return;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -2,6 +2,11 @@
 #define DRIVER_H
 
 #include "memory.h"
+#include "ecvasp.h"
+#include "perf.h"
+#include "kmesh.h"
+
+#define MAXLINE 1024
 
 using namespace std;
 
@@ -10,25 +15,104 @@ public:
   Driver(int, char**);
   ~Driver();
 
+  int status;                   // exit status of ecvasp
+
 private:
   Memory *memory;
   char *poscar, *fname;
-  char *title, *element;
+  char *cijfile;                // Cij matrix file for directional analysis
+  int ngrid[2];                 // (theta,phi) grid for directional analysis
+  double rho;                   // mass density, in g/cm^3
+  char *infofile;               // info.dat for uncertainty analysis
+  int nsample;                  // number of resamples for uncertainty analysis
+  double noise;                 // stress noise in kB; estimated from info.dat if not positive
+  unsigned long seed;           // seed of the random number generator
+  int npress;                   // number of pressures for the pressure sweep
+  double *press;                // pressures (GPa) for the pressure sweep
+  int birch;                    // flag to report the pressure corrected Cij
+  int scratch;                  // flag to run each state in node-local scratch
+  char *zip;                    // compressor of the archived outputs, gzip or zstd
+  char grep[16], outcar[MAXLINE], oszicar[MAXLINE]; // how the script reads the outputs
+  int tune;                     // flag to tune the parallel settings of VASP
+  int mf, mfcol[7];             // multi-fidelity mode, and the strain components redone at high precision
+  char *lowfile, *highfile;     // info.dat of the low and high fidelity states for the correction
+  int toec;                     // flag to write the script for the third order elastic constants
+  double etoec[7];              // strains of the states for the third order elastic constants
+  char *toecfile;               // stress.dat to fit the third order elastic constants
+  int perf;                     // flag to record the timings of each state and of ecvasp
+  char *perffile;               // perf.dat to report in JSON and Prometheus formats
+  Perf *timer;
+  int relax;                    // flag to relax the ions of the strained states as well
+  double kspring;               // effective spring constant (eV/A^2) to predict the internal relaxation
+  char *forcefile[2];           // OUTCAR of the equilibrium and the clamped strained state for -predict
+  char *mirrorfile[2];          // clamped and relaxed cell of the opposite strain for -mirror
+  char *clampfile, *relaxfile;  // info.dat of the clamped-ion and relaxed-ion states
+  int ib6;                      // flag to write the script of a single run with IBRION = 6
+  int bench;                    // flag to write the script to benchmark it against the strain set
+  char *modfile;                // OUTCAR of IBRION = 6 to read the elastic moduli from
+  char *benchdir[2];            // folders of the strain set and of the IBRION = 6 run to compare
+  int reduce;                   // flag to reduce the cell read to the primitive one, Niggli reduced
+  int inc;                      // flag to check the states available after each strained state
+  char *incfile;                // info.dat, maybe incomplete, to check
+  double tol;                   // relative tolerance of the checks of the incremental analysis
+  char *texfile[2];             // Cij matrix and orientations for the textured polycrystal
+  char *calcfile;               // potential to compute poscar with, in place of VASP
+  char *potfile;                // potential for the script to run in place of VASP, full path
+  char *screenfile;             // potential to pre-screen the strains with
+  char *pilotfile;              // list of POSCARs whose states run as one pilot job
+  int nslot, nretry;            // number of tasks the pilot job runs at a time, and retries of each
+  double kdens;                 // length (A) of the explicit k-mesh of the states, as the Auto mode of VASP
+  int nkconv;                   // number of k-mesh lengths of the convergence series
+  double *kconv;                // k-mesh lengths (A) of the convergence series
+  char *kconvdir;               // folders of the convergence series to compare
+  KMesh *kmesh;                 // k-mesh of the reference cell
 
-  double alat;
-  int ntype, natom, *ntm;
-  double **atpos;
-  double **axis, **dispmat, **newaxis;
+  ecv_structure *ref;           // configuration read from poscar
+  ecv_structure *strained;      // that strained by the last call of strain()
   double disp[7];
 
   int readpos();
-  void matmul();
   void generate();
-  void writepos(double **, FILE *);
+  void writepos(const ecv_structure *, FILE *, const char *);
+  void runstate(FILE *, const char *);
+  void relaxpos(FILE *, int, double, const char *);
+  void writecell(const ecv_structure *, FILE *);
+  void strain(int, double);
+  void highstage(FILE *, int);
+  void writescratch(FILE *);
+  void writetune(FILE *);
+  void writecheck(FILE *);
+  int laue(const ecv_structure *);
+  int rotations(double [][3][3]);
+  void source(const char *);
+  void readpress(FILE *, const char *);
+  void perfstate(FILE *, const char *);
+  void perfreport(FILE *);
+  void timing(const char *);
+  void sweep();
+  void thirdorder();
+  void singlerun();
+  void benchmark();
+  void writevasp(FILE *, const char *);
+  void writekpts(FILE *, int);
+  void kseries();
+
+  void surface();
+  void texture();
+  void uncertainty();
+  void fidelity();
+  void toecfit();
+  void guess();
+  void relaxed();
+  void readmoduli();
+  void benchcmp();
+  void incremental();
+  void calc();
+  void screen();
+  void pilot();
+  void kconvcmp();
 
   // help info
   void help();
-
-  int count_words(const char *);
 };
 #endif
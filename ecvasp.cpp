@@ -0,0 +1,307 @@
+#include "ecvasp.h"
+#include "structure.h"
+#include "elastic.h"
+#include "stdlib.h"
+#include "string.h"
+#include <new>
+
+struct ecv_structure {
+  Structure cell;
+};
+
+static const char *errmsg[ECV_NERR] = {
+  "success",
+  "null pointer passed",
+  "file not found or not readable",
+  "malformed POSCAR",
+  "no atom found",
+  "Cartesian positions found, direct ones expected",
+  "argument out of range",
+  "singular elastic constant matrix",
+  "memory allocation failed",
+  "output buffer too small",
+  "element names missing or unknown"
+};
+
+/*------------------------------------------------------------------------------
+ * Version of the C interface, ECV_API_VERSION of the header compiled against
+ *------------------------------------------------------------------------------ */
+int ecv_version(void)
+{
+return ECV_API_VERSION;
+}
+
+/*------------------------------------------------------------------------------
+ * Description of the error code
+ *------------------------------------------------------------------------------ */
+const char *ecv_strerror(int err)
+{
+  if (err < 0 || err >= ECV_NERR) return "unknown error";
+return errmsg[err];
+}
+
+/*------------------------------------------------------------------------------
+ * Name of the k-th derived modulus, as ordered by ecv_moduli
+ *------------------------------------------------------------------------------ */
+const char *ecv_modname(int k)
+{
+  if (k < 0 || k >= ECV_NMOD) return NULL;
+return Elastic::modname[k];
+}
+
+/*------------------------------------------------------------------------------
+ * To create a structure from the text of a POSCAR, or from a POSCAR file
+ *------------------------------------------------------------------------------ */
+int ecv_structure_parse(const char *buf, ecv_structure **out)
+{
+  if (buf == NULL || out == NULL) return ECV_ERR_NULL;
+  *out = NULL;
+  ecv_structure *s = new (std::nothrow) ecv_structure;
+  if (s == NULL) return ECV_ERR_MEMORY;
+
+  int flag = s->cell.parse(buf);
+  if (flag != ECV_OK) delete s;
+  else *out = s;
+
+return flag;
+}
+
+int ecv_structure_read(const char *fname, ecv_structure **out)
+{
+  if (fname == NULL || out == NULL) return ECV_ERR_NULL;
+  *out = NULL;
+  ecv_structure *s = new (std::nothrow) ecv_structure;
+  if (s == NULL) return ECV_ERR_MEMORY;
+
+  int flag = s->cell.read(fname);
+  if (flag != ECV_OK) delete s;
+  else *out = s;
+
+return flag;
+}
+
+void ecv_structure_free(ecv_structure *s)
+{
+  if (s) delete s;
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Accessors: number of atoms, lattice vectors (rows, Angstrom), fractional
+ * coordinates (natom x 3) and the POSCAR text of a structure
+ *------------------------------------------------------------------------------ */
+int ecv_structure_natom(const ecv_structure *s, int *natom)
+{
+  if (s == NULL || natom == NULL) return ECV_ERR_NULL;
+  *natom = s->cell.natom;
+
+return ECV_OK;
+}
+
+int ecv_structure_lattice(const ecv_structure *s, double lattice[9])
+{
+  if (s == NULL || lattice == NULL) return ECV_ERR_NULL;
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) lattice[i*3+j] = s->cell.alat * s->cell.axis[i][j];
+
+return ECV_OK;
+}
+
+int ecv_structure_positions(const ecv_structure *s, double *frac)
+{
+  if (s == NULL || frac == NULL) return ECV_ERR_NULL;
+  for (int i = 0; i < s->cell.natom; ++i)
+  for (int j = 0; j < 3; ++j) frac[i*3+j] = s->cell.atpos[i][j];
+
+return ECV_OK;
+}
+
+int ecv_structure_write(const ecv_structure *s, char *buf, size_t size, size_t *need)
+{
+  if (s == NULL) return ECV_ERR_NULL;
+return s->cell.write(buf, size, need);
+}
+
+/*------------------------------------------------------------------------------
+ * To reduce a structure to its primitive cell, Niggli reduced, in place; the
+ * Cartesian frame is kept, so the elastic constants of the reduced cell need
+ * no rotation. ncell, if not NULL, gets the number of primitive cells in the
+ * original one. symprec is the tolerance on positions, in Angstrom.
+ *------------------------------------------------------------------------------ */
+int ecv_structure_reduce(ecv_structure *s, double symprec, int *ncell)
+{
+  if (s == NULL) return ECV_ERR_NULL;
+  if (!(symprec > 0.)) return ECV_ERR_RANGE;
+  if (s->cell.natom < 1) return ECV_ERR_NOATOM;
+
+  int n = s->cell.primitive(symprec);
+  if (n < 1) return ECV_ERR_FORMAT;
+  if (s->cell.niggli() < 0) return ECV_ERR_FORMAT;
+  if (ncell) *ncell = n;
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * To find the point group of a structure within symprec (Angstrom): nrot gets
+ * its order, nlaue that of the Laue group, rot the rotations in Cartesian
+ * coordinates, ECV_MAXROT x 9 row major; nlaue and rot may be NULL.
+ *------------------------------------------------------------------------------ */
+int ecv_structure_symmetry(const ecv_structure *s, double symprec, int *nrot, int *nlaue, double *rot)
+{
+  if (s == NULL || nrot == NULL) return ECV_ERR_NULL;
+  if (!(symprec > 0.)) return ECV_ERR_RANGE;
+  if (s->cell.natom < 1) return ECV_ERR_NOATOM;
+
+  double Rc[ECV_MAXROT][3][3];
+  *nrot = s->cell.symmetry(symprec, nlaue, rot ? Rc : NULL);
+  if (rot){
+    for (int n = 0; n < *nrot; ++n)
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) rot[n*9+i*3+j] = Rc[n][i][j];
+  }
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * To evaluate the mass density (g/cm^3) of a structure from its element names
+ *------------------------------------------------------------------------------ */
+int ecv_structure_density(const ecv_structure *s, double *rho)
+{
+  if (s == NULL || rho == NULL) return ECV_ERR_NULL;
+return s->cell.density(rho);
+}
+
+/*------------------------------------------------------------------------------
+ * To create the structure strained by eps along Voigt component idim (1-6),
+ * or all 12 strained states with the strain magnitudes eps[0..5]; out[2*i]
+ * is for +eps[i], out[2*i+1] for -eps[i], i.e., states 1 to 12.
+ *------------------------------------------------------------------------------ */
+int ecv_strain(const ecv_structure *s, int idim, double eps, ecv_structure **out)
+{
+  if (s == NULL || out == NULL) return ECV_ERR_NULL;
+  *out = NULL;
+  if (idim < 1 || idim > 6) return ECV_ERR_RANGE;
+  ecv_structure *t = new (std::nothrow) ecv_structure;
+  if (t == NULL) return ECV_ERR_MEMORY;
+
+  int flag = s->cell.strain(idim, eps, &t->cell);
+  if (flag != ECV_OK) delete t;
+  else *out = t;
+
+return flag;
+}
+
+int ecv_strain_all(const ecv_structure *s, const double eps[6], ecv_structure *out[ECV_NSTATE-1])
+{
+  if (s == NULL || eps == NULL || out == NULL) return ECV_ERR_NULL;
+  for (int i = 0; i < ECV_NSTATE-1; ++i) out[i] = NULL;
+
+  for (int i = 0; i < 6; ++i)
+  for (int k = 0; k < 2; ++k){
+    int flag = ecv_strain(s, i+1, k ? -eps[i] : eps[i], &out[2*i+k]);
+    if (flag != ECV_OK){
+      for (int j = 0; j < ECV_NSTATE-1; ++j){
+        ecv_structure_free(out[j]);
+        out[j] = NULL;
+      }
+      return flag;
+    }
+  }
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * To add strain eps along Voigt component idim to the deformation matrix D,
+ * and to create the structure deformed by D, i.e., with lattice axis * D;
+ * D is 3x3 row major, unity for no deformation.
+ *------------------------------------------------------------------------------ */
+int ecv_strain_matrix(int idim, double eps, double D[9])
+{
+  if (D == NULL) return ECV_ERR_NULL;
+  if (idim < 1 || idim > 6) return ECV_ERR_RANGE;
+  double M[3][3];
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) M[i][j] = D[i*3+j];
+  Structure::strainmat(idim, eps, M);
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) D[i*3+j] = M[i][j];
+
+return ECV_OK;
+}
+
+int ecv_deform(const ecv_structure *s, const double D[9], ecv_structure **out)
+{
+  if (s == NULL || D == NULL || out == NULL) return ECV_ERR_NULL;
+  *out = NULL;
+  ecv_structure *t = new (std::nothrow) ecv_structure;
+  if (t == NULL) return ECV_ERR_MEMORY;
+
+  int flag = t->cell.copy(&s->cell);
+  if (flag != ECV_OK){
+    delete t;
+    return flag;
+  }
+  double M[3][3];
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) M[i][j] = D[i*3+j];
+  s->cell.deform(M, t->cell.axis);
+  *out = t;
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * To evaluate the elastic constants (GPa) from the stresses (kB) of the 13
+ * states, as done by the script; the reference state is not needed.
+ *------------------------------------------------------------------------------ */
+int ecv_tensor(const double stress[ECV_NSTATE][6], const double eps[6], double C[36])
+{
+  if (stress == NULL || eps == NULL || C == NULL) return ECV_ERR_NULL;
+  Elastic elastic;
+  for (int i = 0; i < 6; ++i){
+    if (!(eps[i] > 0.)) return ECV_ERR_RANGE;
+    elastic.eps[i+1] = eps[i];
+  }
+  for (int i = 0; i < ECV_NSTATE; ++i)
+  for (int j = 0; j < 6; ++j) elastic.stress[i][j] = stress[i][j];
+
+  elastic.tensor(elastic.stress, elastic.C);
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) C[i*6+j] = elastic.C[i][j];
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * To evaluate the derived moduli from C (GPa), ordered as by ecv_modname
+ *------------------------------------------------------------------------------ */
+int ecv_moduli(const double C[36], double moduli[ECV_NMOD])
+{
+  if (C == NULL || moduli == NULL) return ECV_ERR_NULL;
+  Elastic elastic;
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) elastic.C[i][j] = C[i*6+j];
+
+  if (elastic.invert(elastic.C, elastic.S)) return ECV_ERR_SINGULAR;
+  elastic.moduli(elastic.C, elastic.S, moduli);
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * C++ only: the Structure held, to hand to the classes of the library
+ *------------------------------------------------------------------------------ */
+Structure *ecv_structure_cell(ecv_structure *s)
+{
+return s ? &s->cell : NULL;
+}
+
+const Structure *ecv_structure_cell(const ecv_structure *s)
+{
+return s ? &s->cell : NULL;
+}
+
+/*----------------------------------------------------------------------------*/
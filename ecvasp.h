@@ -0,0 +1,92 @@
+#ifndef ECVASP_H
+#define ECVASP_H
+/*------------------------------------------------------------------------------
+ * C interface of libecvasp, to set up the strained cells and to evaluate the
+ * elastic constants in memory, without writing files or spawning processes.
+ * All functions return ECV_OK (0) on success, or one of the error codes below,
+ * whose meaning is given by ecv_strerror; nothing is printed and exit is never
+ * called. The functions keep no global state, and are thus thread-safe as long
+ * as one structure is not modified by two threads at the same time.
+ *
+ * Conventions:
+ *   lattice : rows are the lattice vectors, in Angstrom (scale factor applied);
+ *   strain  : Voigt component idim = 1..6 for xx yy zz yz xz xy, as ecvasp;
+ *   D       : deformation matrix, 3x3 row major, which multiplies the lattice
+ *             vectors (rows) from the right; the deformation gradient is D^T;
+ *   stress  : kB, Voigt order xx yy zz yz xz xy, positive for compression as
+ *             in OUTCAR; state 0 is the reference, state 2*idim-1 that of the
+ *             positive strain of component idim, 2*idim that of the negative;
+ *   C       : GPa, 6x6 row major, Voigt order.
+ *------------------------------------------------------------------------------ */
+#include <stddef.h>
+
+#define ECV_API_VERSION 3
+#define ECV_NSTATE 13
+#define ECV_NMOD 11
+#define ECV_MAXROT 48
+
+enum {
+  ECV_OK = 0,
+  ECV_ERR_NULL,                 // null pointer passed
+  ECV_ERR_FILE,                 // file not found or not readable
+  ECV_ERR_FORMAT,               // malformed POSCAR
+  ECV_ERR_NOATOM,               // no atom found
+  ECV_ERR_CARTESIAN,            // Cartesian positions, direct ones expected
+  ECV_ERR_RANGE,                // argument out of range
+  ECV_ERR_SINGULAR,             // singular stiffness matrix
+  ECV_ERR_MEMORY,               // allocation failed
+  ECV_ERR_BUFFER,               // output buffer too small
+  ECV_ERR_ELEMENT,              // element names missing or unknown
+  ECV_NERR
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ecv_structure ecv_structure;
+
+int ecv_version(void);
+const char *ecv_strerror(int);
+const char *ecv_modname(int);
+
+/* structure: parsed from POSCAR text in memory, or from a (compressed) file */
+int ecv_structure_parse(const char *buf, ecv_structure **out);
+int ecv_structure_read(const char *fname, ecv_structure **out);
+void ecv_structure_free(ecv_structure *);
+int ecv_structure_natom(const ecv_structure *, int *natom);
+int ecv_structure_lattice(const ecv_structure *, double lattice[9]);
+int ecv_structure_positions(const ecv_structure *, double *frac);  // natom x 3, direct
+int ecv_structure_write(const ecv_structure *, char *buf, size_t size, size_t *need);
+
+/* primitive cell, Niggli reduced, in place; the Cartesian frame is kept */
+int ecv_structure_reduce(ecv_structure *, double symprec, int *ncell);
+
+/* point group: its order, that of the Laue group, and the Cartesian rotations
+ * (ECV_MAXROT x 9, row major); nlaue and rot may be NULL */
+int ecv_structure_symmetry(const ecv_structure *, double symprec, int *nrot, int *nlaue, double *rot);
+
+/* mass density (g/cm^3), from the element names of the POSCAR */
+int ecv_structure_density(const ecv_structure *, double *rho);
+
+/* strained cells: one state, or the 12 states for strains eps[0..5] of components 1..6 */
+int ecv_strain(const ecv_structure *, int idim, double eps, ecv_structure **out);
+int ecv_strain_all(const ecv_structure *, const double eps[6], ecv_structure *out[ECV_NSTATE-1]);
+
+/* general deformation: D gets the strain eps along idim added, out the cell deformed by D */
+int ecv_strain_matrix(int idim, double eps, double D[9]);
+int ecv_deform(const ecv_structure *, const double D[9], ecv_structure **out);
+
+/* elastic constants from the stresses of the 13 states, and the derived moduli */
+int ecv_tensor(const double stress[ECV_NSTATE][6], const double eps[6], double C[36]);
+int ecv_moduli(const double C[36], double moduli[ECV_NMOD]);
+
+#ifdef __cplusplus
+}
+
+/* C++ only: the Structure held, for the classes of the library that take one */
+class Structure;
+Structure *ecv_structure_cell(ecv_structure *);
+const Structure *ecv_structure_cell(const ecv_structure *);
+#endif
+#endif
@@ -0,0 +1,353 @@
+#include "elastic.h"
+#include "zfile.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include <ctype.h>
+
+#define ZERO 1.e-10
+#define MAXLINE 1024
+
+const char *Elastic::modname[NMOD] = {"KV", "KR", "KVRH", "GV", "GR", "GVRH", "Zener",
+  "AU", "Poisson", "Young", "B/G"};
+
+/*------------------------------------------------------------------------------
+ * Constructor of Elastic, the container of the elastic constants
+ *------------------------------------------------------------------------------ */
+Elastic::Elastic()
+{
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) C[i][j] = S[i][j] = 0.;
+  for (int i = 0; i < 7; ++i) eps[i] = 0.;
+  for (int i = 0; i < NSTATE; ++i){
+    have[i] = 0;
+    for (int j = 0; j < 6; ++j) stress[i][j] = 0.;
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, nothing to do
+ *------------------------------------------------------------------------------ */
+Elastic::~Elastic()
+{
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read the 6x6 elastic constant matrix (GPa) from file, i.e., the
+ * Cij.dat written by the script; blank lines and those start with # are skipped.
+ *------------------------------------------------------------------------------ */
+int Elastic::read(const char *fname)
+{
+  char str[MAXLINE];
+  ZFile zf;
+  FILE *fp = zf.open(fname);
+  if (fp == NULL){
+    printf("\nFile %s not found!\n", fname);
+    return 1;
+  }
+
+  int nrow = 0;
+  char *save;
+  while (nrow < 6 && fgets(str, MAXLINE, fp)){
+    char *ptr = strtok_r(str, " \n\t\r\f", &save);
+    if (ptr == NULL || ptr[0] == '#') continue;
+
+    for (int j = 0; j < 6; ++j){
+      if (ptr == NULL){
+        printf("\nERROR: insufficient data on line %d of file %s!\n", nrow+1, fname);
+        return 2;
+      }
+      C[nrow][j] = atof(ptr);
+      ptr = strtok_r(NULL, " \n\t\r\f", &save);
+    }
+    ++nrow;
+  }
+  if (zf.close()) return 4;
+
+  if (nrow < 6){
+    printf("\nERROR: only %d rows of the elastic constant matrix found in %s!\n", nrow, fname);
+    return 3;
+  }
+
+  // symmetrize
+  for (int i = 0; i < 6; ++i)
+  for (int j = i+1; j < 6; ++j) C[i][j] = C[j][i] = 0.5*(C[i][j] + C[j][i]);
+
+return compliance();
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read the stresses of the reference and strained states from the
+ * info.dat written by the script, each line of which reads:
+ *   idim eps pxx pyy pzz pxy pxz pyz energy [mag]
+ * with idim = 0 for the reference state; state 2*idim-1 is for the positive
+ * strain, 2*idim for the negative one. The last record of each state wins,
+ * in case the script has been rerun. C is then evaluated as the script does.
+ *------------------------------------------------------------------------------ */
+int Elastic::read_info(const char *fname)
+{
+  int nmiss = load_info(fname);
+  if (nmiss < 0) return 1;
+  if (nmiss){
+    printf("\nERROR: %d of the 12 strained states are missing in %s!\n", nmiss, fname);
+    return 2;
+  }
+
+  tensor(stress, C);
+
+return compliance();
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read the stresses from info.dat without evaluating C; returns the
+ * number of strained states missing, or -1 if the file cannot be read.
+ *------------------------------------------------------------------------------ */
+int Elastic::load_info(const char *fname)
+{
+  char str[MAXLINE];
+  ZFile zf;
+  FILE *fp = zf.open(fname);
+  if (fp == NULL){
+    printf("\nFile %s not found!\n", fname);
+    return -1;
+  }
+
+  double val[8];
+  char *save;
+  while (fgets(str, MAXLINE, fp)){
+    char *ptr = strtok_r(str, " \n\t\r\f", &save);
+    if (ptr == NULL || !isdigit(ptr[0]) || ptr[1] != '\0') continue;
+    int idim = atoi(ptr);
+    if (idim > 6) continue;
+
+    int n = 0;
+    while (n < 8 && (ptr = strtok_r(NULL, " \n\t\r\f", &save))) val[n++] = atof(ptr);
+    if (n < 7) continue;
+
+    int id = 0;
+    if (idim > 0){
+      if (fabs(val[0]) < ZERO) continue;
+      id = val[0] > 0. ? 2*idim-1 : 2*idim;
+      eps[idim] = fabs(val[0]);
+    }
+    // from (xx yy zz xy xz yz) to Voigt order
+    stress[id][0] = val[1]; stress[id][1] = val[2]; stress[id][2] = val[3];
+    stress[id][3] = val[6]; stress[id][4] = val[5]; stress[id][5] = val[4];
+    have[id] = 1;
+  }
+  if (zf.close()) return -1;
+
+  int nmiss = 0;
+  for (int i = 1; i < NSTATE; ++i) if (have[i] == 0) ++nmiss;
+
+return nmiss;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read C from the OUTCAR of a finite difference run of VASP with
+ * IBRION = 6 and ISIF >= 3, read line by line, compressed ones as well: the
+ * block TOTAL ELASTIC MODULI goes to C, and ELASTIC MODULI CONTR FROM IONIC
+ * RELAXATION, if present, to ion (zero otherwise), so that C - ion is the
+ * clamped-ion one. VASP orders the components as XX YY ZZ XY YZ ZX, in kBar.
+ *------------------------------------------------------------------------------ */
+int Elastic::read_outcar(const char *fname, double ion[6][6])
+{
+  static const char *dir[6] = {"XX", "YY", "ZZ", "XY", "YZ", "ZX"};
+  static const int map[6] = {0, 1, 2, 5, 3, 4};
+  char str[MAXLINE];
+  ZFile zf;
+  FILE *fp = zf.open(fname);
+  if (fp == NULL){
+    printf("\nFile %s not found!\n", fname);
+    return 1;
+  }
+
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) ion[i][j] = 0.;
+
+  int found = 0;
+  char *save;
+  while (fgets(str, MAXLINE, fp)){
+    double (*dst)[6] = NULL;
+    if (strstr(str, "TOTAL ELASTIC MODULI")){
+      dst = C;
+      found = 1;
+    } else if (strstr(str, "ELASTIC MODULI CONTR FROM IONIC RELAXATION")) dst = ion;
+    if (dst == NULL) continue;
+
+    // the header and separator lines are skipped
+    int nrow = 0;
+    while (nrow < 6 && fgets(str, MAXLINE, fp)){
+      char *ptr = strtok_r(str, " \n\t\r\f", &save);
+      if (ptr == NULL || strcmp(ptr, dir[nrow])) continue;
+      for (int j = 0; j < 6; ++j){
+        ptr = strtok_r(NULL, " \n\t\r\f", &save);
+        dst[map[nrow]][map[j]] = ptr ? 0.1*atof(ptr) : 0.;
+      }
+      ++nrow;
+    }
+    if (nrow < 6){
+      printf("\nERROR: incomplete elastic moduli block in %s!\n", fname);
+      zf.close();
+      return 3;
+    }
+  }
+  if (zf.close()) return 4;
+
+  if (found == 0){
+    printf("\nERROR: no TOTAL ELASTIC MODULI found in %s!\n", fname);
+    return 2;
+  }
+
+  for (int i = 0; i < 6; ++i)
+  for (int j = i+1; j < 6; ++j){
+    C[i][j] = C[j][i] = 0.5*(C[i][j] + C[j][i]);
+    ion[i][j] = ion[j][i] = 0.5*(ion[i][j] + ion[j][i]);
+  }
+
+return compliance();
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write C (GPa) to file, in the format of the Cij.dat of the script
+ *------------------------------------------------------------------------------ */
+int Elastic::write(const char *fname)
+{
+  FILE *fp = fopen(fname, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return 1;
+  }
+  for (int i = 0; i < 6; ++i){
+    for (int j = 0; j < 6; ++j) fprintf(fp, "%s%12.6f", j ? " " : "", C[i][j]);
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to report C and the derived moduli
+ *------------------------------------------------------------------------------ */
+void Elastic::output(FILE *fp)
+{
+  fprintf(fp, "# Elastic constants (GPa):\n");
+  for (int i = 0; i < 6; ++i){
+    for (int j = 0; j < 6; ++j) fprintf(fp, " %10.2f", C[i][j]);
+    fprintf(fp, "\n");
+  }
+
+  double m[NMOD];
+  moduli(C, S, m);
+  fprintf(fp, "# Derived moduli:\n");
+  for (int k = 0; k < NMOD; ++k) fprintf(fp, "#   %-8s = %g\n", modname[k], m[k]);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to evaluate the stiffness matrix (GPa) from the stresses (kB) of the
+ * +/- strained states by central difference, symmetrized as done by the script
+ *------------------------------------------------------------------------------ */
+void Elastic::tensor(double st[NSTATE][6], double c[6][6])
+{
+  double a[6][6];
+  for (int j = 0; j < 6; ++j){
+    double r = 0.5/eps[j+1];
+    for (int i = 0; i < 6; ++i) a[i][j] = (st[2*j+2][i] - st[2*j+1][i]) * r;
+  }
+  for (int i = 0; i < 6; ++i)
+  for (int j = i; j < 6; ++j) c[i][j] = c[j][i] = 0.05*(a[i][j] + a[j][i]);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to evaluate the polycrystalline moduli from C and S, in the order of
+ * modname: KV KR KVRH GV GR GVRH Zener AU Poisson Young B/G
+ *------------------------------------------------------------------------------ */
+void Elastic::moduli(double c[6][6], double s[6][6], double *m)
+{
+  double KV = (c[0][0] + c[1][1] + c[2][2] + 2.*(c[0][1] + c[1][2] + c[0][2]))/9.;
+  double GV = (c[0][0] + c[1][1] + c[2][2] - (c[0][1] + c[1][2] + c[0][2]) + 3.*(c[3][3] + c[4][4] + c[5][5]))/15.;
+  double KR = 1./(s[0][0] + s[1][1] + s[2][2] + 2.*(s[0][1] + s[1][2] + s[0][2]));
+  double GR = 15./(4.*(s[0][0] + s[1][1] + s[2][2]) - 4.*(s[0][1] + s[1][2] + s[0][2]) + 3.*(s[3][3] + s[4][4] + s[5][5]));
+  double K = 0.5*(KV + KR), G = 0.5*(GV + GR);
+
+  m[0] = KV; m[1] = KR; m[2] = K;
+  m[3] = GV; m[4] = GR; m[5] = G;
+  m[6] = 2.*c[3][3]/(c[0][0] - c[0][1]);
+  m[7] = 5.*GV/GR + KV/KR - 6.;
+  m[8] = (3.*K - 2.*G)/(6.*K + 2.*G);
+  m[9] = 9.*K*G/(G + 3.*K);
+  m[10] = K/G;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to compute the compliance matrix from the stiffness matrix
+ *------------------------------------------------------------------------------ */
+int Elastic::compliance()
+{
+  if ( invert(C, S) ){
+    printf("\nERROR: the elastic constant matrix is singular!\n");
+    return 1;
+  }
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to invert a 6x6 matrix by Gauss-Jordan elimination with partial
+ * pivoting; returns 1 if the matrix is singular.
+ *------------------------------------------------------------------------------ */
+int Elastic::invert(double A[6][6], double B[6][6])
+{
+  double a[6][12];
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j){
+    a[i][j] = A[i][j];
+    a[i][j+6] = double(i == j);
+  }
+
+  for (int k = 0; k < 6; ++k){
+    int ip = k;
+    for (int i = k+1; i < 6; ++i) if (fabs(a[i][k]) > fabs(a[ip][k])) ip = i;
+    if (fabs(a[ip][k]) < ZERO) return 1;
+
+    if (ip != k) for (int j = 0; j < 12; ++j){
+      double tmp = a[k][j]; a[k][j] = a[ip][j]; a[ip][j] = tmp;
+    }
+
+    double r = 1./a[k][k];
+    for (int j = 0; j < 12; ++j) a[k][j] *= r;
+
+    for (int i = 0; i < 6; ++i){
+      if (i == k) continue;
+      double f = a[i][k];
+      for (int j = 0; j < 12; ++j) a[i][j] -= f * a[k][j];
+    }
+  }
+
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) B[i][j] = a[i][j+6];
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to map the Cartesian index pair (i,j) onto the Voigt index,
+ * xx->0, yy->1, zz->2, yz->3, xz->4, xy->5
+ *------------------------------------------------------------------------------ */
+int Elastic::voigt(int i, int j)
+{
+  if (i == j) return i;
+return 6 - i - j;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,39 @@
+#ifndef ELASTIC_H
+#define ELASTIC_H
+
+#include "memory.h"
+#include "stdio.h"
+
+#define NSTATE 13
+#define NMOD 11
+
+using namespace std;
+
+class Elastic {
+public:
+  Elastic();
+  ~Elastic();
+
+  double C[6][6];               // stiffness matrix in Voigt notation, in GPa
+  double S[6][6];               // compliance matrix in Voigt notation, in 1/GPa
+
+  double eps[7];                // strain magnitude of each Voigt component, 1-6
+  double stress[NSTATE][6];     // stresses (kB, Voigt order) of the reference and +/- strained states
+  int have[NSTATE];             // flag of the states that are available
+
+  int read(const char *);       // read the 6x6 stiffness matrix from file
+  int read_info(const char *);  // read the stresses from info.dat and evaluate C
+  int load_info(const char *);  // read the stresses from info.dat only, even if incomplete
+  int read_outcar(const char *, double [6][6]); // read C from the OUTCAR of IBRION = 6, and the ionic part
+  int write(const char *);      // write C to file, as Cij.dat
+  void output(FILE *);          // report C and the derived moduli
+  int compliance();             // to compute S from C
+
+  void tensor(double [NSTATE][6], double [6][6]);
+  void moduli(double [6][6], double [6][6], double *);
+  static const char *modname[NMOD];
+
+  int invert(double [6][6], double [6][6]);
+  int voigt(int, int);
+};
+#endif
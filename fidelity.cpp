@@ -0,0 +1,184 @@
+#include "fidelity.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#define ZERO 1.e-10
+#define ZTOL 1.e-2
+
+/*------------------------------------------------------------------------------
+ * Constructor of Fidelity, to correct the elastic constants obtained with
+ * cheap settings by a few strained states computed with high precision
+ *------------------------------------------------------------------------------ */
+Fidelity::Fidelity(Elastic *lo, Elastic *hi)
+{
+  low = lo; high = hi;
+  scale = 1.; shift = rms = cv = 0.;
+  npt = nallow = 0;
+  for (int i = 0; i < 6; ++i){
+    col[i] = 0;
+    for (int j = 0; j < 6; ++j) C[i][j] = S[i][j] = 0.;
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, nothing to do
+ *------------------------------------------------------------------------------ */
+Fidelity::~Fidelity()
+{
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to evaluate the corrected C. The unsymmetrized central differences
+ *   a_ij = (p_i(-e_j) - p_i(+e_j))/(2 e_j)
+ * are taken from the high fidelity states for the columns available there;
+ * the columns sampled at both levels define a linear map a_high = s*a_low + b,
+ * which is then applied to the remaining columns of the low fidelity set.
+ * Only the entries allowed by the symmetry, i.e., those of the symmetrized low
+ * fidelity C above ZTOL of the largest, enter the fit and get the shift b; the
+ * others are zero by the Laue class and stay so, up to the noise times s.
+ * The full low fidelity set is required; the high one needs both the +/-
+ * states of at least one strain component.
+ *------------------------------------------------------------------------------ */
+int Fidelity::correct()
+{
+  double a[6][6], al[6][6];
+  for (int j = 0; j < 6; ++j){
+    double rl = 0.05/low->eps[j+1];
+    for (int i = 0; i < 6; ++i) al[i][j] = (low->stress[2*j+2][i] - low->stress[2*j+1][i]) * rl;
+  }
+
+  double cmax = 0.;
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) cmax = fabs(al[i][j]) > cmax ? fabs(al[i][j]) : cmax;
+  nallow = 0;
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j){
+    allow[i][j] = fabs(0.5*(al[i][j] + al[j][i])) > ZTOL*cmax;
+    nallow += allow[i][j];
+  }
+
+  npt = 0;
+  for (int j = 0; j < 6; ++j){
+    col[j] = high->have[2*j+1] && high->have[2*j+2];
+    if (col[j] == 0) continue;
+
+    double rh = 0.05/high->eps[j+1];
+    for (int i = 0; i < 6; ++i){
+      a[i][j] = (high->stress[2*j+2][i] - high->stress[2*j+1][i]) * rh;
+      if (allow[i][j] == 0) continue;
+      x[npt] = al[i][j]; y[npt] = a[i][j];
+      ++npt;
+    }
+  }
+  if (npt < 1){
+    printf("\nERROR: no pair of +/- strained states found in the high fidelity data!\n");
+    return 1;
+  }
+
+  fit(-1, scale, shift);
+
+  // residual of the fit, and that of the prediction for each left-out entry
+  double s2 = 0., c2 = 0.;
+  for (int k = 0; k < npt; ++k){
+    double s, b, d = y[k] - (scale*x[k] + shift);
+    s2 += d*d;
+    fit(k, s, b);
+    d = y[k] - (s*x[k] + b);
+    c2 += d*d;
+  }
+  rms = sqrt(s2/double(npt));
+  cv  = sqrt(c2/double(npt));
+
+  for (int j = 0; j < 6; ++j){
+    if (col[j]) continue;
+    for (int i = 0; i < 6; ++i) a[i][j] = scale*al[i][j] + (allow[i][j] ? shift : 0.);
+  }
+
+  for (int i = 0; i < 6; ++i)
+  for (int j = i; j < 6; ++j) C[i][j] = C[j][i] = 0.5*(a[i][j] + a[j][i]);
+
+  if (low->invert(C, S)){
+    printf("\nERROR: the corrected elastic constant matrix is singular!\n");
+    return 2;
+  }
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to fit y = s*x + b by least squares, leaving out entry skip (if >= 0).
+ * If the entries left span less than ~1 GPa, or are fewer than three, only the
+ * shift is fitted; if nothing is left at all, no correction is made.
+ *------------------------------------------------------------------------------ */
+void Fidelity::fit(int skip, double &s, double &b)
+{
+  int n = 0;
+  double sx = 0., sy = 0., sxx = 0., sxy = 0.;
+  for (int k = 0; k < npt; ++k){
+    if (k == skip) continue;
+    sx += x[k]; sy += y[k];
+    sxx += x[k]*x[k]; sxy += x[k]*y[k];
+    ++n;
+  }
+  s = 1.; b = 0.;
+  if (n < 1) return;
+
+  double var = sxx - sx*sx/double(n);
+  if (n < 3 || var < double(n)){
+    b = (sy - sx)/double(n);
+    return;
+  }
+  s = (sxy - sx*sy/double(n))/var;
+  b = (sy - s*sx)/double(n);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the corrected C to file, in the format of Cij.dat
+ *------------------------------------------------------------------------------ */
+int Fidelity::write(const char *fname)
+{
+  FILE *fp = fopen(fname, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return 1;
+  }
+  for (int i = 0; i < 6; ++i){
+    for (int j = 0; j < 6; ++j) fprintf(fp, "%s%12.6f", j ? " " : "", C[i][j]);
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to report the correction, the corrected C and the derived moduli
+ *------------------------------------------------------------------------------ */
+void Fidelity::output(FILE *fp)
+{
+  fprintf(fp, "# Multi-fidelity correction from %d entries of column(s):", npt);
+  for (int j = 0; j < 6; ++j) if (col[j]) fprintf(fp, " %d", j+1);
+  fprintf(fp, "\n#   C_high = %g * C_low %+g GPa, the shift only on the %d entries allowed by symmetry\n", scale, shift, nallow);
+  fprintf(fp, "#   residual of the fit: %g GPa; leave-one-out error: %g GPa\n", rms, cv);
+
+  fprintf(fp, "# Corrected elastic constants (GPa):\n");
+  for (int i = 0; i < 6; ++i){
+    for (int j = 0; j < 6; ++j) fprintf(fp, " %10.2f", C[i][j]);
+    fprintf(fp, "\n");
+  }
+
+  double m[NMOD];
+  low->moduli(C, S, m);
+  fprintf(fp, "# Derived moduli:\n");
+  for (int k = 0; k < NMOD; ++k) fprintf(fp, "#   %-8s = %g\n", Elastic::modname[k], m[k]);
+
+return;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,30 @@
+#ifndef FIDELITY_H
+#define FIDELITY_H
+
+#include "elastic.h"
+
+using namespace std;
+
+class Fidelity {
+public:
+  Fidelity(Elastic *, Elastic *);
+  ~Fidelity();
+
+  int correct();                // corrected C from the low and high fidelity stresses
+  int write(const char *);      // write the corrected C to file
+  void output(FILE *);          // report the correction and the corrected C
+
+  double C[6][6], S[6][6];      // corrected stiffness and compliance
+  double scale, shift;          // A_high = scale * A_low + shift
+  double rms, cv;               // residual of the fit and its leave-one-out estimate (GPa)
+
+private:
+  Elastic *low, *high;
+
+  int npt, col[6];              // number of sampled entries, flag of the columns sampled at high fidelity
+  int allow[6][6], nallow;      // flag of the entries not zero by symmetry, and their number
+  double x[36], y[36];          // unsymmetrized entries (GPa) of the sampled columns
+
+  void fit(int, double &, double &);
+};
+#endif
@@ -0,0 +1,192 @@
+#include "kmesh.h"
+#include "symmetry.h"
+#include "math.h"
+
+/*------------------------------------------------------------------------------
+ * Constructor of KMesh, to build the Gamma centered k-mesh of the reference
+ * cell with subdivisions as the automatic length mode of VASP gives them:
+ * N_i = max(1, int(rk*|b_i| + 0.5)), b_i the reciprocal vectors (no 2pi) in
+ * 1/A. As the strains keep the fractional coordinates of the k-points, the
+ * same mesh is used by all the strained states, mapped onto their lattices.
+ *------------------------------------------------------------------------------ */
+KMesh::KMesh(const Structure *st, double rk)
+{
+  memory = new Memory();
+  cell = st;
+
+  double a[3][3], b[3][3];
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) a[i][j] = cell->axis[i][j] * cell->alat;
+  double vol = a[0][0]*(a[1][1]*a[2][2] - a[1][2]*a[2][1]) - a[0][1]*(a[1][0]*a[2][2] - a[1][2]*a[2][0])
+             + a[0][2]*(a[1][0]*a[2][1] - a[1][1]*a[2][0]);
+  for (int i = 0; i < 3; ++i){
+    int j = (i+1)%3, k = (i+2)%3;
+    b[i][0] = (a[j][1]*a[k][2] - a[j][2]*a[k][1])/vol;
+    b[i][1] = (a[j][2]*a[k][0] - a[j][0]*a[k][2])/vol;
+    b[i][2] = (a[j][0]*a[k][1] - a[j][1]*a[k][0])/vol;
+  }
+
+  ntot = 1;
+  for (int i = 0; i < 3; ++i){
+    double bl = sqrt(b[i][0]*b[i][0] + b[i][1]*b[i][1] + b[i][2]*b[i][2]);
+    nk[i] = int(rk*bl + 0.5);
+    nk[i] = nk[i] > 1 ? nk[i] : 1;
+    ntot *= nk[i];
+  }
+  nkpt = nop = 0;
+
+  memory->create(irr, ntot, "irr");
+  memory->create(wt, ntot, "wt");
+  memory->create(map, ntot, "map");
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, free memory
+ *------------------------------------------------------------------------------ */
+KMesh::~KMesh()
+{
+  memory->destroy(irr);
+  memory->destroy(wt);
+  memory->destroy(map);
+  delete memory;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to reduce the mesh by the rotations of the crystal common to the nlat
+ * lattices lat (rows, in A) that keep the mesh, and by time reversal. Reducing
+ * the +e and -e states by the same rotations gives them the same k-points and
+ * weights, so that the discretization errors cancel in the central difference.
+ * Returns the number of irreducible k-points.
+ *------------------------------------------------------------------------------ */
+int KMesh::reduce(double lat[][3][3], int nlat)
+{
+  int *type = new int [cell->natom];
+  int ia = 0;
+  for (int it = 0; it < cell->ntype; ++it)
+  for (int i = 0; i < cell->ntm[it]; ++i) type[ia++] = it;
+
+  double **ax;
+  memory->create(ax, 3, 3, "ax");
+  int ncom = 0, com[MAXROT][3][3];
+  for (int il = 0; il < nlat; ++il){
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) ax[i][j] = lat[il][i][j];
+    Symmetry *sym = new Symmetry(cell->natom, type, cell->atpos, 1.e-3);
+    sym->analyse(ax);
+
+    if (il == 0){
+      ncom = sym->nrot;
+      for (int n = 0; n < ncom; ++n)
+      for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 3; ++j) com[n][i][j] = sym->rot[n][i][j];
+    } else {
+      int nkeep = 0;
+      for (int n = 0; n < ncom; ++n){
+        int found = 0;
+        for (int m = 0; m < sym->nrot && found == 0; ++m){
+          found = 1;
+          for (int i = 0; i < 3; ++i)
+          for (int j = 0; j < 3; ++j) if (sym->rot[m][i][j] != com[n][i][j]) found = 0;
+        }
+        if (found == 0) continue;
+        for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j) com[nkeep][i][j] = com[n][i][j];
+        ++nkeep;
+      }
+      ncom = nkeep;
+    }
+    delete sym;
+  }
+  memory->destroy(ax);
+  delete []type;
+
+  // the rotations that map the mesh onto itself: W_ij N_j/N_i integer
+  nop = 0;
+  for (int n = 0; n < ncom; ++n){
+    int keep = 1;
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) if ((com[n][i][j]*nk[j]) % nk[i]) keep = 0;
+    if (keep == 0) continue;
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) com[nop][i][j] = com[n][i][j];
+    ++nop;
+  }
+
+  int id[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+  if (nop == 0){
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) com[0][i][j] = id[i][j];
+    nop = 1;
+  }
+
+  for (int k = 0; k < ntot; ++k) map[k] = -1;
+  nkpt = 0;
+  for (int k = 0; k < ntot; ++k){
+    if (map[k] >= 0) continue;
+    int w = 0;
+    for (int n = 0; n < nop; ++n)
+    for (int sign = 1; sign >= -1; sign -= 2){
+      int kr = rotate(k, com[n], sign);
+      if (map[kr] >= 0) continue;
+      map[kr] = k;
+      ++w;
+    }
+    irr[nkpt] = k;
+    wt[nkpt] = w;
+    ++nkpt;
+  }
+
+return nkpt;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the mesh index of point k rotated by W, time reversed if sign
+ * is negative: k'_j = sign * sum_i W_ij k_i, in reciprocal lattice units.
+ *------------------------------------------------------------------------------ */
+int KMesh::rotate(int k, int W[3][3], int sign)
+{
+  int n[3], m[3];
+  n[2] = k % nk[2];
+  n[1] = (k / nk[2]) % nk[1];
+  n[0] = k / (nk[1]*nk[2]);
+
+  for (int j = 0; j < 3; ++j){
+    m[j] = 0;
+    for (int i = 0; i < 3; ++i) m[j] += W[i][j]*nk[j]/nk[i] * n[i]; // exact, as reduce keeps W
+    m[j] = (sign * m[j]) % nk[j];
+    if (m[j] < 0) m[j] += nk[j];
+  }
+
+return (m[0]*nk[1] + m[1])*nk[2] + m[2];
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the irreducible k-points of the last reduction as an explicit
+ * KPOINTS, in reciprocal lattice units, with the integer weights
+ *------------------------------------------------------------------------------ */
+void KMesh::write(FILE *fp, const char *label)
+{
+  fprintf(fp, "Mesh %d x %d x %d of the reference cell for %s, %d of %d points by %d rotations\n",
+    nk[0], nk[1], nk[2], label, nkpt, ntot, nop);
+  fprintf(fp, "%d\nReciprocal\n", nkpt);
+  for (int ik = 0; ik < nkpt; ++ik){
+    int k = irr[ik], n[3];
+    n[2] = k % nk[2];
+    n[1] = (k / nk[2]) % nk[1];
+    n[0] = k / (nk[1]*nk[2]);
+    double q[3];
+    for (int i = 0; i < 3; ++i){
+      q[i] = double(n[i])/double(nk[i]);
+      if (q[i] > 0.5 + 1.e-8) q[i] -= 1.;
+    }
+    fprintf(fp, "%14.10f %14.10f %14.10f %d\n", q[0], q[1], q[2], wt[ik]);
+  }
+
+return;
+}
+
+/*----------------------------------------------------------------------------*/
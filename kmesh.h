@@ -0,0 +1,31 @@
+#ifndef KMESH_H
+#define KMESH_H
+
+#include "memory.h"
+#include "structure.h"
+#include "stdio.h"
+
+using namespace std;
+
+class KMesh {
+public:
+  KMesh(const Structure *, double);
+  ~KMesh();
+
+  int reduce(double [][3][3], int); // reduce the mesh by the rotations common to the lattices given
+  void write(FILE *, const char *); // write the reduced mesh as an explicit KPOINTS
+
+  int nk[3];                    // subdivisions along the reciprocal vectors of the reference cell
+  int nkpt;                     // number of irreducible k-points of the last reduction
+  int nop;                      // number of rotations used by the last reduction, time reversal excluded
+
+private:
+  Memory *memory;
+  const Structure *cell;
+  int ntot;                     // number of points of the full mesh
+  int *irr, *wt;                // irreducible points as mesh indices, and their weights
+  int *map;                     // representative of each point of the full mesh
+
+  int rotate(int, int [3][3], int);
+};
+#endif
@@ -3,7 +3,8 @@
 int main(int narg, char **arg)
 {
   Driver *driver = new Driver(narg, arg);
+  int status = driver->status;
   delete driver;
 
-return 0;
+return status;
 }
@@ -0,0 +1,200 @@
+#include "monitor.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "math.h"
+
+#define ZERO 1.e-10
+
+/*------------------------------------------------------------------------------
+ * Constructor of Monitor, to analyse the strained states available so far in
+ * info.dat while the script is still running, so that a bad setup is caught
+ * after the first few states instead of at the end
+ *------------------------------------------------------------------------------ */
+Monitor::Monitor(Elastic *el)
+{
+  elas = el;
+  tol = 0.;
+  nstate = nfail = ncheck = 0;
+  for (int i = 0; i < 6; ++i){
+    col[i] = 0;
+    for (int j = 0; j < 6; ++j) C[i][j] = pos[i][j] = neg[i][j] = 0.;
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, nothing to do
+ *------------------------------------------------------------------------------ */
+Monitor::~Monitor()
+{
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to evaluate the columns of C available and to check them. Column j
+ * is taken by central difference if both states of strain j are there, or by
+ * the one-sided difference to the reference state otherwise, as the C%d%dpos
+ * and C%d%dneg of the script. The checks, each failed if beyond tol, are:
+ *   sign,  C_jj > 0;
+ *   +/-,   max_i |C_ij(+e) - C_ij(-e)| / C_jj, if both states are available;
+ *   Cij/Cji, |C_ij - C_ji| / sqrt(C_ii C_jj), if both columns are available;
+ *   Born,  the principal submatrix of the columns available, symmetrized, is
+ *          positive definite, a necessary condition of the full one.
+ * Returns the number of checks failed, or -1 if the reference state is missing.
+ *------------------------------------------------------------------------------ */
+int Monitor::check(double tolerance)
+{
+  tol = tolerance;
+  nstate = nfail = ncheck = 0;
+  for (int i = 1; i < NSTATE; ++i) nstate += elas->have[i];
+  if (elas->have[0] == 0){
+    printf("\nERROR: the reference state is missing!\n");
+    return -1;
+  }
+
+  double (*st)[6] = elas->stress;
+  for (int j = 0; j < 6; ++j){
+    int hp = elas->have[2*j+1], hn = elas->have[2*j+2];
+    col[j] = hp + 2*hn;
+    if (col[j] == 0) continue;
+
+    double r = 0.1/elas->eps[j+1];
+    for (int i = 0; i < 6; ++i){
+      if (hp) pos[i][j] = (st[0][i] - st[2*j+1][i]) * r;
+      if (hn) neg[i][j] = (st[2*j+2][i] - st[0][i]) * r;
+      C[i][j] = col[j] == 3 ? 0.5*(pos[i][j] + neg[i][j]) : (hp ? pos[i][j] : neg[i][j]);
+    }
+  }
+
+  char str[64];
+  for (int j = 0; j < 6; ++j){
+    if (col[j] == 0) continue;
+    sprintf(str, "C%d%d > 0", j+1, j+1);
+    add(str, C[j][j], C[j][j] <= 0.);
+  }
+
+  for (int j = 0; j < 6; ++j){
+    if (col[j] != 3 || C[j][j] <= 0.) continue;
+    double dmax = 0.;
+    for (int i = 0; i < 6; ++i){
+      double d = fabs(pos[i][j] - neg[i][j]);
+      dmax = d > dmax ? d : dmax;
+    }
+    sprintf(str, "+/- of column %d", j+1);
+    add(str, dmax/C[j][j], dmax > tol*C[j][j]);
+  }
+
+  for (int i = 0; i < 6; ++i)
+  for (int j = i+1; j < 6; ++j){
+    if (col[i] == 0 || col[j] == 0 || C[i][i] <= 0. || C[j][j] <= 0.) continue;
+    double r = fabs(C[i][j] - C[j][i]) / sqrt(C[i][i]*C[j][j]);
+    sprintf(str, "C%d%d/C%d%d", i+1, j+1, j+1, i+1);
+    add(str, r, r > tol);
+  }
+
+  int idx[6], n = 0;
+  for (int j = 0; j < 6; ++j) if (col[j] && C[j][j] > 0.) idx[n++] = j;
+  if (n > 1){
+    double pmin;
+    int flag = born(n, idx, pmin);
+    strcpy(str, "Born, columns");
+    for (int k = 0; k < n; ++k) sprintf(str+strlen(str), " %d", idx[k]+1);
+    add(str, pmin, flag);
+  }
+
+return nfail;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to record the result of a check
+ *------------------------------------------------------------------------------ */
+void Monitor::add(const char *str, double val, int flag)
+{
+  if (ncheck >= MAXCHECK) return;
+  strncpy(what[ncheck], str, 63);
+  what[ncheck][63] = '\0';
+  value[ncheck] = val;
+  fail[ncheck] = flag;
+  nfail += flag;
+  ++ncheck;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to check that the symmetrized principal submatrix of C on the n
+ * columns in idx is positive definite, by Cholesky decomposition; pmin is the
+ * smallest pivot relative to the corresponding diagonal element. Returns 1 if
+ * the submatrix is not positive definite.
+ *------------------------------------------------------------------------------ */
+int Monitor::born(int n, int *idx, double &pmin)
+{
+  double a[6][6];
+  for (int i = 0; i < n; ++i)
+  for (int j = 0; j < n; ++j) a[i][j] = 0.5*(C[idx[i]][idx[j]] + C[idx[j]][idx[i]]);
+
+  pmin = 1.;
+  for (int k = 0; k < n; ++k){
+    double d = a[k][k];
+    for (int m = 0; m < k; ++m) d -= a[k][m]*a[k][m];
+    double p = d / C[idx[k]][idx[k]];
+    pmin = p < pmin ? p : pmin;
+    if (d < ZERO) return 1;
+
+    a[k][k] = sqrt(d);
+    for (int i = k+1; i < n; ++i){
+      double s = a[i][k];
+      for (int m = 0; m < k; ++m) s -= a[i][m]*a[k][m];
+      a[i][k] = s / a[k][k];
+    }
+  }
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the partial report to file
+ *------------------------------------------------------------------------------ */
+int Monitor::write(const char *fname)
+{
+  FILE *fp = fopen(fname, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return 1;
+  }
+  output(fp);
+  fclose(fp);
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to report the partial C, with '-' for the columns not yet available,
+ * and the result of each check
+ *------------------------------------------------------------------------------ */
+void Monitor::output(FILE *fp)
+{
+  static const char *how[4] = {"-", "+e", "-e", "+/-"};
+  fprintf(fp, "# Partial analysis with %d of the 12 strained states\n", nstate);
+  fprintf(fp, "# Partial elastic constants (GPa), unsymmetrized, column j from strain j:\n");
+  for (int j = 0; j < 6; ++j) fprintf(fp, j ? " %10s" : "#%10s", how[col[j]]);
+  fprintf(fp, "\n");
+  for (int i = 0; i < 6; ++i){
+    for (int j = 0; j < 6; ++j){
+      if (col[j]) fprintf(fp, " %10.2f", C[i][j]);
+      else fprintf(fp, " %10s", "-");
+    }
+    fprintf(fp, "\n");
+  }
+
+  fprintf(fp, "# Checks, with a relative tolerance of %g:\n", tol);
+  for (int k = 0; k < ncheck; ++k)
+    fprintf(fp, "#   %-24s %12.4g   %s\n", what[k], value[k], fail[k] ? "FAILED" : "ok");
+  fprintf(fp, "# %d of %d checks failed\n", nfail, ncheck);
+
+return;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,38 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include "elastic.h"
+#include "stdio.h"
+
+#define MAXCHECK 64
+
+using namespace std;
+
+class Monitor {
+public:
+  Monitor(Elastic *);
+  ~Monitor();
+
+  int check(double);            // evaluate the available columns and check them; returns # of failures
+  int write(const char *);      // write the partial report to file
+  void output(FILE *);          // report the partial C and the checks
+
+  double C[6][6];               // partial stiffness (GPa), unsymmetrized; columns as available
+  int col[6];                   // 0, none; 1, +e only; 2, -e only; 3, both states of each column
+  int nstate, nfail;            // number of strained states available, number of checks failed
+
+private:
+  Elastic *elas;
+
+  double tol;                   // relative tolerance of the checks
+  double pos[6][6], neg[6][6];  // one-sided estimates from the +e and -e states
+
+  int ncheck;
+  char what[MAXCHECK][64];      // description, value and flag of each check
+  double value[MAXCHECK];
+  int fail[MAXCHECK];
+
+  void add(const char *, double, int);
+  int born(int, int *, double &);
+};
+#endif
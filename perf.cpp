@@ -0,0 +1,324 @@
+#include "perf.h"
+#include "zfile.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#define MAXLINE 1024
+#define SEP " \n\t\r\f"
+
+static const char *perfname[NPERF] = {"wall_seconds", "cpu_seconds", "scf_iterations",
+  "loop_cpu_seconds", "loop_real_seconds", "max_rss_bytes"};
+static const char *perfhelp[NPERF] = {"Wall time of the state", "CPU time of the state from OUTCAR",
+  "Number of SCF iterations from OSZICAR", "Sum of the LOOP+ CPU times from OUTCAR",
+  "Sum of the LOOP+ real times from OUTCAR", "Maximum memory used from OUTCAR"};
+
+/*------------------------------------------------------------------------------
+ * Constructor of Perf, to time the phases of ecvasp and to report the timings
+ * of the states recorded by the script in perf.dat, each line of which reads:
+ *   label wall cpu nscf loop_cpu loop_real maxrss(kB)
+ * while the phase timings are kept as comments: # phase name wall cpu
+ *------------------------------------------------------------------------------ */
+Perf::Perf()
+{
+  memory = new Memory();
+  nphase = 0;
+  current = -1;
+  t0wall = t0cpu = 0.;
+  nstate = nmax = 0;
+  label = NULL;
+  data = NULL;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, free memory
+ *------------------------------------------------------------------------------ */
+Perf::~Perf()
+{
+  if (label) memory->destroy(label);
+  if (data) memory->destroy(data);
+  delete memory;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the wall clock time, in seconds
+ *------------------------------------------------------------------------------ */
+double Perf::wtime()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+
+return double(tv.tv_sec) + 1.e-6*double(tv.tv_usec);
+}
+
+/*------------------------------------------------------------------------------
+ * Method to find the phase by name, a new one is added if not found
+ *------------------------------------------------------------------------------ */
+int Perf::find(const char *name)
+{
+  for (int i = 0; i < nphase; ++i) if (strcmp(phase[i], name) == 0) return i;
+  if (nphase >= MAXPHASE) return -1;
+
+  strncpy(phase[nphase], name, 31);
+  phase[nphase][31] = '\0';
+  twall[nphase] = tcpu[nphase] = 0.;
+  timed[nphase] = 0;
+
+return nphase++;
+}
+
+/*------------------------------------------------------------------------------
+ * Methods to start and stop timing a phase; the time of a phase timed more
+ * than once is accumulated.
+ *------------------------------------------------------------------------------ */
+void Perf::start(const char *name)
+{
+  stop();
+  current = find(name);
+  if (current >= 0) timed[current] = 1;
+  t0wall = wtime();
+  t0cpu = double(clock())/double(CLOCKS_PER_SEC);
+
+return;
+}
+
+void Perf::stop()
+{
+  if (current < 0) return;
+  twall[current] += wtime() - t0wall;
+  tcpu[current] += double(clock())/double(CLOCKS_PER_SEC) - t0cpu;
+  current = -1;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to append the timings of the phases run by this process to file, with
+ * a header if it is new; those read from perf.dat are there already.
+ *------------------------------------------------------------------------------ */
+int Perf::append(const char *fname)
+{
+  stop();
+  FILE *fp = fopen(fname, "r");
+  int isnew = fp == NULL;
+  if (fp) fclose(fp);
+
+  fp = fopen(fname, "a");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return 1;
+  }
+  if (isnew) fprintf(fp, "# label wall(s) cpu(s) nscf loop_cpu(s) loop_real(s) maxrss(kB)\n");
+  for (int i = 0; i < nphase; ++i) if (timed[i]) fprintf(fp, "# phase %s %.6f %.6f\n", phase[i], twall[i], tcpu[i]);
+  fclose(fp);
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read perf.dat; the last record of each state or phase wins, while
+ * the phases timed by the current process take precedence over those read.
+ *------------------------------------------------------------------------------ */
+int Perf::read(const char *fname)
+{
+  char str[MAXLINE], *save;
+  ZFile zf;
+  FILE *fp = zf.open(fname);
+  if (fp == NULL){
+    printf("\nFile %s not found!\n", fname);
+    return 1;
+  }
+
+  int nown = nphase;
+  while (fgets(str, MAXLINE, fp)){
+    char *ptr = strtok_r(str, SEP, &save);
+    if (ptr == NULL) continue;
+
+    if (ptr[0] == '#'){
+      ptr = strtok_r(NULL, SEP, &save);
+      if (ptr == NULL || strcmp(ptr, "phase")) continue;
+      char *name = strtok_r(NULL, SEP, &save);
+      char *w = strtok_r(NULL, SEP, &save);
+      char *c = strtok_r(NULL, SEP, &save);
+      if (name == NULL || c == NULL) continue;
+      int ip = find(name);
+      if (ip < nown) continue;
+      twall[ip] = atof(w); tcpu[ip] = atof(c);
+      continue;
+    }
+
+    int is = 0;
+    for (is = 0; is < nstate; ++is) if (strcmp(label[is], ptr) == 0) break;
+    if (is == nstate){
+      if (nstate >= nmax){
+        nmax += 64;
+        memory->grow(label, nmax, 16, "label");
+        memory->grow(data, nmax, NPERF, "data");
+      }
+      strncpy(label[is], ptr, 15);
+      label[is][15] = '\0';
+      ++nstate;
+    }
+    for (int i = 0; i < NPERF; ++i){
+      ptr = strtok_r(NULL, SEP, &save);
+      data[is][i] = ptr ? atof(ptr) : 0.;
+    }
+    data[is][NPERF-1] *= 1024.;
+  }
+  if (zf.close()) return 2;
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to escape a string for the label values and JSON strings
+ *------------------------------------------------------------------------------ */
+void Perf::escape(const char *in, char *out)
+{
+  int n = 0;
+  for (const char *p = in; *p && n < MAXLINE-3; ++p){
+    if (*p == '"' || *p == '\\') out[n++] = '\\';
+    if (*p == '\n') { out[n++] = '\\'; out[n++] = 'n'; continue; }
+    out[n++] = *p;
+  }
+  out[n] = '\0';
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write base.json and base.prom; the latter is for the textfile
+ * collector of the node exporter, thus written to a temporary file first and
+ * then renamed, so that it is never read half written.
+ *------------------------------------------------------------------------------ */
+int Perf::report(const char *base)
+{
+  stop();
+  char cwd[MAXLINE], dir[MAXLINE];
+  if (getcwd(cwd, MAXLINE) == NULL) strcpy(cwd, ".");
+  escape(cwd, dir);
+
+  char *fname = new char [strlen(base)+16];
+  sprintf(fname, "%s.json", base);
+  int flag = json(fname, dir);
+  sprintf(fname, "%s.prom", base);
+  flag += prom(fname, dir);
+
+  printf("\nTimings of %d states and %d phases reported in %s.json and %s.prom\n", nstate, nphase, base, base);
+  delete []fname;
+
+return flag;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to sum the timings over the states, the max RSS being the largest
+ *------------------------------------------------------------------------------ */
+int Perf::totals(double *total)
+{
+  for (int i = 0; i < NPERF; ++i) total[i] = 0.;
+  for (int is = 0; is < nstate; ++is)
+  for (int i = 0; i < NPERF; ++i)
+    total[i] = i < NPERF-1 ? total[i] + data[is][i] : (data[is][i] > total[i] ? data[is][i] : total[i]);
+
+return nstate;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the name of each timing recorded for the states
+ *------------------------------------------------------------------------------ */
+const char *Perf::name(int i)
+{
+  if (i < 0 || i >= NPERF) return NULL;
+return perfname[i];
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the JSON report
+ *------------------------------------------------------------------------------ */
+int Perf::json(const char *fname, const char *dir)
+{
+  FILE *fp = fopen(fname, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return 1;
+  }
+
+  double total[NPERF];
+  totals(total);
+
+  fprintf(fp, "{\n  \"workdir\": \"%s\",\n  \"timestamp\": %ld,\n", dir, long(time(NULL)));
+  fprintf(fp, "  \"phases\": [");
+  for (int ip = 0; ip < nphase; ++ip){
+    fprintf(fp, "%s\n    {\"name\": \"%s\", \"wall_seconds\": %.6f, \"cpu_seconds\": %.6f}",
+      ip ? "," : "", phase[ip], twall[ip], tcpu[ip]);
+  }
+  fprintf(fp, "%s],\n  \"states\": [", nphase ? "\n  " : "");
+  for (int is = 0; is < nstate; ++is){
+    char str[MAXLINE];
+    escape(label[is], str);
+    fprintf(fp, "%s\n    {\"label\": \"%s\"", is ? "," : "", str);
+    for (int i = 0; i < NPERF; ++i){
+      fprintf(fp, ", \"%s\": %.15g", perfname[i], data[is][i]);
+    }
+    fprintf(fp, "}");
+  }
+  fprintf(fp, "%s],\n  \"total\": {\"states\": %d", nstate ? "\n  " : "", nstate);
+  for (int i = 0; i < NPERF; ++i) fprintf(fp, ", \"%s\": %.15g", perfname[i], total[i]);
+  fprintf(fp, "}\n}\n");
+  fclose(fp);
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the report in the Prometheus text exposition format
+ *------------------------------------------------------------------------------ */
+int Perf::prom(const char *fname, const char *dir)
+{
+  int n = strlen(fname)+16;
+  char *tmp = new char [n];
+  snprintf(tmp, n, "%s.%d", fname, int(getpid()));
+  FILE *fp = fopen(tmp, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", tmp);
+    delete []tmp;
+    return 1;
+  }
+
+  for (int i = 0; i < NPERF; ++i){
+    fprintf(fp, "# HELP ecvasp_state_%s %s.\n", perfname[i], perfhelp[i]);
+    fprintf(fp, "# TYPE ecvasp_state_%s gauge\n", perfname[i]);
+    for (int is = 0; is < nstate; ++is){
+      char str[MAXLINE];
+      escape(label[is], str);
+      fprintf(fp, "ecvasp_state_%s{workdir=\"%s\",state=\"%s\"} %.15g\n", perfname[i], dir, str, data[is][i]);
+    }
+  }
+  fprintf(fp, "# HELP ecvasp_phase_wall_seconds Wall time of each phase of ecvasp.\n");
+  fprintf(fp, "# TYPE ecvasp_phase_wall_seconds gauge\n");
+  for (int ip = 0; ip < nphase; ++ip)
+    fprintf(fp, "ecvasp_phase_wall_seconds{workdir=\"%s\",phase=\"%s\"} %.6f\n", dir, phase[ip], twall[ip]);
+  fprintf(fp, "# HELP ecvasp_phase_cpu_seconds CPU time of each phase of ecvasp.\n");
+  fprintf(fp, "# TYPE ecvasp_phase_cpu_seconds gauge\n");
+  for (int ip = 0; ip < nphase; ++ip)
+    fprintf(fp, "ecvasp_phase_cpu_seconds{workdir=\"%s\",phase=\"%s\"} %.6f\n", dir, phase[ip], tcpu[ip]);
+  fprintf(fp, "# HELP ecvasp_report_timestamp_seconds Time of the report.\n");
+  fprintf(fp, "# TYPE ecvasp_report_timestamp_seconds gauge\n");
+  fprintf(fp, "ecvasp_report_timestamp_seconds{workdir=\"%s\"} %ld\n", dir, long(time(NULL)));
+  fclose(fp);
+
+  int flag = rename(tmp, fname);
+  if (flag) printf("\nERROR: cannot rename %s to %s!\n", tmp, fname);
+  delete []tmp;
+
+return flag ? 1 : 0;
+}
+
+/*----------------------------------------------------------------------------*/
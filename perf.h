@@ -0,0 +1,42 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include "memory.h"
+
+#define MAXPHASE 32
+#define NPERF 6
+
+using namespace std;
+
+class Perf {
+public:
+  Perf();
+  ~Perf();
+
+  void start(const char *);     // start timing a phase, the current one is stopped
+  void stop();                  // stop timing the current phase
+  int append(const char *);     // append the phase timings to perf.dat
+  int read(const char *);       // read the per state records and phase timings from perf.dat
+  int report(const char *);     // write the JSON and Prometheus reports
+  int totals(double *);         // sums over the states (max for RSS); returns the number of states
+  static const char *name(int);
+
+private:
+  Memory *memory;
+  int nphase, current;
+  char phase[MAXPHASE][32];
+  double twall[MAXPHASE], tcpu[MAXPHASE];  // wall and CPU time of each phase (s)
+  int timed[MAXPHASE];          // flag of the phases timed by this process, not read
+  double t0wall, t0cpu;
+
+  int nstate, nmax;
+  char **label;
+  double **data;                // wall cpu nscf loop_cpu loop_real maxrss(kB) of each state
+
+  int find(const char *);
+  double wtime();
+  void escape(const char *, char *);
+  int json(const char *, const char *);
+  int prom(const char *, const char *);
+};
+#endif
@@ -0,0 +1,613 @@
+#include "pilot.h"
+#include "monitor.h"
+#include "zfile.h"
+#include "ecvasp.h"
+#include "stdlib.h"
+#include "string.h"
+#include "math.h"
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define MAXLINE 1024
+
+static double walltime();
+static int copyfile(const char *, const char *);
+static int reported(const char *);
+
+/*------------------------------------------------------------------------------
+ * Constructor of Pilot, to run the strained states of up to nmax structures as
+ * independent tasks within one allocation: the tasks are queued in the deques
+ * of the slots, each slot runs one task at a time, and a slot whose deque runs
+ * empty steals from the others, so that no slot idles while tasks are left.
+ *------------------------------------------------------------------------------ */
+Pilot::Pilot(int nmax)
+{
+  memory = new Memory();
+  maxstruct = nmax > 0 ? nmax : 1;
+  nstruct = ntask = 0;
+  ndone = nfail = nretried = 0;
+
+  sname = new char* [maxstruct];
+  sdir = new char* [maxstruct];
+  sdisp = new double [maxstruct][7];
+  memory->create(sleft, maxstruct, "sleft");
+  memory->create(sstat, maxstruct, "sstat");
+
+  int n = maxstruct*NSTATE;
+  memory->create(tstruct, n, "tstruct");
+  memory->create(tstate, n, "tstate");
+  memory->create(tstat, n, "tstat");
+  memory->create(ttry, n, "ttry");
+  memory->create(tbusy, n, "tbusy");
+
+  nslot = 0;
+  dq = NULL;
+  dhead = dcount = stask = NULL;
+  spid = NULL;
+  sstart = NULL;
+  busy = wall = tol = 0.;
+  abort = 0;
+  fres = NULL;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, free memory
+ *------------------------------------------------------------------------------ */
+Pilot::~Pilot()
+{
+  for (int i = 0; i < nstruct; ++i){
+    delete []sname[i];
+    delete []sdir[i];
+  }
+  delete []sname;
+  delete []sdir;
+  delete []sdisp;
+  memory->destroy(sleft);
+  memory->destroy(sstat);
+  memory->destroy(tstruct);
+  memory->destroy(tstate);
+  memory->destroy(tstat);
+  memory->destroy(ttry);
+  memory->destroy(tbusy);
+  if (dq) memory->destroy(dq);
+  if (dhead) memory->destroy(dhead);
+  if (dcount) memory->destroy(dcount);
+  if (stask) memory->destroy(stask);
+  if (spid) memory->destroy(spid);
+  if (sstart) memory->destroy(sstart);
+  delete memory;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to add the reference and the 12 strained states of cell, strained by
+ * +/- disp[idim] as the script does, as tasks in folder dir/<state>, each with
+ * its POSCAR and the INCAR, KPOINTS and POTCAR found in folder src. The results
+ * go to dir/info.dat; the states already there, from an earlier run of the
+ * batch, are not redone, provided they were strained by the same disp; the
+ * structure is refused otherwise. Returns the number of tasks added, -1 on error.
+ *------------------------------------------------------------------------------ */
+int Pilot::add(const Structure *cell, const char *name, const char *dir, const char *src, const double *disp)
+{
+  static const char *input[3] = {"INCAR", "KPOINTS", "POTCAR"};
+  if (nstruct >= maxstruct) return -1;
+  if (mkdir(dir, 0755) && errno != EEXIST){
+    printf("\nERROR: cannot create folder %s!\n", dir);
+    return -1;
+  }
+
+  char str[MAXLINE+16], path[MAXLINE];
+  Elastic *el = new Elastic();
+  snprintf(path, MAXLINE, "%s/info.dat", dir);
+  int old = access(path, F_OK) == 0;
+  if (old){
+    el->load_info(path);
+    for (int k = 1; k < NSTATE; ++k){
+      int idim = (k+1)/2;
+      if (el->have[k] == 0 || fabs(el->eps[idim] - disp[idim]) <= 1.e-5*fabs(disp[idim])) continue;
+      printf("\nERROR: %s holds states strained by %g along %d instead of %g; remove it to redo them!\n",
+        path, el->eps[idim], idim, disp[idim]);
+      delete el;
+      return -1;
+    }
+  }
+
+  int s = nstruct;
+  sname[s] = new char [strlen(name)+1];
+  strcpy(sname[s], name);
+  sdir[s] = new char [strlen(dir)+1];
+  strcpy(sdir[s], dir);
+  sleft[s] = sstat[s] = 0;
+  for (int i = 0; i < 7; ++i) sdisp[s][i] = disp[i];
+  ++nstruct;
+
+  if (!old){
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL){
+      printf("\nERROR: cannot open file %s for writting!\n", path);
+      delete el;
+      return -1;
+    }
+    time_t now = time(NULL);
+    fprintf(fp, "# Information on elastic constants calculations by the pilot job, since: %s", ctime(&now));
+    fclose(fp);
+  }
+
+  Structure *st = new Structure();
+  int n0 = ntask;
+  for (int k = 0; k < NSTATE; ++k){
+    if (el->have[k]) continue;
+    int idim = (k+1)/2;
+    if (k == 0) st->copy(cell);
+    else cell->strain(idim, k%2 ? disp[idim] : -disp[idim], st);
+
+    tstruct[ntask] = s;
+    tstate[ntask] = k;
+    tstat[ntask] = ttry[ntask] = 0;
+    tbusy[ntask] = 0.;
+    taskdir(ntask, path, MAXLINE);
+    if (mkdir(path, 0755) && errno != EEXIST){
+      printf("\nERROR: cannot create folder %s!\n", path);
+      break;
+    }
+
+    size_t need = 0;
+    st->write(NULL, 0, &need);
+    char *buf = new char [need];
+    st->write(buf, need, NULL);
+    snprintf(str, sizeof(str), "%s/POSCAR", path);
+    FILE *fp = fopen(str, "w");
+    if (fp){
+      fputs(buf, fp);
+      fclose(fp);
+    }
+    delete []buf;
+
+    for (int i = 0; i < 3; ++i){
+      char from[MAXLINE+16];
+      snprintf(from, sizeof(from), "%s/%s", src, input[i]);
+      snprintf(str, sizeof(str), "%s/%s", path, input[i]);
+      copyfile(from, str);
+    }
+    ++ntask;
+  }
+  sleft[s] = ntask - n0;
+  delete st;
+  delete el;
+
+return ntask - n0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to run all tasks, nslot at a time, each by the shell command cmd in
+ * its folder with the output in vasp.log. The structures are dealt round-robin
+ * to the slots, so that the states of one structure tend to run in the same
+ * slot; an idle slot takes the next task of its own deque, or steals the last
+ * one of the longest other deque. A task that fails, by its exit status or for
+ * the lack of stress or energy in its OUTCAR, is queued again up to nretry
+ * times. The results are streamed as the tasks complete: each state goes into
+ * the info.dat of its structure, whose available states are checked as ecvasp
+ * -incc does into partial.dat, with the remaining states of the structure
+ * dropped if a check fails and ab is set; once all the states of a structure
+ * are done, its Cij go to Cij.dat and to a line of file fname.
+ * Returns the number of structures not done.
+ *------------------------------------------------------------------------------ */
+int Pilot::run(const char *cmd, int ns, int nretry, double tolerance, int ab, const char *fname)
+{
+  nslot = ns > 0 ? ns : 1;
+  tol = tolerance;
+  abort = ab;
+  memory->create(dq, nslot, ntask > 0 ? ntask : 1, "dq");
+  memory->create(dhead, nslot, "dhead");
+  memory->create(dcount, nslot, "dcount");
+  memory->create(stask, nslot, "stask");
+  memory->create(spid, nslot, "spid");
+  memory->create(sstart, nslot, "sstart");
+  for (int i = 0; i < nslot; ++i){
+    dhead[i] = dcount[i] = 0;
+    spid[i] = 0;
+    stask[i] = -1;
+  }
+  for (int k = 0; k < ntask; ++k) push(tstruct[k] % nslot, k);
+
+  fres = fopen(fname, "w");
+  if (fres == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return nstruct;
+  }
+  fprintf(fres, "# %-22s %-8s %9s %9s %9s %9s %9s %9s %9s %9s %9s %9s %9s\n", "structure", "status",
+    "C11", "C22", "C33", "C12", "C13", "C23", "C44", "C55", "C66", "KVRH", "GVRH");
+  fflush(fres);
+  for (int s = 0; s < nstruct; ++s) if (sleft[s] == 0) stream(s);
+
+  printf("\nPilot job: %d tasks of %d structures on %d slots, by: %s\n", ntask, nstruct, nslot, cmd);
+  fflush(stdout);
+  double t0 = walltime();
+  int nrun = 0;
+  while (1){
+    for (int i = 0; i < nslot; ++i){
+      if (spid[i]) continue;
+      int k = pop(i);
+      if (k < 0) k = steal(i);
+      if (k < 0) continue;
+      if (launch(i, k, cmd) == 0) ++nrun;
+      else {
+        finish(i, -1);
+        retry(i, nretry);
+      }
+    }
+    if (nrun == 0){ // stop once nothing is queued either, a failed launch may have requeued its task
+      int nqueue = 0;
+      for (int i = 0; i < nslot; ++i) nqueue += dcount[i];
+      if (nqueue == 0) break;
+      continue;
+    }
+
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0){
+      if (errno == EINTR) continue;
+      break;
+    }
+    for (int i = 0; i < nslot; ++i){
+      if (spid[i] != pid) continue;
+      spid[i] = 0;
+      --nrun;
+      finish(i, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+      retry(i, nretry);
+      break;
+    }
+  }
+  wall = walltime() - t0;
+
+  output(stdout);
+  output(fres);
+  fclose(fres);
+  fres = NULL;
+
+  int nleft = 0;
+  for (int s = 0; s < nstruct; ++s) nleft += sstat[s] != 1;
+
+return nleft;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to queue again the task of slot i if it has failed, to the tail of the
+ * deque of the slot, unless it has been tried nretry times already or its
+ * structure has been aborted; otherwise the task is dropped for good
+ *------------------------------------------------------------------------------ */
+void Pilot::retry(int i, int nretry)
+{
+  int k = stask[i], s = tstruct[k];
+  if (tstat[k] != 0) return;
+  if (ttry[k] <= nretry && sstat[s] != 3){
+    ++nretried;
+    push(i, k);
+    return;
+  }
+
+  tstat[k] = sstat[s] == 3 ? 3 : 2;
+  if (tstat[k] == 2) ++nfail;
+  if (sstat[s] == 0) sstat[s] = 2;
+  --sleft[s];
+  stream(s);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to append task k to the tail of the deque of slot i
+ *------------------------------------------------------------------------------ */
+void Pilot::push(int i, int k)
+{
+  dq[i][(dhead[i] + dcount[i]) % ntask] = k;
+  ++dcount[i];
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to take the next task from the head of the deque of slot i, skipping
+ * those of the structures aborted; -1 if none
+ *------------------------------------------------------------------------------ */
+int Pilot::pop(int i)
+{
+  while (dcount[i] > 0){
+    int k = dq[i][dhead[i]];
+    dhead[i] = (dhead[i] + 1) % ntask;
+    --dcount[i];
+    if (tstat[k] == 0) return k;
+  }
+
+return -1;
+}
+
+/*------------------------------------------------------------------------------
+ * Method for slot i to steal a task from the tail of the longest other deque,
+ * skipping those of the structures aborted; -1 if none is left
+ *------------------------------------------------------------------------------ */
+int Pilot::steal(int i)
+{
+  while (1){
+    int v = -1;
+    for (int j = 0; j < nslot; ++j) if (j != i && dcount[j] > 0 && (v < 0 || dcount[j] > dcount[v])) v = j;
+    if (v < 0) return -1;
+
+    --dcount[v];
+    int k = dq[v][(dhead[v] + dcount[v]) % ntask];
+    if (tstat[k] == 0) return k;
+  }
+
+return -1;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to start task k in slot i: the shell runs cmd in the folder of the
+ * task, with stdout and stderr to vasp.log there
+ *------------------------------------------------------------------------------ */
+int Pilot::launch(int i, int k, const char *cmd)
+{
+  char dir[MAXLINE];
+  taskdir(k, dir, MAXLINE);
+  ++ttry[k];
+  stask[i] = k;
+  sstart[i] = walltime();
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid < 0){
+    printf("\nERROR: cannot fork for task %s!\n", dir);
+    return 1;
+  }
+  if (pid == 0){
+    if (chdir(dir)) _exit(126);
+    unlink("OUTCAR");
+    int fd = open("vasp.log", O_WRONLY|O_CREAT|O_APPEND, 0644);
+    if (fd >= 0){
+      dup2(fd, 1);
+      dup2(fd, 2);
+      close(fd);
+    }
+    execl("/bin/sh", "sh", "-c", cmd, (char *) NULL);
+    _exit(127);
+  }
+  spid[i] = pid;
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to handle the task of slot i that exited with status; if it has
+ * succeeded, its result is appended to the info.dat of its structure, and the
+ * structure analysed; otherwise the task is left pending for the caller.
+ *------------------------------------------------------------------------------ */
+void Pilot::finish(int i, int status)
+{
+  int k = stask[i], s = tstruct[k];
+  double dt = walltime() - sstart[i];
+  tbusy[k] += dt;
+  busy += dt;
+
+  char dir[MAXLINE], str[MAXLINE];
+  taskdir(k, dir, MAXLINE);
+  double p[6], eng, mag;
+  if (status != 0 || collect(k, p, eng, mag)){
+    printf("  %-40s failed, attempt %d, status %d\n", dir, ttry[k], status);
+    fflush(stdout);
+    return;
+  }
+
+  snprintf(str, MAXLINE, "%s/info.dat", sdir[s]);
+  FILE *fp = fopen(str, "a");
+  if (fp){
+    int k0 = tstate[k], idim = (k0+1)/2;
+    // XX YY ZZ XY YZ ZX of OUTCAR to the xx yy zz xy xz yz of info.dat
+    if (k0 == 0) fprintf(fp, "0   0  %.10g %.10g %.10g %.10g %.10g %.10g %.8f\n", p[0], p[1], p[2], p[3], p[5], p[4], eng);
+    else fprintf(fp, "%d %g  %.10g %.10g %.10g %.10g %.10g %.10g %.8f %g\n", idim, k0%2 ? sdisp[s][idim] : -sdisp[s][idim], p[0], p[1], p[2], p[3], p[5], p[4], eng, mag);
+    fclose(fp);
+  }
+  tstat[k] = 1;
+  ++ndone;
+  --sleft[s];
+  printf("  %-40s done in %.1f s\n", dir, dt);
+  fflush(stdout);
+  stream(s);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read the stress (kB, as the "in kB" line: XX YY ZZ XY YZ ZX) and
+ * the energy of the last ionic step from the OUTCAR of task k, and the
+ * magnetization from its OSZICAR; returns 1 if the stress or energy is missing
+ *------------------------------------------------------------------------------ */
+int Pilot::collect(int k, double *p, double &eng, double &mag)
+{
+  char dir[MAXLINE], str[MAXLINE+16];
+  taskdir(k, dir, MAXLINE);
+  snprintf(str, sizeof(str), "%s/OUTCAR", dir);
+  ZFile zf;
+  FILE *fp = zf.open(str);
+  if (fp == NULL) return 1;
+
+  int flag = 0;
+  while (fgets(str, MAXLINE, fp)){
+    char *ptr;
+    if ((ptr = strstr(str, "in kB"))){
+      if (sscanf(ptr+5, "%lg %lg %lg %lg %lg %lg", &p[0], &p[1], &p[2], &p[3], &p[4], &p[5]) == 6) flag |= 1;
+    } else if ((ptr = strstr(str, "energy  without entropy="))){
+      if (sscanf(ptr+24, "%lg", &eng) == 1) flag |= 2;
+    }
+  }
+  if (zf.close()) return 1;
+
+  mag = 0.;
+  snprintf(str, sizeof(str), "%s/OSZICAR", dir);
+  fp = fopen(str, "r");
+  if (fp){
+    while (fgets(str, MAXLINE, fp)){
+      char *ptr = strstr(str, "mag=");
+      if (ptr) mag = atof(ptr+4);
+    }
+    fclose(fp);
+  }
+
+return flag != 3;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to analyse the states of structure s available so far: once all are
+ * done, its Cij go to Cij.dat, the report to its info.dat, unless there from an
+ * earlier run of the batch, and a line to the results; before that, the columns
+ * available are checked into partial.dat
+ *------------------------------------------------------------------------------ */
+void Pilot::stream(int s)
+{
+  char str[MAXLINE];
+  snprintf(str, MAXLINE, "%s/info.dat", sdir[s]);
+  Elastic *el = new Elastic();
+  int nmiss = el->load_info(str);
+
+  if (nmiss == 0 && sstat[s] == 0){
+    if (el->read_info(str) == 0){
+      FILE *fp = reported(str) ? NULL : fopen(str, "a");
+      if (fp){
+        el->output(fp);
+        fclose(fp);
+      }
+      snprintf(str, MAXLINE, "%s/Cij.dat", sdir[s]);
+      el->write(str);
+      sstat[s] = 1;
+
+      double m[NMOD];
+      el->moduli(el->C, el->S, m);
+      double *c = &el->C[0][0];
+      fprintf(fres, "  %-22s %-8s %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", sname[s], "done",
+        c[0], c[7], c[14], c[1], c[2], c[8], c[21], c[28], c[35], m[2], m[5]);
+    } else sstat[s] = 2;
+
+  } else if (nmiss > 0 && el->have[0] && sstat[s] == 0){
+    Monitor *mon = new Monitor(el);
+    int nbad = mon->check(tol);
+    snprintf(str, MAXLINE, "%s/partial.dat", sdir[s]);
+    mon->write(str);
+    delete mon;
+
+    if (nbad > 0 && abort){
+      printf("  %-40s aborted, %d check(s) failed, see %s\n", sdir[s], nbad, str);
+      sstat[s] = 3;
+      for (int k = 0; k < ntask; ++k){
+        if (tstruct[k] != s || tstat[k] != 0) continue;
+        int running = 0;
+        for (int i = 0; i < nslot; ++i) running += spid[i] && stask[i] == k;
+        if (running) continue;
+        tstat[k] = 3;
+        --sleft[s];
+      }
+    }
+  }
+  delete el;
+
+  if (sstat[s] > 1 && sleft[s] == 0)
+    fprintf(fres, "  %-22s %s\n", sname[s], sstat[s] == 2 ? "failed" : "aborted");
+  fflush(fres);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to report the batch: tasks, retries, failures and the use of the slots
+ *------------------------------------------------------------------------------ */
+void Pilot::output(FILE *fp)
+{
+  int nstat[4] = {0, 0, 0, 0};
+  for (int s = 0; s < nstruct; ++s) ++nstat[sstat[s]];
+  double tmax = 0.;
+  for (int k = 0; k < ntask; ++k) tmax = tbusy[k] > tmax ? tbusy[k] : tmax;
+
+  fprintf(fp, "# Pilot job of %d structures, %d tasks on %d slots, wall time %.2f s\n", nstruct, ntask, nslot, wall);
+  fprintf(fp, "# Tasks done %d, failed %d, retries %d; longest task %.2f s\n", ndone, nfail, nretried, tmax);
+  fprintf(fp, "# Slots busy %.1f%% of the wall time\n", wall > 0. ? 100.*busy/(wall*nslot) : 0.);
+  fprintf(fp, "# Structures done %d, failed %d, aborted %d\n", nstat[1], nstat[2], nstat[3]);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the folder of task k
+ *------------------------------------------------------------------------------ */
+void Pilot::taskdir(int k, char *dir, size_t n)
+{
+  char lab[16];
+  label(tstate[k], lab, sizeof(lab));
+  snprintf(dir, n, "%s/%s", sdir[tstruct[k]], lab);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the label of state k as the script names them: eq, 1p, 1n, ...
+ *------------------------------------------------------------------------------ */
+void Pilot::label(int k, char *lab, size_t n)
+{
+  if (k == 0) snprintf(lab, n, "eq");
+  else snprintf(lab, n, "%d%c", (k+1)/2, k%2 ? 'p' : 'n');
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * To get the wall time, in seconds
+ *------------------------------------------------------------------------------ */
+static double walltime()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+return double(ts.tv_sec) + 1.e-9*double(ts.tv_nsec);
+}
+
+/*------------------------------------------------------------------------------
+ * To copy file src to dst; nothing is done if src is absent
+ *------------------------------------------------------------------------------ */
+static int copyfile(const char *src, const char *dst)
+{
+  FILE *in = fopen(src, "rb");
+  if (in == NULL) return 1;
+  FILE *out = fopen(dst, "wb");
+  if (out == NULL){
+    fclose(in);
+    return 2;
+  }
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) fwrite(buf, 1, n, out);
+  fclose(in);
+  fclose(out);
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * To check if the info.dat fname already holds the report of the Cij
+ *------------------------------------------------------------------------------ */
+static int reported(const char *fname)
+{
+  FILE *fp = fopen(fname, "r");
+  if (fp == NULL) return 0;
+  char str[MAXLINE];
+  int flag = 0;
+  while (flag == 0 && fgets(str, MAXLINE, fp)) flag = strncmp(str, "# Elastic constants (GPa):", 26) == 0;
+  fclose(fp);
+
+return flag;
+}
+
+/*----------------------------------------------------------------------------*/
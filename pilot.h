@@ -0,0 +1,56 @@
+#ifndef PILOT_H
+#define PILOT_H
+
+#include "memory.h"
+#include "structure.h"
+#include "elastic.h"
+#include "stdio.h"
+#include <sys/types.h>
+
+#define NRETRY 2
+
+using namespace std;
+
+class Pilot {
+public:
+  Pilot(int);
+  ~Pilot();
+
+  int add(const Structure *, const char *, const char *, const char *, const double *); // the states of a structure
+  int run(const char *, int, int, double, int, const char *); // run all tasks; returns # of structures not done
+  void output(FILE *);          // report the batch
+
+  int nstruct, ntask;           // number of structures and of tasks
+  int ndone, nfail, nretried;   // tasks done, failed for good, and retries
+
+private:
+  Memory *memory;
+  int maxstruct;
+  char **sname, **sdir;         // name and folder of each structure
+  int *sleft, *sstat;           // tasks left of each structure; 0, running; 1, done; 2, failed; 3, aborted
+  double (*sdisp)[7];           // strain magnitude of each Voigt component of each structure
+
+  int *tstruct, *tstate, *tstat, *ttry; // task: structure, state (as in Elastic), status, attempts
+  double *tbusy;                // wall time taken by each task
+
+  int nslot;                    // number of tasks run at a time
+  int **dq, *dhead, *dcount;    // deque of tasks of each slot, as ring buffers
+  pid_t *spid;                  // process of each slot, 0 if idle
+  int *stask;                   // task of each slot
+  double *sstart, busy, wall;   // start of the task of each slot; total busy and wall time
+  double tol;                   // tolerance of the checks of the partial results
+  int abort;                    // flag to drop the remaining states of a structure failing a check
+  FILE *fres;                   // results streamed as the structures complete
+
+  void push(int, int);
+  int pop(int);
+  int steal(int);
+  int launch(int, int, const char *);
+  void finish(int, int);
+  void retry(int, int);
+  int collect(int, double *, double &, double &);
+  void stream(int);
+  void taskdir(int, char *, size_t);
+  static void label(int, char *, size_t);
+};
+#endif
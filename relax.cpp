@@ -0,0 +1,209 @@
+#include "relax.h"
+#include "zfile.h"
+#include "ecvasp.h"
+#include "stdlib.h"
+#include "string.h"
+#include "math.h"
+
+#define ZERO 1.e-10
+#define MAXLINE 1024
+#define MAXDISP 0.2
+
+/*------------------------------------------------------------------------------
+ * Constructor of Relax, to set up the starting positions of the ionic
+ * relaxations of the strained cells, and to report the relaxed-ion constants
+ *------------------------------------------------------------------------------ */
+Relax::Relax()
+{
+  memory = new Memory();
+  umax = 0.;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor
+ *------------------------------------------------------------------------------ */
+Relax::~Relax()
+{
+  delete memory;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to predict the internal relaxation of the clamped strained cell s to
+ * first order: each atom is displaced by (f - f0)/k, with f the forces on the
+ * clamped cell, f0 those of the equilibrium state (zero if f0file is NULL),
+ * and k an effective spring constant (eV/A^2), i.e., the force constant
+ * matrix is approximated by its diagonal. The net translation is removed and
+ * each displacement is capped at MAXDISP; positions of s are updated.
+ *------------------------------------------------------------------------------ */
+int Relax::predict(Structure *s, const char *f0file, const char *ffile, double k)
+{
+  if (s == NULL || ffile == NULL) return ECV_ERR_NULL;
+  if (s->natom < 1) return ECV_ERR_NOATOM;
+  if (k < ZERO) return ECV_ERR_RANGE;
+
+  double **f, **f0;
+  memory->create(f, s->natom, 3, "f");
+  memory->create(f0, s->natom, 3, "f0");
+  for (int i = 0; i < s->natom; ++i) f0[i][0] = f0[i][1] = f0[i][2] = 0.;
+
+  int flag = forces(ffile, s->natom, f);
+  if (flag == ECV_OK && f0file) flag = forces(f0file, s->natom, f0);
+  if (flag == ECV_OK){
+    double r = 1./k;
+    for (int i = 0; i < s->natom; ++i)
+    for (int j = 0; j < 3; ++j) f[i][j] = (f[i][j] - f0[i][j]) * r;
+    displace(s, f);
+  }
+
+  memory->destroy(f);
+  memory->destroy(f0);
+
+return flag;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to set the starting positions of the clamped cell s, strained by -e,
+ * from the relaxation of that strained by +e: to first order the internal
+ * displacements are odd in the strain, so those of relaxed with respect to
+ * clamped, in Cartesian coordinates, are applied to s with opposite sign.
+ *------------------------------------------------------------------------------ */
+int Relax::mirror(Structure *s, const Structure *clamped, const Structure *relaxed)
+{
+  if (s == NULL || clamped == NULL || relaxed == NULL) return ECV_ERR_NULL;
+  if (s->natom < 1) return ECV_ERR_NOATOM;
+  if (clamped->natom != s->natom || relaxed->natom != s->natom) return ECV_ERR_FORMAT;
+
+  double **u;
+  memory->create(u, s->natom, 3, "u");
+  for (int i = 0; i < s->natom; ++i){
+    double d[3];
+    for (int j = 0; j < 3; ++j){
+      d[j] = relaxed->atpos[i][j] - clamped->atpos[i][j];
+      d[j] -= floor(d[j] + 0.5);
+    }
+    for (int j = 0; j < 3; ++j){
+      u[i][j] = 0.;
+      for (int m = 0; m < 3; ++m) u[i][j] -= d[m] * relaxed->axis[m][j] * relaxed->alat;
+    }
+  }
+  displace(s, u);
+  memory->destroy(u);
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read the forces (eV/A) on natom atoms from the last TOTAL-FORCE
+ * block of OUTCAR, compressed ones as well
+ *------------------------------------------------------------------------------ */
+int Relax::forces(const char *fname, int natom, double **f)
+{
+  char str[MAXLINE];
+  ZFile zf;
+  FILE *fp = zf.open(fname);
+  if (fp == NULL) return ECV_ERR_FILE;
+
+  int nblock = 0;
+  while (fgets(str, MAXLINE, fp)){
+    if (strstr(str, "TOTAL-FORCE") == NULL) continue;
+    if (fgets(str, MAXLINE, fp) == NULL) break;
+
+    int n = 0;
+    while (n < natom && fgets(str, MAXLINE, fp)){
+      double x[6];
+      if (sscanf(str, "%lg %lg %lg %lg %lg %lg", &x[0], &x[1], &x[2], &x[3], &x[4], &x[5]) != 6) break;
+      f[n][0] = x[3]; f[n][1] = x[4]; f[n][2] = x[5];
+      ++n;
+    }
+    if (n < natom) break;
+    ++nblock;
+  }
+  if (zf.close()) return ECV_ERR_FILE;
+
+  if (nblock < 1) return ECV_ERR_FORMAT;
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to displace the atoms of s by u (Cartesian, A), after removing the
+ * net translation and capping each displacement at MAXDISP
+ *------------------------------------------------------------------------------ */
+void Relax::displace(Structure *s, double **u)
+{
+  double mean[3] = {0., 0., 0.};
+  for (int i = 0; i < s->natom; ++i)
+  for (int j = 0; j < 3; ++j) mean[j] += u[i][j];
+  for (int j = 0; j < 3; ++j) mean[j] /= double(s->natom);
+
+  // inverse of the lattice, in Angstrom
+  double a[3][3], inv[3][3];
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) a[i][j] = s->axis[i][j] * s->alat;
+  double det = a[0][0]*(a[1][1]*a[2][2] - a[1][2]*a[2][1])
+             - a[0][1]*(a[1][0]*a[2][2] - a[1][2]*a[2][0])
+             + a[0][2]*(a[1][0]*a[2][1] - a[1][1]*a[2][0]);
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j){
+    int i1 = (j+1)%3, i2 = (j+2)%3, j1 = (i+1)%3, j2 = (i+2)%3;
+    inv[i][j] = (a[i1][j1]*a[i2][j2] - a[i1][j2]*a[i2][j1]) / det;
+  }
+
+  umax = 0.;
+  for (int i = 0; i < s->natom; ++i){
+    double d[3], r = 0.;
+    for (int j = 0; j < 3; ++j){
+      d[j] = u[i][j] - mean[j];
+      r += d[j] * d[j];
+    }
+    r = sqrt(r);
+    if (r > MAXDISP){
+      for (int j = 0; j < 3; ++j) d[j] *= MAXDISP/r;
+      r = MAXDISP;
+    }
+    umax = r > umax ? r : umax;
+
+    for (int j = 0; j < 3; ++j)
+    for (int m = 0; m < 3; ++m) s->atpos[i][j] += d[m] * inv[m][j];
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to report the clamped-ion and relaxed-ion constants, and the
+ * internal strain contribution, i.e., their difference
+ *------------------------------------------------------------------------------ */
+void Relax::output(FILE *fp, Elastic *clamped, Elastic *relaxed)
+{
+  fprintf(fp, "# Clamped-ion elastic constants (GPa):\n");
+  for (int i = 0; i < 6; ++i){
+    for (int j = 0; j < 6; ++j) fprintf(fp, " %10.2f", clamped->C[i][j]);
+    fprintf(fp, "\n");
+  }
+  fprintf(fp, "# Relaxed-ion elastic constants (GPa):\n");
+  for (int i = 0; i < 6; ++i){
+    for (int j = 0; j < 6; ++j) fprintf(fp, " %10.2f", relaxed->C[i][j]);
+    fprintf(fp, "\n");
+  }
+  fprintf(fp, "# Internal strain contribution, relaxed - clamped (GPa):\n");
+  for (int i = 0; i < 6; ++i){
+    for (int j = 0; j < 6; ++j) fprintf(fp, " %10.2f", relaxed->C[i][j] - clamped->C[i][j]);
+    fprintf(fp, "\n");
+  }
+
+  double mc[NMOD], mr[NMOD];
+  clamped->moduli(clamped->C, clamped->S, mc);
+  relaxed->moduli(relaxed->C, relaxed->S, mr);
+  fprintf(fp, "# Derived moduli:      clamped      relaxed   difference\n");
+  for (int k = 0; k < NMOD; ++k)
+    fprintf(fp, "#   %-8s = %12g %12g %12g\n", Elastic::modname[k], mc[k], mr[k], mr[k] - mc[k]);
+
+return;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,28 @@
+#ifndef RELAX_H
+#define RELAX_H
+
+#include "memory.h"
+#include "structure.h"
+#include "elastic.h"
+#include "stdio.h"
+
+using namespace std;
+
+class Relax {
+public:
+  Relax();
+  ~Relax();
+
+  int predict(Structure *, const char *, const char *, double); // first order guess from the forces
+  int mirror(Structure *, const Structure *, const Structure *); // guess from the relaxation of the opposite strain
+  void output(FILE *, Elastic *, Elastic *); // clamped, relaxed C and the internal strain contribution
+
+  double umax;                  // largest displacement applied, in Angstrom
+
+private:
+  Memory *memory;
+
+  int forces(const char *, int, double **);
+  void displace(Structure *, double **);
+};
+#endif
@@ -0,0 +1,684 @@
+#include "structure.h"
+#include "ecvasp.h"
+#include "zfile.h"
+#include "symmetry.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include <ctype.h>
+#include "math.h"
+
+#define ZERO 1.e-10
+#define MAXLINE 1024
+#define SEP " \t\r\f"
+
+static size_t append(char *, size_t, size_t, const char *);
+
+/*------------------------------------------------------------------------------
+ * Constructor of Structure, the configuration read from a POSCAR
+ *------------------------------------------------------------------------------ */
+Structure::Structure()
+{
+  memory = new Memory();
+  title = element = NULL;
+  ntm = NULL;
+  atpos = NULL;
+  ntype = natom = 0;
+  alat = 1.;
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) axis[i][j] = double(i == j);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, free memory
+ *------------------------------------------------------------------------------ */
+Structure::~Structure()
+{
+  clear();
+  delete memory;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to free the configuration held
+ *------------------------------------------------------------------------------ */
+void Structure::clear()
+{
+  if (title) delete []title;
+  if (element) delete []element;
+  if (ntm) delete []ntm;
+  if (atpos) memory->destroy(atpos);
+  title = element = NULL;
+  ntm = NULL;
+  atpos = NULL;
+  ntype = natom = 0;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to cut the next line off the buffer at ptr, NULL if nothing left
+ *------------------------------------------------------------------------------ */
+char *Structure::nextline(char *&ptr)
+{
+  if (ptr == NULL || *ptr == '\0') return NULL;
+  char *line = ptr;
+  ptr = strchr(ptr, '\n');
+  if (ptr) *ptr++ = '\0';
+
+return line;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to parse the text of a POSCAR of VASP 4 or 5 with direct coordinates;
+ * returns one of the ECV_ codes. Reentrant, the text is not modified.
+ *------------------------------------------------------------------------------ */
+int Structure::parse(const char *text)
+{
+  if (text == NULL) return ECV_ERR_NULL;
+  clear();
+
+  char *buf = new char [strlen(text)+1];
+  strcpy(buf, text);
+  int flag = scan(buf);
+  delete []buf;
+  if (flag != ECV_OK) clear();
+
+return flag;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to scan the lines of a POSCAR held in buf, which is destroyed
+ *------------------------------------------------------------------------------ */
+int Structure::scan(char *buf)
+{
+  char *next = buf, *line, *ptr, *save;
+
+  // title and scale factor
+  if ((line = nextline(next)) == NULL) return ECV_ERR_FORMAT;
+  title = new char [strlen(line)+2];
+  sprintf(title, "%s\n", line);
+
+  if ((line = nextline(next)) == NULL) return ECV_ERR_FORMAT;
+  if ((ptr = strtok_r(line, SEP, &save)) == NULL) return ECV_ERR_FORMAT;
+  alat = atof(ptr);
+
+  for (int i = 0; i < 3; ++i){
+    if ((line = nextline(next)) == NULL) return ECV_ERR_FORMAT;
+    ptr = strtok_r(line, SEP, &save);
+    for (int j = 0; j < 3; ++j){
+      if (ptr == NULL) return ECV_ERR_FORMAT;
+      axis[i][j] = atof(ptr);
+      ptr = strtok_r(NULL, SEP, &save);
+    }
+  }
+
+  // element names, if any, and the number of atoms of each type
+  if ((line = nextline(next)) == NULL) return ECV_ERR_FORMAT;
+  ptr = line;
+  while (*ptr && strchr(SEP, *ptr)) ++ptr;
+  if (isalpha(ptr[0])){
+    element = new char [strlen(line)+2];
+    sprintf(element, "%s\n", line);
+    if ((line = nextline(next)) == NULL) return ECV_ERR_FORMAT;
+  }
+  ntm = new int [strlen(line)/2+1];
+  ntype = natom = 0;
+  ptr = strtok_r(line, SEP, &save);
+  while (ptr && isdigit(ptr[0])){
+    ntm[ntype] = atoi(ptr);
+    natom += ntm[ntype++];
+    ptr = strtok_r(NULL, SEP, &save);
+  }
+  if (natom < 1) return ECV_ERR_NOATOM;
+
+  // selective dynamics and the kind of coordinates
+  if ((line = nextline(next)) == NULL) return ECV_ERR_FORMAT;
+  ptr = strtok_r(line, SEP, &save);
+  if (ptr && (ptr[0] == 'S' || ptr[0] == 's')){
+    if ((line = nextline(next)) == NULL) return ECV_ERR_FORMAT;
+    ptr = strtok_r(line, SEP, &save);
+  }
+  if (ptr == NULL) return ECV_ERR_FORMAT;
+  if (ptr[0] == 'C' || ptr[0] == 'c' || ptr[0] == 'K' || ptr[0] == 'k') return ECV_ERR_CARTESIAN;
+
+  memory->create(atpos, natom, 3, "atpos");
+  if (atpos == NULL) return ECV_ERR_MEMORY;
+  for (int i = 0; i < natom; ++i){
+    if ((line = nextline(next)) == NULL) return ECV_ERR_FORMAT;
+    ptr = strtok_r(line, SEP, &save);
+    for (int j = 0; j < 3; ++j){
+      if (ptr == NULL) return ECV_ERR_FORMAT;
+      atpos[i][j] = atof(ptr);
+      ptr = strtok_r(NULL, SEP, &save);
+    }
+  }
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read a POSCAR, compressed one is read via streaming decompression
+ *------------------------------------------------------------------------------ */
+int Structure::read(const char *fname)
+{
+  if (fname == NULL) return ECV_ERR_NULL;
+  ZFile zf;
+  FILE *fp = zf.open(fname);
+  if (fp == NULL) return ECV_ERR_FILE;
+
+  size_t n = 0, nmax = MAXLINE;
+  char *buf = (char *) malloc(nmax+1);
+  size_t nr;
+  while (buf && (nr = fread(buf+n, 1, nmax-n, fp)) > 0){
+    n += nr;
+    if (n == nmax){
+      nmax *= 2;
+      char *tmp = (char *) realloc(buf, nmax+1);
+      if (tmp == NULL) free(buf);
+      buf = tmp;
+    }
+  }
+  if (zf.close()){
+    free(buf);
+    return ECV_ERR_FILE;
+  }
+  if (buf == NULL) return ECV_ERR_MEMORY;
+
+  buf[n] = '\0';
+  int flag = parse(buf);
+  free(buf);
+
+return flag;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to copy another configuration
+ *------------------------------------------------------------------------------ */
+int Structure::copy(const Structure *src)
+{
+  if (src == NULL) return ECV_ERR_NULL;
+  if (src == this) return ECV_OK;
+  clear();
+
+  if (src->title){
+    title = new char [strlen(src->title)+1];
+    strcpy(title, src->title);
+  }
+  if (src->element){
+    element = new char [strlen(src->element)+1];
+    strcpy(element, src->element);
+  }
+  alat = src->alat;
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) axis[i][j] = src->axis[i][j];
+
+  ntype = src->ntype;
+  natom = src->natom;
+  if (ntype > 0){
+    ntm = new int [ntype];
+    for (int i = 0; i < ntype; ++i) ntm[i] = src->ntm[i];
+  }
+  if (natom > 0){
+    memory->create(atpos, natom, 3, "atpos");
+    if (atpos == NULL) return ECV_ERR_MEMORY;
+    for (int i = 0; i < natom; ++i)
+    for (int j = 0; j < 3; ++j) atpos[i][j] = src->atpos[i][j];
+  }
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to add strain e along Voigt component idim to the deformation matrix
+ * D, which multiplies the lattice vectors (rows) from the right; the
+ * deformation gradient is thus D^T.
+ *------------------------------------------------------------------------------ */
+void Structure::strainmat(int idim, double e, double D[3][3])
+{
+  if (idim <= 3) D[idim-1][idim-1] += e;
+  if (idim == 4) D[2][1] = e;
+  if (idim == 5) D[2][0] = e;
+  if (idim == 6) D[1][0] = e;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the lattice ax strained by e along Voigt component idim
+ *------------------------------------------------------------------------------ */
+void Structure::deform(int idim, double e, double ax[3][3]) const
+{
+  double D[3][3];
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) D[i][j] = double(i == j);
+  strainmat(idim, e, D);
+
+  deform(D, ax);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the lattice ax deformed by D, i.e., ax = axis * D
+ *------------------------------------------------------------------------------ */
+void Structure::deform(double D[3][3], double ax[3][3]) const
+{
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j){
+    ax[i][j] = 0.;
+    for (int m = 0; m < 3; ++m) ax[i][j] += axis[i][m] * D[m][j];
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the configuration strained by e along Voigt component idim
+ *------------------------------------------------------------------------------ */
+int Structure::strain(int idim, double e, Structure *out) const
+{
+  if (out == NULL) return ECV_ERR_NULL;
+  if (idim < 1 || idim > 6) return ECV_ERR_RANGE;
+
+  int flag = out->copy(this);
+  if (flag != ECV_OK) return flag;
+  deform(idim, e, out->axis);
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to reduce the cell to a primitive one by the pure translations found
+ * within tolerance prec (Angstrom): the shortest three of the translations and
+ * the lattice vectors that span a cell of the volume V/ntrans are taken. They
+ * are combinations of the original lattice vectors, so the Cartesian frame is
+ * kept. Returns the number of primitive cells in the original one, i.e., 1 if
+ * it is primitive already, or 0 on failure, in which case nothing is changed.
+ *------------------------------------------------------------------------------ */
+int Structure::primitive(double prec)
+{
+  if (natom < 1) return 0;
+
+  int *type = new int [natom];
+  int ia = 0;
+  for (int it = 0; it < ntype; ++it)
+  for (int i = 0; i < ntm[it]; ++i) type[ia++] = it;
+
+  double **lat;
+  memory->create(lat, 3, 3, "lat");
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) lat[i][j] = axis[i][j] * alat;
+
+  Symmetry *sym = new Symmetry(natom, type, atpos, prec);
+  int nt = sym->translations(lat);
+  int ok = nt > 1;
+  for (int it = 0; it < ntype && ok; ++it) if (ntm[it] % nt) ok = 0;
+
+  int nc = 0, *order = NULL;
+  double (*cand)[3] = NULL, *len = NULL;
+  if (ok){
+    // candidates: the translations but zero, and the lattice vectors
+    nc = nt + 2;
+    cand = new double [nc][3];
+    len = new double [nc];
+    order = new int [nc];
+    int n = 0;
+    for (int k = 0; k < nt; ++k){
+      double t2 = 0.;
+      for (int i = 0; i < 3; ++i){
+        cand[n][i] = sym->ptrans[k][i] - floor(sym->ptrans[k][i] + 0.5);
+        t2 += fabs(cand[n][i]);
+      }
+      if (t2 > ZERO) ++n;
+    }
+    for (int k = 0; k < 3; ++k, ++n)
+    for (int i = 0; i < 3; ++i) cand[n][i] = double(i == k);
+    nc = n;
+
+    for (int k = 0; k < nc; ++k){
+      len[k] = 0.;
+      for (int j = 0; j < 3; ++j){
+        double r = cand[k][0]*lat[0][j] + cand[k][1]*lat[1][j] + cand[k][2]*lat[2][j];
+        len[k] += r * r;
+      }
+      order[k] = k;
+    }
+    for (int k = 0; k < nc; ++k)
+    for (int m = k+1; m < nc; ++m) if (len[order[m]] < len[order[k]]){
+      int tmp = order[k]; order[k] = order[m]; order[m] = tmp;
+    }
+  }
+
+  int flag = 0;
+  double P[3][3];
+  for (int i = 0; ok && i < nc && flag == 0; ++i)
+  for (int j = i+1; j < nc && flag == 0; ++j)
+  for (int k = j+1; k < nc && flag == 0; ++k){
+    double *a = cand[order[i]], *b = cand[order[j]], *c = cand[order[k]];
+    double det = a[0]*(b[1]*c[2] - b[2]*c[1]) - a[1]*(b[0]*c[2] - b[2]*c[0]) + a[2]*(b[0]*c[1] - b[1]*c[0]);
+    if (fabs(fabs(det)*double(nt) - 1.) > 1.e-6) continue;
+
+    double sgn = det > 0. ? 1. : -1.;
+    for (int m = 0; m < 3; ++m){
+      P[0][m] = a[m]; P[1][m] = b[m]; P[2][m] = sgn*c[m];
+    }
+    flag = 1;
+  }
+  if (flag && transform(P, nt, prec) != ECV_OK) flag = 0;
+
+  if (cand) delete []cand;
+  if (len) delete []len;
+  if (order) delete []order;
+  delete sym;
+  memory->destroy(lat);
+  delete []type;
+
+  if (nt == 1) return 1;
+  if (flag == 0) return 0;
+
+return nt;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to Niggli reduce the lattice by the algorithm of Krivy and Gruber
+ * (Acta Cryst. A32, 297, 1976), with the tolerance of Grosse-Kunstleve et al.
+ * (Acta Cryst. A60, 1, 2004); the new lattice vectors are integer combinations
+ * of the old ones with the handedness kept. Returns the number of steps taken,
+ * or -1 if not converged, in which case nothing is changed.
+ *------------------------------------------------------------------------------ */
+int Structure::niggli()
+{
+  int T[3][3];
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) T[i][j] = (i == j);
+
+  double vol = axis[0][0]*(axis[1][1]*axis[2][2] - axis[1][2]*axis[2][1])
+             - axis[0][1]*(axis[1][0]*axis[2][2] - axis[1][2]*axis[2][0])
+             + axis[0][2]*(axis[1][0]*axis[2][1] - axis[1][1]*axis[2][0]);
+  double eps = 1.e-5 * pow(fabs(vol), 2./3.);
+
+  int nstep = 0;
+  for (nstep = 0; nstep < 1000; ++nstep){
+    double L[3][3], G[3][3];
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j){
+      L[i][j] = 0.;
+      for (int k = 0; k < 3; ++k) L[i][j] += double(T[i][k]) * axis[k][j];
+    }
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) G[i][j] = L[i][0]*L[j][0] + L[i][1]*L[j][1] + L[i][2]*L[j][2];
+    double A = G[0][0], B = G[1][1], C = G[2][2];
+    double xi = 2.*G[1][2], eta = 2.*G[0][2], zeta = 2.*G[0][1];
+    int l = xi > eps ? 1 : (xi < -eps ? -1 : 0);
+    int m = eta > eps ? 1 : (eta < -eps ? -1 : 0);
+    int n = zeta > eps ? 1 : (zeta < -eps ? -1 : 0);
+
+    // new lattice vectors (rows) in terms of the current ones
+    int M[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    if (A > B + eps || (fabs(A - B) < eps && fabs(xi) > fabs(eta) + eps)){
+      M[0][0] = M[1][1] = 0; M[0][1] = M[1][0] = M[2][2] = -1;
+
+    } else if (B > C + eps || (fabs(B - C) < eps && fabs(eta) > fabs(zeta) + eps)){
+      M[1][1] = M[2][2] = 0; M[0][0] = M[1][2] = M[2][1] = -1;
+
+    } else if (l*m*n == 1 && (l < 0 || m < 0 || n < 0)){
+      M[0][0] = l; M[1][1] = m; M[2][2] = n;
+
+    } else if (l*m*n != 1 && (l > 0 || m > 0 || n > 0)){
+      int f[3] = {1, 1, 1}, z = -1;
+      if (l == 1) f[0] = -1; else if (l == 0) z = 0;
+      if (m == 1) f[1] = -1; else if (m == 0) z = 1;
+      if (n == 1) f[2] = -1; else if (n == 0) z = 2;
+      if (f[0]*f[1]*f[2] < 0 && z >= 0) f[z] = -1;
+      if (f[0]*f[1]*f[2] < 0) break;
+      M[0][0] = f[0]; M[1][1] = f[1]; M[2][2] = f[2];
+
+    } else if (fabs(xi) > B + eps || (fabs(xi - B) < eps && 2.*eta < zeta - eps) || (fabs(xi + B) < eps && zeta < -eps)){
+      M[2][1] = xi > 0. ? -1 : 1;
+
+    } else if (fabs(eta) > A + eps || (fabs(eta - A) < eps && 2.*xi < zeta - eps) || (fabs(eta + A) < eps && zeta < -eps)){
+      M[2][0] = eta > 0. ? -1 : 1;
+
+    } else if (fabs(zeta) > A + eps || (fabs(zeta - A) < eps && 2.*xi < eta - eps) || (fabs(zeta + A) < eps && eta < -eps)){
+      M[1][0] = zeta > 0. ? -1 : 1;
+
+    } else if (xi + eta + zeta + A + B < -eps || (fabs(xi + eta + zeta + A + B) < eps && 2.*(A + eta) + zeta > eps)){
+      M[2][0] = M[2][1] = 1;
+
+    } else break;
+
+    int Tn[3][3];
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j){
+      Tn[i][j] = 0;
+      for (int k = 0; k < 3; ++k) Tn[i][j] += M[i][k] * T[k][j];
+    }
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) T[i][j] = Tn[i][j];
+  }
+  if (nstep >= 1000) return -1;
+
+  double P[3][3];
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) P[i][j] = double(T[i][j]);
+  if (transform(P, 1, 0.) != ECV_OK) return -1;
+
+return nstep;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to take the new lattice vectors P (rows, in fractional coordinates of
+ * the current ones), with ncell of them fitting in the current cell; the atoms
+ * are mapped into the new cell and, if ncell > 1, those equivalent within prec
+ * (Angstrom) are merged, the type order being kept.
+ *------------------------------------------------------------------------------ */
+int Structure::transform(double P[3][3], int ncell, double prec)
+{
+  double inv[3][3];
+  double det = P[0][0]*(P[1][1]*P[2][2] - P[1][2]*P[2][1])
+             - P[0][1]*(P[1][0]*P[2][2] - P[1][2]*P[2][0])
+             + P[0][2]*(P[1][0]*P[2][1] - P[1][1]*P[2][0]);
+  if (fabs(det) < ZERO) return ECV_ERR_RANGE;
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j){
+    int i1 = (j+1)%3, i2 = (j+2)%3, j1 = (i+1)%3, j2 = (i+2)%3;
+    inv[i][j] = (P[i1][j1]*P[i2][j2] - P[i1][j2]*P[i2][j1]) / det;
+  }
+
+  double ax[3][3];
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) ax[i][j] = P[i][0]*axis[0][j] + P[i][1]*axis[1][j] + P[i][2]*axis[2][j];
+
+  int nnew = natom / ncell;
+  double **x;
+  memory->create(x, natom, 3, "x");
+  int n = 0, ia = 0, ok = 1;
+  for (int it = 0; it < ntype && ok; ++it){
+    int n0 = n;
+    for (int i = 0; i < ntm[it]; ++i, ++ia){
+      double y[3];
+      for (int j = 0; j < 3; ++j){
+        y[j] = atpos[ia][0]*inv[0][j] + atpos[ia][1]*inv[1][j] + atpos[ia][2]*inv[2][j];
+        y[j] -= floor(y[j]);
+        if (y[j] > 1. - 1.e-10) y[j] = 0.;
+      }
+
+      int dup = 0;
+      for (int k = n0; k < n && dup == 0; ++k){
+        double d[3], r2 = 0.;
+        for (int j = 0; j < 3; ++j){
+          d[j] = y[j] - x[k][j];
+          d[j] -= floor(d[j] + 0.5);
+        }
+        for (int j = 0; j < 3; ++j){
+          double r = (d[0]*ax[0][j] + d[1]*ax[1][j] + d[2]*ax[2][j]) * alat;
+          r2 += r * r;
+        }
+        if (r2 < prec * prec) dup = 1;
+      }
+      if (dup) continue;
+      for (int j = 0; j < 3; ++j) x[n][j] = y[j];
+      ++n;
+    }
+    if (n - n0 != ntm[it] / ncell) ok = 0;
+  }
+  if (ok == 0 || n != nnew){
+    memory->destroy(x);
+    return ECV_ERR_FORMAT;
+  }
+
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) axis[i][j] = ax[i][j];
+  for (int it = 0; it < ntype; ++it) ntm[it] /= ncell;
+  memory->destroy(atpos);
+  memory->create(atpos, nnew, 3, "atpos");
+  for (int i = 0; i < nnew; ++i)
+  for (int j = 0; j < 3; ++j) atpos[i][j] = x[i][j];
+  natom = nnew;
+  memory->destroy(x);
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to find the point group of the configuration within tolerance prec
+ * (Angstrom); returns its order. nlaue, if not NULL, gets the order of the
+ * Laue group, used to estimate the number of irreducible k-points; Rc, if not
+ * NULL, gets the rotations in Cartesian coordinates.
+ *------------------------------------------------------------------------------ */
+int Structure::symmetry(double prec, int *nlaue, double Rc[][3][3]) const
+{
+  if (natom < 1) return 0;
+
+  int *type = new int [natom];
+  int ia = 0;
+  for (int it = 0; it < ntype; ++it)
+  for (int i = 0; i < ntm[it]; ++i) type[ia++] = it;
+
+  double **lat;
+  memory->create(lat, 3, 3, "lat");
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) lat[i][j] = axis[i][j] * alat;
+
+  Symmetry *sym = new Symmetry(natom, type, atpos, prec);
+  int n = sym->analyse(lat);
+  if (nlaue) *nlaue = sym->laue();
+  if (Rc) sym->cartesian(Rc);
+
+  delete sym;
+  memory->destroy(lat);
+  delete []type;
+
+return n;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to evaluate the mass density (g/cm^3) of the configuration; the
+ * element names are required, and the suffixes of the POTCAR names, e.g.,
+ * Fe_pv or Ti_sv_GW, are ignored.
+ *------------------------------------------------------------------------------ */
+int Structure::density(double *rho) const
+{
+  static const char *symbol[] = {"H", "He", "Li", "Be", "B", "C", "N", "O", "F", "Ne",
+    "Na", "Mg", "Al", "Si", "P", "S", "Cl", "Ar", "K", "Ca", "Sc", "Ti", "V", "Cr", "Mn",
+    "Fe", "Co", "Ni", "Cu", "Zn", "Ga", "Ge", "As", "Se", "Br", "Kr", "Rb", "Sr", "Y", "Zr",
+    "Nb", "Mo", "Tc", "Ru", "Rh", "Pd", "Ag", "Cd", "In", "Sn", "Sb", "Te", "I", "Xe", "Cs",
+    "Ba", "La", "Ce", "Pr", "Nd", "Pm", "Sm", "Eu", "Gd", "Tb", "Dy", "Ho", "Er", "Tm", "Yb",
+    "Lu", "Hf", "Ta", "W", "Re", "Os", "Ir", "Pt", "Au", "Hg", "Tl", "Pb", "Bi", "Po", "At",
+    "Rn", "Fr", "Ra", "Ac", "Th", "Pa", "U", "Np", "Pu"};
+  static const double mass[] = {1.008, 4.0026, 6.94, 9.0122, 10.81, 12.011, 14.007, 15.999,
+    18.998, 20.180, 22.990, 24.305, 26.982, 28.085, 30.974, 32.06, 35.45, 39.948, 39.098,
+    40.078, 44.956, 47.867, 50.942, 51.996, 54.938, 55.845, 58.933, 58.693, 63.546, 65.38,
+    69.723, 72.630, 74.922, 78.971, 79.904, 83.798, 85.468, 87.62, 88.906, 91.224, 92.906,
+    95.95, 98., 101.07, 102.91, 106.42, 107.87, 112.41, 114.82, 118.71, 121.76, 127.60,
+    126.90, 131.29, 132.91, 137.33, 138.91, 140.12, 140.91, 144.24, 145., 150.36, 151.96,
+    157.25, 158.93, 162.50, 164.93, 167.26, 168.93, 173.05, 174.97, 178.49, 180.95, 183.84,
+    186.21, 190.23, 192.22, 195.08, 196.97, 200.59, 204.38, 207.2, 208.98, 209., 210., 222.,
+    223., 226., 227., 232.04, 231.04, 238.03, 237., 244.};
+  const int nelem = sizeof(mass)/sizeof(double);
+
+  *rho = 0.;
+  if (element == NULL) return ECV_ERR_ELEMENT;
+
+  char str[MAXLINE];
+  strncpy(str, element, MAXLINE-1);
+  str[MAXLINE-1] = '\0';
+  double total = 0.;
+  char *save = NULL;
+  char *ptr = strtok_r(str, SEP "\n", &save);
+  for (int ip = 0; ip < ntype; ++ip){
+    if (ptr == NULL) return ECV_ERR_ELEMENT;
+    char *sep = strpbrk(ptr, "_/.");
+    if (sep) *sep = '\0';
+    int id = -1;
+    for (int i = 0; i < nelem; ++i) if (strcmp(ptr, symbol[i]) == 0){ id = i; break; }
+    if (id < 0) return ECV_ERR_ELEMENT;
+    total += mass[id] * double(ntm[ip]);
+    ptr = strtok_r(NULL, SEP "\n", &save);
+  }
+
+  double vol = axis[0][0]*(axis[1][1]*axis[2][2] - axis[1][2]*axis[2][1])
+             - axis[0][1]*(axis[1][0]*axis[2][2] - axis[1][2]*axis[2][0])
+             + axis[0][2]*(axis[1][0]*axis[2][1] - axis[1][1]*axis[2][0]);
+  vol = fabs(vol) * alat * alat * alat;
+  if (vol < ZERO) return ECV_ERR_FORMAT;
+
+  // 1 amu/A^3 = 1.66053907 g/cm^3
+  *rho = total / vol * 1.66053907;
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the configuration in POSCAR format into buf of size bytes;
+ * need gets the size required, including the terminating null.
+ *------------------------------------------------------------------------------ */
+int Structure::write(char *buf, size_t size, size_t *need) const
+{
+  if (natom < 1) return ECV_ERR_NOATOM;
+  char str[MAXLINE];
+  size_t n = 0;
+
+  n = append(buf, size, n, title ? title : "\n");
+  sprintf(str, "%20.14f\n", alat);
+  n = append(buf, size, n, str);
+  for (int i = 0; i < 3; ++i){
+    sprintf(str, "%20.14f %20.14f %20.14f\n", axis[i][0], axis[i][1], axis[i][2]);
+    n = append(buf, size, n, str);
+  }
+  if (element) n = append(buf, size, n, element);
+  for (int i = 0; i < ntype; ++i){
+    sprintf(str, "%d ", ntm[i]);
+    n = append(buf, size, n, str);
+  }
+  n = append(buf, size, n, "\nDirect\n");
+  for (int i = 0; i < natom; ++i){
+    sprintf(str, "%20.14f %20.14f %20.14f\n", atpos[i][0], atpos[i][1], atpos[i][2]);
+    n = append(buf, size, n, str);
+  }
+  if (need) *need = n + 1;
+  if (buf == NULL || n >= size) return ECV_ERR_BUFFER;
+
+return ECV_OK;
+}
+
+/*------------------------------------------------------------------------------
+ * To append str to buf at offset n as far as size allows; returns new offset
+ *------------------------------------------------------------------------------ */
+static size_t append(char *buf, size_t size, size_t n, const char *str)
+{
+  size_t len = strlen(str);
+  if (buf && n < size){
+    size_t m = n + len < size ? len : size - n - 1;
+    memcpy(buf+n, str, m);
+    buf[n+m] = '\0';
+  }
+
+return n + len;
+}
+
+/*----------------------------------------------------------------------------*/
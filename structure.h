@@ -0,0 +1,39 @@
+#ifndef STRUCTURE_H
+#define STRUCTURE_H
+
+#include "memory.h"
+
+using namespace std;
+
+class Structure {
+public:
+  Structure();
+  ~Structure();
+
+  char *title, *element;        // title line and that of the element names (NULL if absent), as read
+  double alat;                  // scale factor
+  double axis[3][3];            // lattice vectors in rows, in unit of alat
+  int ntype, natom, *ntm;       // number of types and atoms, number of atoms of each type
+  double **atpos;               // fractional coordinates
+
+  int parse(const char *);      // from the text of a POSCAR
+  int read(const char *);       // from a POSCAR, compressed ones as well
+  int copy(const Structure *);
+  void deform(int, double, double [3][3]) const;
+  void deform(double [3][3], double [3][3]) const;
+  static void strainmat(int, double, double [3][3]);
+  int strain(int, double, Structure *) const;
+  int primitive(double);        // reduce to a primitive cell; returns the number of them in the original
+  int niggli();                 // Niggli reduce the lattice
+  int symmetry(double, int *, double [][3][3]) const; // order of the point group, with that of the Laue group and the Cartesian rotations if asked
+  int density(double *) const;  // mass density (g/cm^3), from the element names
+  int write(char *, size_t, size_t *) const;
+
+private:
+  Memory *memory;
+  void clear();
+  int scan(char *);
+  char *nextline(char *&);
+  int transform(double [3][3], int, double);
+};
+#endif
@@ -0,0 +1,277 @@
+#include "surface.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include <time.h>
+#ifdef OMP
+#include <omp.h>
+#endif
+
+#define ZERO 1.e-10
+#define NBLK 256
+#define NCHI 36
+#define NPROP 7
+
+/*------------------------------------------------------------------------------
+ * Constructor of Surface, the engine to evaluate the directional elastic
+ * properties on a spherical grid. The Christoffel coefficients are prepared
+ * so that the kernel only needs to contract against the direction monomials.
+ *------------------------------------------------------------------------------ */
+Surface::Surface(Elastic *elas, double dens)
+{
+  memory = new Memory();
+  elastic = elas;
+  rho = dens;
+  prop = NULL;
+  ndir = 0;
+
+  // Gamma_ik = c_ijkl n_j n_l, grouped on the monomials (n1n1, n2n2, n3n3, n2n3, n1n3, n1n2)
+  for (int a = 0; a < 6; ++a)
+  for (int b = 0; b < 6; ++b) K[a][b] = 0.;
+
+  int ii[6] = {0, 1, 2, 1, 0, 0}, kk[6] = {0, 1, 2, 2, 2, 1};
+  for (int a = 0; a < 6; ++a)
+  for (int j = 0; j < 3; ++j)
+  for (int l = 0; l < 3; ++l){
+    int i = ii[a], k = kk[a];
+    K[a][elastic->voigt(j,l)] += elastic->C[elastic->voigt(i,j)][elastic->voigt(k,l)];
+  }
+
+  for (int m = 0; m < 6; ++m) Sh[m] = elastic->S[m][0] + elastic->S[m][1] + elastic->S[m][2];
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, free memory
+ *------------------------------------------------------------------------------ */
+Surface::~Surface()
+{
+  if (prop) memory->destroy(prop);
+  delete memory;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to evaluate the directional properties on a (theta, phi) grid with
+ * nt x np points; the extrema are reported and the grid is written to file.
+ *------------------------------------------------------------------------------ */
+void Surface::compute(int nt, int np, const char *fname)
+{
+  if (nt < 2) nt = 2;
+  if (np < 1) np = 1;
+  ndir = nt * np;
+  if (prop) memory->destroy(prop);
+  memory->create(prop, NPROP, ndir, "prop");
+
+#ifdef OMP
+  double t0 = omp_get_wtime();
+#else
+  double t0 = double(clock())/double(CLOCKS_PER_SEC);
+#endif
+  int nblk = (ndir + NBLK - 1)/NBLK;
+#ifdef OMP
+  #pragma omp parallel for default(shared) schedule(static)
+#endif
+  for (int ib = 0; ib < nblk; ++ib){
+    int i0 = ib * NBLK;
+    int i1 = i0 + NBLK;
+    if (i1 > ndir) i1 = ndir;
+    kernel(i0, i1, nt, np);
+  }
+#ifdef OMP
+  double twall = omp_get_wtime() - t0;
+#else
+  double twall = double(clock())/double(CLOCKS_PER_SEC) - t0;
+#endif
+
+  printf("\n"); for (int i = 0; i < 20; ++i) printf("====");
+  printf("\nDirectional elastic properties evaluated on %d x %d = %d directions", nt, np, ndir);
+  printf("\nTime used: %g seconds.\n", twall);
+  printf("Direction in (theta, phi) in degree and Cartesian unit vector:\n");
+  extrema(0, nt, "Young's modulus (GPa)", "E");
+  extrema(1, nt, "Linear compressibility (1/TPa)", "beta");
+  extrema(2, nt, "Shear modulus, min over plane (GPa)", "Gmin");
+  extrema(3, nt, "Shear modulus, max over plane (GPa)", "Gmax");
+  if (rho > ZERO){
+    extrema(4, nt, "Longitudinal sound velocity (km/s)", "vL");
+    extrema(5, nt, "Fast transverse sound velocity (km/s)", "vT1");
+    extrema(6, nt, "Slow transverse sound velocity (km/s)", "vT2");
+  } else printf("  Mass density unknown, sound velocities are not evaluated.\n");
+  for (int i = 0; i < 20; ++i) printf("====");
+  printf("\n");
+
+  if (fname == NULL) return;
+  FILE *fp = fopen(fname, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return;
+  }
+  fprintf(fp, "# Directional elastic properties on a %d x %d (theta,phi) grid; rho = %g g/cm^3\n", nt, np, rho);
+  fprintf(fp, "# theta phi E(GPa) beta(1/TPa) Gmin(GPa) Gmax(GPa) vL(km/s) vT1(km/s) vT2(km/s)\n");
+  for (int it = 0; it < nt; ++it){
+    for (int ip = 0; ip < np; ++ip){
+      int idx = it * np + ip;
+      fprintf(fp, "%8.3f %8.3f", 180.*double(it)/double(nt-1), 360.*double(ip)/double(np));
+      for (int iq = 0; iq < NPROP; ++iq) fprintf(fp, " %g", prop[iq][idx]);
+      fprintf(fp, "\n");
+    }
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+  printf("Directional properties written to file: %s\n", fname);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Kernel to evaluate the directions [i0, i1) as a batch. All quantities are
+ * kept in structure-of-arrays form so that the loops over the batch index
+ * are vectorized by the compiler.
+ *------------------------------------------------------------------------------ */
+void Surface::kernel(int i0, int i1, int nt, int np)
+{
+  const int n = i1 - i0;
+  double l[3][NBLK], u[3][NBLK], v[3][NBLK];
+  double b[6][NBLK], c[6][NBLK], acc[NBLK], gmin[NBLK], gmax[NBLK];
+
+  double dt = M_PI/double(nt-1), dp = 2.*M_PI/double(np);
+  for (int k = 0; k < n; ++k){
+    int idx = i0 + k;
+    double theta = double(idx/np) * dt, phi = double(idx%np) * dp;
+    double st = sin(theta), ct = cos(theta), sp = sin(phi), cp = cos(phi);
+    l[0][k] = st*cp; l[1][k] = st*sp; l[2][k] = ct;
+    u[0][k] = ct*cp; u[1][k] = ct*sp; u[2][k] = -st;
+    v[0][k] = -sp;   v[1][k] = cp;    v[2][k] = 0.;
+  }
+
+  // monomials of the direction, (l1l1, l2l2, l3l3, l2l3, l1l3, l1l2)
+  for (int k = 0; k < n; ++k){
+    b[0][k] = l[0][k]*l[0][k]; b[1][k] = l[1][k]*l[1][k]; b[2][k] = l[2][k]*l[2][k];
+    b[3][k] = l[1][k]*l[2][k]; b[4][k] = l[0][k]*l[2][k]; b[5][k] = l[0][k]*l[1][k];
+  }
+
+  // Young's modulus, 1/E = b^T S b
+  for (int k = 0; k < n; ++k) acc[k] = 0.;
+  for (int m = 0; m < 6; ++m)
+  for (int mm = 0; mm < 6; ++mm){
+    double s = elastic->S[m][mm];
+    for (int k = 0; k < n; ++k) acc[k] += s * b[m][k] * b[mm][k];
+  }
+  for (int k = 0; k < n; ++k) prop[0][i0+k] = 1./acc[k];
+
+  // linear compressibility, beta = b_m S_mn for n <= 3; in 1/TPa
+  for (int k = 0; k < n; ++k) acc[k] = 0.;
+  for (int m = 0; m < 6; ++m){
+    double s = Sh[m] * 1000.;
+    for (int k = 0; k < n; ++k) acc[k] += s * b[m][k];
+  }
+  for (int k = 0; k < n; ++k) prop[1][i0+k] = acc[k];
+
+  // shear modulus, 1/G = c^T S c with m = cos(chi) u + sin(chi) v rotating in the plane normal to l
+  for (int k = 0; k < n; ++k){ gmin[k] = 1.e30; gmax[k] = -1.e30; }
+  for (int ichi = 0; ichi < NCHI; ++ichi){
+    double chi = M_PI * double(ichi)/double(NCHI);
+    double cc = cos(chi), sc = sin(chi);
+    for (int k = 0; k < n; ++k){
+      double m0 = cc*u[0][k] + sc*v[0][k];
+      double m1 = cc*u[1][k] + sc*v[1][k];
+      double m2 = cc*u[2][k] + sc*v[2][k];
+      c[0][k] = 2.*l[0][k]*m0; c[1][k] = 2.*l[1][k]*m1; c[2][k] = 2.*l[2][k]*m2;
+      c[3][k] = l[1][k]*m2 + l[2][k]*m1;
+      c[4][k] = l[0][k]*m2 + l[2][k]*m0;
+      c[5][k] = l[0][k]*m1 + l[1][k]*m0;
+      acc[k] = 0.;
+    }
+    for (int m = 0; m < 6; ++m)
+    for (int mm = 0; mm < 6; ++mm){
+      double s = elastic->S[m][mm];
+      for (int k = 0; k < n; ++k) acc[k] += s * c[m][k] * c[mm][k];
+    }
+    for (int k = 0; k < n; ++k){
+      double g = 1./acc[k];
+      gmin[k] = g < gmin[k] ? g : gmin[k];
+      gmax[k] = g > gmax[k] ? g : gmax[k];
+    }
+  }
+  for (int k = 0; k < n; ++k){ prop[2][i0+k] = gmin[k]; prop[3][i0+k] = gmax[k]; }
+
+  // sound velocities from the Christoffel equation, Gamma v = rho v^2 v
+  if (rho > ZERO){
+    double gam[6][NBLK], ev[3];
+    for (int a = 0; a < 6; ++a){
+      for (int k = 0; k < n; ++k) gam[a][k] = 0.;
+      for (int mm = 0; mm < 6; ++mm){
+        double s = K[a][mm];
+        for (int k = 0; k < n; ++k) gam[a][k] += s * b[mm][k];
+      }
+    }
+    double rinv = 1./rho;
+    for (int k = 0; k < n; ++k){
+      eigen3(gam[0][k], gam[1][k], gam[2][k], gam[3][k], gam[4][k], gam[5][k], ev);
+      for (int i = 0; i < 3; ++i) prop[4+i][i0+k] = sqrt((ev[i] > 0. ? ev[i] : 0.)*rinv);
+    }
+  } else {
+    for (int i = 4; i < NPROP; ++i)
+    for (int k = 0; k < n; ++k) prop[i][i0+k] = 0.;
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Analytic eigenvalues of a real symmetric 3x3 matrix in descending order,
+ * by the trigonometric method; the matrix is given as (a11,a22,a33,a23,a13,a12)
+ *------------------------------------------------------------------------------ */
+void Surface::eigen3(double a11, double a22, double a33, double a23, double a13, double a12, double *ev)
+{
+  double q  = (a11 + a22 + a33)/3.;
+  double p1 = a12*a12 + a13*a13 + a23*a23;
+  double p2 = (a11-q)*(a11-q) + (a22-q)*(a22-q) + (a33-q)*(a33-q) + 2.*p1;
+  double p  = sqrt(p2/6.);
+  if (p < ZERO*(fabs(q)+1.)){
+    ev[0] = ev[1] = ev[2] = q;
+    return;
+  }
+
+  double r = 1./p;
+  double b11 = (a11-q)*r, b22 = (a22-q)*r, b33 = (a33-q)*r;
+  double b23 = a23*r, b13 = a13*r, b12 = a12*r;
+  double det = b11*(b22*b33 - b23*b23) - b12*(b12*b33 - b23*b13) + b13*(b12*b23 - b22*b13);
+  double h = 0.5*det;
+  h = h > 1. ? 1. : (h < -1. ? -1. : h);
+
+  double phi = acos(h)/3.;
+  ev[0] = q + 2.*p*cos(phi);
+  ev[2] = q + 2.*p*cos(phi + 2.*M_PI/3.);
+  ev[1] = 3.*q - ev[0] - ev[2];
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to locate and report the extrema of property iq
+ *------------------------------------------------------------------------------ */
+void Surface::extrema(int iq, int nt, const char *name, const char *tag)
+{
+  int np = ndir/nt;
+  int imin = 0, imax = 0;
+  for (int i = 1; i < ndir; ++i){
+    if (prop[iq][i] < prop[iq][imin]) imin = i;
+    if (prop[iq][i] > prop[iq][imax]) imax = i;
+  }
+
+  printf("  %s:\n", name);
+  int id[2] = {imin, imax};
+  for (int m = 0; m < 2; ++m){
+    double theta = M_PI * double(id[m]/np)/double(nt-1), phi = 2.*M_PI * double(id[m]%np)/double(np);
+    printf("    %s%s = %12.6f at (%7.2f, %7.2f), [%8.5f %8.5f %8.5f]\n", tag, m ? "max" : "min",
+      prop[iq][id[m]], theta*180./M_PI, phi*180./M_PI, sin(theta)*cos(phi), sin(theta)*sin(phi), cos(theta));
+  }
+  printf("    Anisotropy ratio %smax/%smin = %g\n", tag, tag, prop[iq][imax]/prop[iq][imin]);
+
+return;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,31 @@
+#ifndef SURFACE_H
+#define SURFACE_H
+
+#include "memory.h"
+#include "elastic.h"
+
+using namespace std;
+
+class Surface {
+public:
+  Surface(Elastic *, double);
+  ~Surface();
+
+  void compute(int, int, const char *);
+
+private:
+  Memory *memory;
+  Elastic *elastic;
+
+  double rho;                   // mass density, in g/cm^3; velocities skipped if not positive
+  double K[6][6];               // Christoffel coefficients, Gamma_a = K[a][b] * n_b n_c
+  double Sh[6];                 // row sums of S over the normal components
+
+  int ndir;                     // total number of directions
+  double **prop;                // directional properties, [nprop][ndir]
+
+  void kernel(int, int, int, int);
+  void eigen3(double, double, double, double, double, double, double *);
+  void extrema(int, int, const char *, const char *);
+};
+#endif
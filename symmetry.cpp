@@ -0,0 +1,224 @@
+#include "symmetry.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#define ZERO 1.e-10
+
+/*------------------------------------------------------------------------------
+ * Constructor of Symmetry, to find the symmetry operations of a crystal.
+ * natom atoms of type typ at fractional positions x; prec is the tolerance
+ * on positions in Angstrom.
+ *------------------------------------------------------------------------------ */
+Symmetry::Symmetry(int n, int *typ, double **x, double prec)
+{
+  memory = new Memory();
+  natom = n;
+  type = typ;
+  pos = x;
+  symprec = prec;
+  axis = NULL;
+
+  nrot = ntrans = 0;
+  memory->create(ptrans, natom, 3, "ptrans");
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, free memory
+ *------------------------------------------------------------------------------ */
+Symmetry::~Symmetry()
+{
+  memory->destroy(ptrans);
+  delete memory;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to find the symmetry operations of the crystal for lattice ax, whose
+ * rows are the lattice vectors in Angstrom. The candidate rotations are the
+ * integer matrices with elements in {-1,0,1} that keep the metric; each is
+ * then kept if a translation maps every atom onto one of the same type. The
+ * search runs on the cell as given: it is complete only if the cell is Niggli
+ * reduced (as by -reduce), otherwise a rotation with larger elements may be
+ * missed and a subgroup found. Returns the order of the point group found.
+ *------------------------------------------------------------------------------ */
+int Symmetry::analyse(double **ax)
+{
+  axis = ax;
+
+  double G[3][3], gmax = 0.;
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j){
+    G[i][j] = 0.;
+    for (int k = 0; k < 3; ++k) G[i][j] += axis[i][k] * axis[j][k];
+    gmax = fabs(G[i][j]) > gmax ? fabs(G[i][j]) : gmax;
+  }
+  double gtol = 1.e-4 * gmax;
+
+  nrot = ntrans = 0;
+  int R[3][3];
+  for (int code = 0; code < 19683; ++code){
+    int c = code;
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j){ R[i][j] = c%3 - 1; c /= 3; }
+
+    int det = R[0][0]*(R[1][1]*R[2][2] - R[1][2]*R[2][1]) - R[0][1]*(R[1][0]*R[2][2] - R[1][2]*R[2][0])
+            + R[0][2]*(R[1][0]*R[2][1] - R[1][1]*R[2][0]);
+    if (det != 1 && det != -1) continue;
+
+    // R^T G R = G
+    int keep = 1;
+    for (int i = 0; i < 3 && keep; ++i)
+    for (int j = 0; j < 3 && keep; ++j){
+      double g = 0.;
+      for (int k = 0; k < 3; ++k)
+      for (int l = 0; l < 3; ++l) g += R[k][i] * G[k][l] * R[l][j];
+      if (fabs(g - G[i][j]) > gtol) keep = 0;
+    }
+    if (keep == 0) continue;
+
+    double t[3];
+    if (match(R, t) && nrot < MAXROT){
+      for (int i = 0; i < 3; ++i){
+        trans[nrot][i] = t[i];
+        for (int j = 0; j < 3; ++j) rot[nrot][i][j] = R[i][j];
+      }
+      ++nrot;
+    }
+  }
+
+return nrot;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to find the pure translations of the crystal for lattice ax (rows,
+ * in Angstrom), zero included, into ptrans; returns their number.
+ *------------------------------------------------------------------------------ */
+int Symmetry::translations(double **ax)
+{
+  axis = ax;
+  nrot = ntrans = 0;
+
+  int R[3][3];
+  double t[3];
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) R[i][j] = (i == j);
+  match(R, t);
+
+return ntrans;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to check whether rotation R, combined with some translation t, maps
+ * the crystal onto itself; for the identity, all such translations are kept
+ * in ptrans. Returns 1 if a translation is found.
+ *------------------------------------------------------------------------------ */
+int Symmetry::match(int R[3][3], double *t)
+{
+  int isid = 1;
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) if (R[i][j] != (i == j)) isid = 0;
+
+  double tol2 = symprec * symprec;
+  double x0[3], d[3];
+  for (int i = 0; i < 3; ++i) x0[i] = R[i][0]*pos[0][0] + R[i][1]*pos[0][1] + R[i][2]*pos[0][2];
+
+  int found = 0;
+  for (int j = 0; j < natom; ++j){
+    if (type[j] != type[0]) continue;
+
+    double tt[3];
+    for (int i = 0; i < 3; ++i){
+      tt[i] = pos[j][i] - x0[i];
+      tt[i] -= floor(tt[i] + 0.5);
+    }
+
+    int ok = 1;
+    for (int ia = 0; ia < natom && ok; ++ia){
+      double y[3];
+      for (int i = 0; i < 3; ++i) y[i] = R[i][0]*pos[ia][0] + R[i][1]*pos[ia][1] + R[i][2]*pos[ia][2] + tt[i];
+      ok = 0;
+      for (int ja = 0; ja < natom; ++ja){
+        if (type[ja] != type[ia]) continue;
+        for (int i = 0; i < 3; ++i){
+          d[i] = y[i] - pos[ja][i];
+          d[i] -= floor(d[i] + 0.5);
+        }
+        if (dist2(d) < tol2){ ok = 1; break; }
+      }
+    }
+    if (ok == 0) continue;
+
+    if (found == 0) for (int i = 0; i < 3; ++i) t[i] = tt[i];
+    found = 1;
+    if (isid == 0) break;
+    for (int i = 0; i < 3; ++i) ptrans[ntrans][i] = tt[i];
+    ++ntrans;
+  }
+
+return found;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to compute the squared Cartesian length of a fractional vector
+ *------------------------------------------------------------------------------ */
+double Symmetry::dist2(double *d)
+{
+  double r[3];
+  for (int i = 0; i < 3; ++i) r[i] = d[0]*axis[0][i] + d[1]*axis[1][i] + d[2]*axis[2][i];
+
+return r[0]*r[0] + r[1]*r[1] + r[2]*r[2];
+}
+
+/*------------------------------------------------------------------------------
+ * Method to compute the order of the Laue group, i.e., the point group with
+ * the inversion added, which determines the reduction of the k-points
+ *------------------------------------------------------------------------------ */
+int Symmetry::laue()
+{
+  int hasinv = 0;
+  for (int ir = 0; ir < nrot; ++ir){
+    int inv = 1;
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) if (rot[ir][i][j] != -(i == j)) inv = 0;
+    if (inv) hasinv = 1;
+  }
+
+return hasinv ? nrot : 2*nrot;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the rotations in Cartesian coordinates, Rc = A^T R A^-T with A
+ * the lattice vectors (rows) last analysed; Rc is orthogonal as R^T G R = G.
+ *------------------------------------------------------------------------------ */
+void Symmetry::cartesian(double Rc[][3][3])
+{
+  double inv[3][3];
+  inv[0][0] = axis[1][1]*axis[2][2] - axis[1][2]*axis[2][1];
+  inv[0][1] = axis[0][2]*axis[2][1] - axis[0][1]*axis[2][2];
+  inv[0][2] = axis[0][1]*axis[1][2] - axis[0][2]*axis[1][1];
+  inv[1][0] = axis[1][2]*axis[2][0] - axis[1][0]*axis[2][2];
+  inv[1][1] = axis[0][0]*axis[2][2] - axis[0][2]*axis[2][0];
+  inv[1][2] = axis[0][2]*axis[1][0] - axis[0][0]*axis[1][2];
+  inv[2][0] = axis[1][0]*axis[2][1] - axis[1][1]*axis[2][0];
+  inv[2][1] = axis[0][1]*axis[2][0] - axis[0][0]*axis[2][1];
+  inv[2][2] = axis[0][0]*axis[1][1] - axis[0][1]*axis[1][0];
+  double det = axis[0][0]*inv[0][0] + axis[0][1]*inv[1][0] + axis[0][2]*inv[2][0];
+
+  // Rc_ij = sum_kl A_ki R_kl (A^-1)_jl
+  for (int ir = 0; ir < nrot; ++ir)
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j){
+    double r = 0.;
+    for (int k = 0; k < 3; ++k)
+    for (int l = 0; l < 3; ++l) r += axis[k][i] * double(rot[ir][k][l]) * inv[j][l];
+    Rc[ir][i][j] = r/det;
+  }
+
+return;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,36 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include "memory.h"
+
+#define MAXROT 48
+
+using namespace std;
+
+class Symmetry {
+public:
+  Symmetry(int, int *, double **, double);
+  ~Symmetry();
+
+  int analyse(double **);       // find the symmetry operations for the given lattice
+  int translations(double **);  // find the pure translations only
+  int laue();                   // order of the Laue group, i.e., with inversion added
+  void cartesian(double [][3][3]); // the rotations in Cartesian coordinates
+
+  int nrot;                     // number of rotations, i.e., order of the point group
+  int rot[MAXROT][3][3];        // rotations acting on fractional coordinates
+  double trans[MAXROT][3];      // fractional translation associated with each rotation
+
+  int ntrans;                   // number of pure translations, zero included
+  double **ptrans;              // the pure translations, in fractional coordinates
+
+private:
+  Memory *memory;
+  int natom, *type;
+  double **pos, **axis;
+  double symprec;               // tolerance on positions, in Angstrom
+
+  int match(int [3][3], double *);
+  double dist2(double *);
+};
+#endif
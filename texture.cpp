@@ -0,0 +1,516 @@
+#include "texture.h"
+#include "zfile.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "math.h"
+#include <time.h>
+#ifdef OMP
+#include <omp.h>
+#endif
+
+#define ZERO 1.e-10
+#define MAXLINE 1024
+#define NBLK 256
+#define NLANE 8
+#define NCHUNK 65536
+#define NSCAN 200
+#define NTEXT (NCHUNK*128)
+
+/*------------------------------------------------------------------------------
+ * Constructor of Texture, the engine to average the single crystal elastic
+ * constants over a measured orientation distribution, e.g., from EBSD.
+ * Tensors are handled as 6x6 matrices in Mandel notation, so that a rotation
+ * acts as T' = Q T Q^T with Q orthogonal; as the map T -> <Q T Q^T> is linear,
+ * it is accumulated once over all the orientations, as V on the 21 index
+ * pairs of symmetric matrices, and then applied to any tensor needed.
+ *------------------------------------------------------------------------------ */
+Texture::Texture(Elastic *elas)
+{
+  memory = new Memory();
+  elastic = elas;
+  ngrain = 0;
+  wsum = twall = 0.;
+
+  int n = 0;
+  for (int i = 0; i < 6; ++i)
+  for (int j = i; j < 6; ++j){ ip[n] = i; jp[n] = j; ++n; }
+
+  for (int p = 0; p < NPAIR; ++p)
+  for (int q = 0; q < NPAIR; ++q) V[p][q] = 0.;
+  for (int i = 0; i < 2; ++i) ref[i][0] = ref[i][1] = 0.;
+
+  mandel(elastic->C, C, 1);
+  mandel(elastic->S, S, -1);
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) CV[i][j] = CR[i][j] = CH[i][j] = CL[i][j] = CU[i][j] = 0.;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, free memory
+ *------------------------------------------------------------------------------ */
+Texture::~Texture()
+{
+  delete memory;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to average over the orientations in fname, given as Bunge Euler
+ * angles (phi1, Phi, phi2) that rotate the sample frame onto the crystal one.
+ * Three formats are recognized by the file name:
+ *   *.ang, TSL/EDAX: columns 1-3, in radians;
+ *   *.ctf, HKL/Oxford: columns 6-8, in degrees, after the "Phase X Y" header,
+ *          non-indexed points (phase 0) skipped;
+ *   otherwise: phi1 Phi phi2 [weight], in degrees, weight 1 if not given.
+ * The file is read in chunks of lines, which are parsed and evaluated in
+ * blocks of NBLK orientations spread over the threads, so that only copying
+ * the lines is serial; the partial sums of the blocks are added in a fixed
+ * order, so that the result does not depend on the number of threads.
+ * The textured Voigt, Reuss and Hill estimates and the Hashin-Shtrikman
+ * bounds are then evaluated.
+ *------------------------------------------------------------------------------ */
+int Texture::compute(const char *fname)
+{
+  int fmt = 0;
+  if (strstr(fname, ".ang")) fmt = 1;
+  else if (strstr(fname, ".ctf")) fmt = 2;
+
+  ZFile zf;
+  FILE *fp = zf.open(fname);
+  if (fp == NULL){
+    printf("\nFile %s not found!\n", fname);
+    return 1;
+  }
+
+  char str[MAXLINE];
+  if (fmt == 2){
+    int found = 0;
+    while (fgets(str, MAXLINE, fp)) if (strncmp(str, "Phase", 5) == 0 && strstr(str, "Euler")){ found = 1; break; }
+    if (found == 0){
+      printf("\nERROR: no data header found in %s!\n", fname);
+      zf.close();
+      return 2;
+    }
+  }
+
+  const int nblkmax = NCHUNK/NBLK;
+  char *text;
+  int *start;
+  double **ang, *w, **blk;
+  memory->create(text, NTEXT, "text");
+  memory->create(start, NCHUNK, "start");
+  memory->create(ang, 3, NCHUNK, "ang");
+  memory->create(w, NCHUNK, "w");
+  memory->create(blk, nblkmax, NPAIR*NPAIR, "blk");
+
+  for (int p = 0; p < NPAIR; ++p)
+  for (int q = 0; q < NPAIR; ++q) V[p][q] = 0.;
+  ngrain = 0;
+  wsum = 0.;
+
+#ifdef OMP
+  double t0 = omp_get_wtime();
+#else
+  double t0 = double(clock())/double(CLOCKS_PER_SEC);
+#endif
+  int n;
+  while ((n = read(fp, text, start)) > 0){
+    int nblk = (n + NBLK - 1)/NBLK;
+#ifdef OMP
+    #pragma omp parallel for default(shared) schedule(static)
+#endif
+    for (int ib = 0; ib < nblk; ++ib){
+      int i0 = ib * NBLK;
+      int i1 = i0 + NBLK;
+      if (i1 > n) i1 = n;
+      for (int i = i0; i < i1; ++i) parse(fmt, text + start[i], ang, w, i);
+      kernel(i0, i1, ang, w, blk[ib]);
+    }
+    for (int ib = 0; ib < nblk; ++ib)
+    for (int p = 0; p < NPAIR; ++p)
+    for (int q = 0; q < NPAIR; ++q) V[p][q] += blk[ib][p*NPAIR+q];
+
+    for (int i = 0; i < n; ++i){
+      if (w[i] <= 0.) continue;
+      wsum += w[i];
+      ++ngrain;
+    }
+  }
+#ifdef OMP
+  twall = omp_get_wtime() - t0;
+#else
+  twall = double(clock())/double(CLOCKS_PER_SEC) - t0;
+#endif
+  int zerr = zf.close();
+
+  memory->destroy(text);
+  memory->destroy(start);
+  memory->destroy(ang);
+  memory->destroy(w);
+  memory->destroy(blk);
+  if (zerr) return 5;
+
+  if (ngrain < 1 || wsum < ZERO){
+    printf("\nERROR: no orientation found in %s!\n", fname);
+    return 3;
+  }
+  double r = 1./wsum;
+  for (int p = 0; p < NPAIR; ++p)
+  for (int q = 0; q < NPAIR; ++q) V[p][q] *= r;
+
+  // Voigt, Reuss and Hill estimates
+  double a[6][6], b[6][6];
+  average(C, a);
+  mandel(a, CV, -1);
+  average(S, a);
+  if (elastic->invert(a, b)){
+    printf("\nERROR: the textured compliance matrix is singular!\n");
+    return 4;
+  }
+  mandel(b, CR, -1);
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) CH[i][j] = 0.5*(CV[i][j] + CR[i][j]);
+
+  // Hashin-Shtrikman bounds
+  hashin(0, 1., CL);
+  hashin(1, -1., CU);
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read up to NCHUNK lines into text, line i starting at start[i];
+ * returns the number read, 0 at the end of the file.
+ *------------------------------------------------------------------------------ */
+int Texture::read(FILE *fp, char *text, int *start)
+{
+  int n = 0, pos = 0;
+  while (n < NCHUNK && pos + MAXLINE <= NTEXT && fgets(text + pos, MAXLINE, fp)){
+    start[n++] = pos;
+    pos += strlen(text + pos) + 1;
+  }
+
+return n;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to parse a line into orientation i, as angles in radians into ang
+ * and the weight into w; the weight is zero if the line holds no orientation.
+ *------------------------------------------------------------------------------ */
+void Texture::parse(int fmt, const char *str, double **ang, double *w, int i)
+{
+  static const int nneed[3] = {3, 3, 8}, first[3] = {0, 0, 5};
+  const double deg = M_PI/180.;
+
+  double x[10];
+  int nx = 0;
+  char *end;
+  while (nx < 10){
+    x[nx] = strtod(str, &end);
+    if (end == str) break;
+    str = end;
+    ++nx;
+  }
+
+  w[i] = 0.;
+  for (int k = 0; k < 3; ++k) ang[k][i] = 0.;
+  if (nx < nneed[fmt]) return;
+  if (fmt == 2 && fabs(x[0]) < ZERO) return;
+
+  double wt = (fmt == 0 && nx > 3) ? x[3] : 1.;
+  if (wt <= 0.) return;
+
+  double s = fmt == 1 ? 1. : deg;
+  for (int k = 0; k < 3; ++k) ang[k][i] = x[first[fmt]+k] * s;
+  w[i] = wt;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Kernel to accumulate the orientations [i0, i1) into acc, a partial sum of V
+ * stored as acc[p*NPAIR+q]. The Mandel rotation matrices of the batch are kept
+ * in structure-of-arrays form, padded with zero weight to a multiple of NLANE,
+ * and each sum over the batch is split over NLANE independent lanes, so that
+ * the loops are vectorized by the compiler without reordering the additions.
+ *------------------------------------------------------------------------------ */
+void Texture::kernel(int i0, int i1, double **ang, double *w, double *acc)
+{
+  static const int mi[6] = {0, 1, 2, 1, 0, 0}, mj[6] = {0, 1, 2, 2, 2, 1};
+  static const double f[6] = {1., 1., 1., M_SQRT2, M_SQRT2, M_SQRT2};
+  const int n = i1 - i0;
+  const int npad = (n + NLANE - 1)/NLANE * NLANE;
+  double R[9][NBLK], Q[36][NBLK], Qw[36][NBLK];
+
+  // rotation from the crystal frame to the sample one, the transpose of that of Bunge
+  for (int k = 0; k < n; ++k){
+    double c1 = cos(ang[0][i0+k]), s1 = sin(ang[0][i0+k]);
+    double c  = cos(ang[1][i0+k]), s  = sin(ang[1][i0+k]);
+    double c2 = cos(ang[2][i0+k]), s2 = sin(ang[2][i0+k]);
+    R[0][k] =  c1*c2 - s1*s2*c; R[3][k] =  s1*c2 + c1*s2*c; R[6][k] = s2*s;
+    R[1][k] = -c1*s2 - s1*c2*c; R[4][k] = -s1*s2 + c1*c2*c; R[7][k] = c2*s;
+    R[2][k] =  s1*s;            R[5][k] = -c1*s;            R[8][k] = c;
+  }
+
+  // Q_IJ = f_I f_J (R_ik R_jl + R_il R_jk)/2, with I = (i,j), J = (k,l)
+  for (int I = 0; I < 6; ++I)
+  for (int J = 0; J < 6; ++J){
+    int i = mi[I], j = mj[I], k = mi[J], l = mj[J];
+    double h = 0.5 * f[I] * f[J];
+    double *q = Q[I*6+J], *qw = Qw[I*6+J];
+    const double *a = R[i*3+k], *b = R[j*3+l], *c = R[i*3+l], *d = R[j*3+k];
+    for (int m = 0; m < n; ++m){
+      q[m] = h * (a[m]*b[m] + c[m]*d[m]);
+      qw[m] = q[m] * w[i0+m];
+    }
+    for (int m = n; m < npad; ++m) q[m] = qw[m] = 0.;
+  }
+
+  // V_pq = sum_g w_g (Q_ac Q_bd + Q_ad Q_bc), the latter for c < d only, with p = (a,b), q = (c,d)
+  for (int p = 0; p < NPAIR; ++p)
+  for (int iq = 0; iq < NPAIR; ++iq){
+    int a = ip[p], b = jp[p], c = ip[iq], d = jp[iq];
+    const double *x = Qw[a*6+c], *y = Q[b*6+d];
+    double part[NLANE];
+    for (int m = 0; m < NLANE; ++m) part[m] = 0.;
+    if (c == d){
+      for (int k = 0; k < npad; k += NLANE)
+      for (int m = 0; m < NLANE; ++m) part[m] += x[k+m]*y[k+m];
+    } else {
+      const double *u = Qw[a*6+d], *v = Q[b*6+c];
+      for (int k = 0; k < npad; k += NLANE)
+      for (int m = 0; m < NLANE; ++m) part[m] += x[k+m]*y[k+m] + u[k+m]*v[k+m];
+    }
+    double s = 0.;
+    for (int m = 0; m < NLANE; ++m) s += part[m];
+    acc[p*NPAIR+iq] = s;
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to apply the orientation average to the symmetric Mandel matrix t
+ *------------------------------------------------------------------------------ */
+void Texture::average(double t[6][6], double out[6][6])
+{
+  for (int p = 0; p < NPAIR; ++p){
+    double s = 0.;
+    for (int q = 0; q < NPAIR; ++q) s += V[p][q] * t[ip[q]][jp[q]];
+    out[ip[p]][jp[p]] = out[jp[p]][ip[p]] = s;
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to evaluate the Hashin-Shtrikman estimate, in Mandel notation, with
+ * an isotropic reference medium (K0, G0):
+ *   C_HS = <(C + C*)^-1>^-1 - C*,
+ * with C* = 3K* J + 2G* (I - J) the overall constraint tensor of a spherical
+ * inclusion, K* = 4G0/3 and G* = G0 (9K0 + 8G0)/(6K0 + 12G0). It is a lower
+ * (upper) bound if C - C0 is positive (negative) semi-definite, and valid for
+ * grains whose positions are uncorrelated with their orientations. tr is the
+ * trace of C_HS; returns 1 if a matrix to invert is singular.
+ *------------------------------------------------------------------------------ */
+int Texture::bound(double K0, double G0, double chs[6][6], double &tr)
+{
+  double Ks = 4./3.*G0, Gs = G0*(9.*K0 + 8.*G0)/(6.*K0 + 12.*G0);
+  double cs[6][6], a[6][6], b[6][6];
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) cs[i][j] = (i == j ? 2.*Gs : 0.) + (i < 3 && j < 3 ? Ks - 2./3.*Gs : 0.);
+
+  // the reference is isotropic, so (Q C Q^T + C*)^-1 = Q (C + C*)^-1 Q^T
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) a[i][j] = C[i][j] + cs[i][j];
+  if (elastic->invert(a, b)) return 1;
+  average(b, a);
+  if (elastic->invert(a, b)) return 1;
+
+  tr = 0.;
+  for (int i = 0; i < 6; ++i){
+    for (int j = 0; j < 6; ++j) chs[i][j] = b[i][j] - cs[i][j];
+    tr += chs[i][i];
+  }
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to find the Hashin-Shtrikman lower (upper = 0) or upper (1) bound.
+ * With h = (1,1,1,0,0,0)/sqrt(3), C0 = 2G0 I + (3K0 - 2G0) h h^T, and the
+ * admissible G0 are set by the eigenvalues of the deviatoric block of C,
+ * i.e., C restricted to the complement of h: 2G0 below the smallest for the
+ * lower bound, above the largest for the upper one. For each G0, the K0
+ * closest to the crystal follows from the Schur complement on h:
+ *   lower:  3K0 = 2G0 + 1/(h^T (C - 2G0 I)^-1 h);
+ *   upper:  3K0 = 2G0 - 1/(h^T (2G0 I - C)^-1 h).
+ * G0 is then scanned over NSCAN values for the tightest bound, i.e., the
+ * largest (sgn = 1) or smallest (sgn = -1) trace; out is in Voigt notation.
+ *------------------------------------------------------------------------------ */
+void Texture::hashin(int upper, double sgn, double out[6][6])
+{
+  double best = -1.e30, chs[6][6], a[6][6], b[6][6];
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) out[i][j] = 0.;
+
+  // deviatoric block, with h shifted away from the end of the spectrum wanted
+  double big = 0., P[6][6];
+  for (int i = 0; i < 6; ++i) big += 10.*fabs(C[i][i]);
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) P[i][j] = (i == j ? 1. : 0.) - (i < 3 && j < 3 ? 1./3. : 0.);
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j){
+    a[i][j] = (i < 3 && j < 3 ? sgn*big/3. : 0.);
+    for (int k = 0; k < 6; ++k)
+    for (int l = 0; l < 6; ++l) a[i][j] += P[i][k] * C[k][l] * P[l][j];
+  }
+  double lam = eigen(a, upper);
+
+  for (int k = 1; k < NSCAN; ++k){
+    double G0 = upper ? 0.5*lam*double(NSCAN)/double(k) : 0.5*lam*double(k)/double(NSCAN);
+    for (int i = 0; i < 6; ++i)
+    for (int j = 0; j < 6; ++j) a[i][j] = sgn * (C[i][j] - (i == j ? 2.*G0 : 0.));
+    if (elastic->invert(a, b)) continue;
+
+    double x = 0.;
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) x += b[i][j]/3.;
+    if (fabs(x) < ZERO) continue;
+    double K0 = (2.*G0 + sgn/x)/3.;
+    if (K0 < ZERO) continue;
+
+    double tr;
+    if (bound(K0, G0, chs, tr)) continue;
+    tr *= sgn;
+    if (tr > best){
+      best = tr;
+      ref[upper][0] = K0; ref[upper][1] = G0;
+      mandel(chs, out, -1);
+    }
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the smallest (which = 0) or largest (1) eigenvalue of a real
+ * symmetric 6x6 matrix by the cyclic Jacobi method
+ *------------------------------------------------------------------------------ */
+double Texture::eigen(double A[6][6], int which)
+{
+  double a[6][6];
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j) a[i][j] = A[i][j];
+
+  for (int sweep = 0; sweep < 50; ++sweep){
+    double off = 0., diag = 0.;
+    for (int i = 0; i < 6; ++i){
+      diag += a[i][i]*a[i][i];
+      for (int j = i+1; j < 6; ++j) off += a[i][j]*a[i][j];
+    }
+    if (off < ZERO*ZERO*diag) break;
+
+    for (int p = 0; p < 6; ++p)
+    for (int q = p+1; q < 6; ++q){
+      if (fabs(a[p][q]) < ZERO*ZERO) continue;
+      double theta = 0.5*(a[q][q] - a[p][p])/a[p][q];
+      double t = (theta >= 0. ? 1. : -1.)/(fabs(theta) + sqrt(theta*theta + 1.));
+      double c = 1./sqrt(t*t + 1.), s = t*c;
+      for (int k = 0; k < 6; ++k){
+        double akp = a[k][p], akq = a[k][q];
+        a[k][p] = c*akp - s*akq;
+        a[k][q] = s*akp + c*akq;
+      }
+      for (int k = 0; k < 6; ++k){
+        double apk = a[p][k], aqk = a[q][k];
+        a[p][k] = c*apk - s*aqk;
+        a[q][k] = s*apk + c*aqk;
+      }
+    }
+  }
+
+  double ev = a[0][0];
+  for (int i = 1; i < 6; ++i){
+    if (which == 0 && a[i][i] < ev) ev = a[i][i];
+    if (which == 1 && a[i][i] > ev) ev = a[i][i];
+  }
+
+return ev;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to convert between Voigt and Mandel notations: a stiffness from
+ * Voigt to Mandel (dir = 1), or a compliance from Mandel to Voigt, is scaled
+ * by f_I f_J, with f = sqrt(2) for the shear components; by 1/(f_I f_J) for
+ * the reverse (dir = -1).
+ *------------------------------------------------------------------------------ */
+void Texture::mandel(double in[6][6], double out[6][6], int dir)
+{
+  for (int i = 0; i < 6; ++i)
+  for (int j = 0; j < 6; ++j){
+    double s = (i < 3 ? 1. : M_SQRT2) * (j < 3 ? 1. : M_SQRT2);
+    out[i][j] = dir > 0 ? in[i][j] * s : in[i][j] / s;
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the textured estimates to file
+ *------------------------------------------------------------------------------ */
+int Texture::write(const char *fname)
+{
+  FILE *fp = fopen(fname, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return 1;
+  }
+  output(fp);
+  fclose(fp);
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to report the textured stiffness matrices in the sample frame, and
+ * the engineering moduli along the sample axes derived from each
+ *------------------------------------------------------------------------------ */
+void Texture::output(FILE *fp)
+{
+  const char *name[5] = {"Voigt", "Reuss", "Hill", "HS lower", "HS upper"};
+  double (*est[5])[6] = {CV, CR, CH, CL, CU};
+
+  fprintf(fp, "# Textured elastic constants from %ld orientations, total weight %g, in the\n", ngrain, wsum);
+  fprintf(fp, "# sample frame (GPa); time used: %g seconds\n", twall);
+  for (int m = 0; m < 5; ++m){
+    if (m < 3) fprintf(fp, "# %s:\n", name[m]);
+    else fprintf(fp, "# Hashin-Shtrikman %s bound, reference K0 = %g, G0 = %g:\n", m == 3 ? "lower" : "upper",
+      ref[m-3][0], ref[m-3][1]);
+    for (int i = 0; i < 6; ++i){
+      for (int j = 0; j < 6; ++j) fprintf(fp, " %10.2f", est[m][i][j]);
+      fprintf(fp, "\n");
+    }
+  }
+
+  fprintf(fp, "# Engineering moduli along the sample axes (GPa):\n");
+  fprintf(fp, "#   %-10s %9s %9s %9s %9s %9s %9s %9s\n", "estimate", "E1", "E2", "E3", "G23", "G13", "G12", "K");
+  for (int m = 0; m < 5; ++m){
+    double s[6][6];
+    if (elastic->invert(est[m], s)) continue;
+    double k = 0.;
+    for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) k += s[i][j];
+    fprintf(fp, "#   %-10s", name[m]);
+    for (int i = 0; i < 6; ++i) fprintf(fp, " %9.3f", 1./s[i][i]);
+    fprintf(fp, " %9.3f\n", 1./k);
+  }
+
+return;
+}
+
+/*----------------------------------------------------------------------------*/
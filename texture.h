@@ -0,0 +1,45 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include "memory.h"
+#include "elastic.h"
+#include "stdio.h"
+
+#define NPAIR 21
+
+using namespace std;
+
+class Texture {
+public:
+  Texture(Elastic *);
+  ~Texture();
+
+  int compute(const char *);    // average over the orientations in file
+  int write(const char *);      // write the textured estimates to file
+  void output(FILE *);          // report the textured estimates
+
+  double CV[6][6], CR[6][6], CH[6][6]; // textured Voigt, Reuss and Hill estimates, Voigt notation (GPa)
+  double CL[6][6], CU[6][6];    // lower and upper Hashin-Shtrikman bounds
+  double ref[2][2];             // (K0, G0) of the reference media of the lower and upper bounds
+  long ngrain;                  // number of orientations read
+  double wsum;                  // sum of their weights
+
+private:
+  Memory *memory;
+  Elastic *elastic;
+
+  int ip[NPAIR], jp[NPAIR];     // index pairs (i <= j) of the symmetric 6x6 Mandel matrices
+  double V[NPAIR][NPAIR];       // orientation average as a linear map on the pairs, <Q T Q^T> = V T
+  double C[6][6], S[6][6];      // single crystal stiffness and compliance, Mandel notation
+  double twall;
+
+  int read(FILE *, char *, int *);
+  void parse(int, const char *, double **, double *, int);
+  void kernel(int, int, double **, double *, double *);
+  void average(double [6][6], double [6][6]);
+  int bound(double, double, double [6][6], double &);
+  void hashin(int, double, double [6][6]);
+  double eigen(double [6][6], int);
+  void mandel(double [6][6], double [6][6], int);
+};
+#endif
@@ -0,0 +1,374 @@
+#include "toec.h"
+#include "zfile.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#define ZERO 1.e-10
+#define MAXLINE 1024
+#define SEP " \n\t\r\f"
+
+/*------------------------------------------------------------------------------
+ * Constructor of Toec, to fit the second and third order elastic constants to
+ * the stresses of finitely strained states. In Voigt notation, with the
+ * Lagrangian strain eta = (F^T F - I)/2 (engineering shear) and the second
+ * Piola-Kirchhoff stress tau = J F^-1 sigma F^-T, one has
+ *   tau_i = tau0_i + C_ij eta_j + 1/2 C_ijk eta_j eta_k
+ * where C_ij and C_ijk are the (Brugger) thermodynamic constants, fully
+ * symmetric in their indices: 6 + 21 + 56 parameters.
+ *------------------------------------------------------------------------------ */
+Toec::Toec()
+{
+  memory = new Memory();
+  F = p = NULL;
+  R = NULL;
+  nstate = nmax = nrot = ndof = 0;
+  rms = 0.;
+
+  int n = 0;
+  for (int i = 0; i < 6; ++i)
+  for (int j = i; j < 6; ++j)
+  for (int k = j; k < 6; ++k){
+    c3index[i][j][k] = c3index[i][k][j] = c3index[j][i][k] = n;
+    c3index[j][k][i] = c3index[k][i][j] = c3index[k][j][i] = n;
+    ++n;
+  }
+
+  for (int i = 0; i < 6; ++i){
+    tau0[i] = 0.;
+    for (int j = 0; j < 6; ++j){
+      C2[i][j] = dC2[i][j] = 0.;
+      for (int k = 0; k < 6; ++k) C3[i][j][k] = dC3[i][j][k] = 0.;
+    }
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, free memory
+ *------------------------------------------------------------------------------ */
+Toec::~Toec()
+{
+  if (F) memory->destroy(F);
+  if (p) memory->destroy(p);
+  if (R) delete []R;
+  delete memory;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to read the states from the stress.dat written by the script, each
+ * line of which reads:
+ *   label F11 F12 F13 F21 F22 F23 F31 F32 F33 pxx pyy pzz pxy pxz pyz [energy]
+ * with F the deformation gradient of the state with respect to the reference
+ * one and p the stresses (kB) as in OUTCAR, positive for compression.
+ *------------------------------------------------------------------------------ */
+int Toec::read(const char *fname)
+{
+  char str[MAXLINE], *save;
+  ZFile zf;
+  FILE *fp = zf.open(fname);
+  if (fp == NULL){
+    printf("\nFile %s not found!\n", fname);
+    return 1;
+  }
+
+  double val[15];
+  while (fgets(str, MAXLINE, fp)){
+    char *ptr = strtok_r(str, SEP, &save);
+    if (ptr == NULL || ptr[0] == '#') continue;
+
+    int n = 0;
+    while (n < 15 && (ptr = strtok_r(NULL, SEP, &save))) val[n++] = atof(ptr);
+    if (n < 15) continue;
+
+    if (nstate >= nmax){
+      nmax += 64;
+      memory->grow(F, nmax, 9, "F");
+      memory->grow(p, nmax, 6, "p");
+    }
+    for (int i = 0; i < 9; ++i) F[nstate][i] = val[i];
+    for (int i = 0; i < 6; ++i) p[nstate][i] = val[9+i];
+    ++nstate;
+  }
+  if (zf.close()) return 2;
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to set the Cartesian rotations of the point group; each state is
+ * then used together with its images, which are exact by symmetry.
+ *------------------------------------------------------------------------------ */
+void Toec::symmetry(int n, double rot[][3][3])
+{
+  if (R) delete []R;
+  nrot = n;
+  R = new double [nrot][3][3];
+  for (int ir = 0; ir < nrot; ++ir)
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j) R[ir][i][j] = rot[ir][i][j];
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to get the Lagrangian strain and the PK2 stress (GPa), both as 3x3
+ * row major, from the deformation gradient and the stresses (kB) of a state
+ *------------------------------------------------------------------------------ */
+void Toec::lagrange(double *f, double *pk, double *eta, double *tau)
+{
+  double sig[9];
+  sig[0] = -0.1*pk[0]; sig[4] = -0.1*pk[1]; sig[8] = -0.1*pk[2];
+  sig[1] = sig[3] = -0.1*pk[3];
+  sig[2] = sig[6] = -0.1*pk[4];
+  sig[5] = sig[7] = -0.1*pk[5];
+
+  double inv[9];
+  inv[0] = f[4]*f[8] - f[5]*f[7];
+  inv[1] = f[2]*f[7] - f[1]*f[8];
+  inv[2] = f[1]*f[5] - f[2]*f[4];
+  inv[3] = f[5]*f[6] - f[3]*f[8];
+  inv[4] = f[0]*f[8] - f[2]*f[6];
+  inv[5] = f[2]*f[3] - f[0]*f[5];
+  inv[6] = f[3]*f[7] - f[4]*f[6];
+  inv[7] = f[1]*f[6] - f[0]*f[7];
+  inv[8] = f[0]*f[4] - f[1]*f[3];
+  double J = f[0]*inv[0] + f[1]*inv[3] + f[2]*inv[6];
+  for (int i = 0; i < 9; ++i) inv[i] /= J;
+
+  for (int i = 0; i < 3; ++i)
+  for (int j = 0; j < 3; ++j){
+    double t = 0., e = 0.;
+    for (int k = 0; k < 3; ++k){
+      e += f[k*3+i] * f[k*3+j];
+      for (int l = 0; l < 3; ++l) t += inv[i*3+k] * sig[k*3+l] * inv[j*3+l];
+    }
+    eta[i*3+j] = 0.5*(e - double(i == j));
+    tau[i*3+j] = J * t;
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to set the 6 rows of the design matrix for Voigt strain e
+ *------------------------------------------------------------------------------ */
+void Toec::design(double *e, double **A)
+{
+  for (int i = 0; i < 6; ++i){
+    for (int k = 0; k < NPAR; ++k) A[i][k] = 0.;
+    A[i][i] = 1.;
+
+    for (int j = 0; j < 6; ++j){
+      int a = i < j ? i : j, b = i < j ? j : i;
+      A[i][6 + a*6 - a*(a-1)/2 + b - a] += e[j];
+      for (int k = 0; k < 6; ++k) A[i][6 + NC2 + c3index[i][j][k]] += 0.5 * e[j] * e[k];
+    }
+  }
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to fit tau0, C2 and C3 to all states and their symmetry images by
+ * least squares, via the column scaled normal equations. The errors are those
+ * of the parameters estimated from the residual, with the images counted as
+ * the same measurement.
+ *------------------------------------------------------------------------------ */
+int Toec::fit()
+{
+  if (nstate*6 < NPAR){
+    printf("\nERROR: %d states are not enough to fit %d parameters!\n", nstate, NPAR);
+    return 1;
+  }
+  if (nrot < 1){
+    double I[1][3][3] = {{{1.,0.,0.},{0.,1.,0.},{0.,0.,1.}}};
+    symmetry(1, I);
+  }
+
+  double **N, **A, **data, b[NPAR], x[NPAR];
+  memory->create(N, NPAR, NPAR, "N");
+  memory->create(A, 6, NPAR, "A");
+  memory->create(data, nstate*nrot, 12, "data");
+  for (int k = 0; k < NPAR; ++k){
+    b[k] = 0.;
+    for (int l = 0; l < NPAR; ++l) N[k][l] = 0.;
+  }
+
+  // strains and stresses of all states and images, in Voigt notation
+  int nd = 0;
+  for (int is = 0; is < nstate; ++is){
+    double eta[9], tau[9];
+    lagrange(F[is], p[is], eta, tau);
+
+    for (int ir = 0; ir < nrot; ++ir){
+      double e[9], t[9];
+      for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 3; ++j){
+        e[i*3+j] = t[i*3+j] = 0.;
+        for (int k = 0; k < 3; ++k)
+        for (int l = 0; l < 3; ++l){
+          e[i*3+j] += R[ir][i][k] * eta[k*3+l] * R[ir][j][l];
+          t[i*3+j] += R[ir][i][k] * tau[k*3+l] * R[ir][j][l];
+        }
+      }
+      double *d = data[nd++];
+      d[0] = e[0]; d[1] = e[4]; d[2] = e[8]; d[3] = 2.*e[5]; d[4] = 2.*e[2]; d[5] = 2.*e[1];
+      d[6] = t[0]; d[7] = t[4]; d[8] = t[8]; d[9] = t[5];    d[10] = t[2];   d[11] = t[1];
+    }
+  }
+
+  for (int id = 0; id < nd; ++id){
+    design(data[id], A);
+    for (int i = 0; i < 6; ++i)
+    for (int k = 0; k < NPAR; ++k){
+      if (A[i][k] == 0.) continue;
+      b[k] += A[i][k] * data[id][6+i];
+      for (int l = 0; l < NPAR; ++l) N[k][l] += A[i][k] * A[i][l];
+    }
+  }
+
+  double s[NPAR];
+  for (int k = 0; k < NPAR; ++k) s[k] = N[k][k] > 0. ? 1./sqrt(N[k][k]) : 1.;
+  for (int k = 0; k < NPAR; ++k){
+    b[k] *= s[k];
+    for (int l = 0; l < NPAR; ++l) N[k][l] *= s[k]*s[l];
+  }
+  int flag = solve(N, b, x, NPAR);
+  if (flag){
+    printf("\nERROR: the strain states do not determine all elastic constants!\n");
+
+  } else {
+    for (int k = 0; k < NPAR; ++k) x[k] *= s[k];
+
+    double ssr = 0.;
+    for (int id = 0; id < nd; ++id){
+      design(data[id], A);
+      for (int i = 0; i < 6; ++i){
+        double r = data[id][6+i];
+        for (int k = 0; k < NPAR; ++k) r -= A[i][k] * x[k];
+        ssr += r*r;
+      }
+    }
+    rms = sqrt(ssr/double(nd*6));
+    ndof = nstate*6 - NPAR;
+    double var = ndof > 0 ? ssr/double(ndof) : 0.;
+
+    double dx[NPAR];
+    for (int k = 0; k < NPAR; ++k) dx[k] = sqrt(var * N[k][k]) * s[k];
+
+    for (int i = 0; i < 6; ++i) tau0[i] = x[i];
+    int k = 6;
+    for (int i = 0; i < 6; ++i)
+    for (int j = i; j < 6; ++j){
+      C2[i][j] = C2[j][i] = x[k];
+      dC2[i][j] = dC2[j][i] = dx[k];
+      ++k;
+    }
+    for (int i = 0; i < 6; ++i)
+    for (int j = 0; j < 6; ++j)
+    for (int l = 0; l < 6; ++l){
+      C3[i][j][l] = x[6 + NC2 + c3index[i][j][l]];
+      dC3[i][j][l] = dx[6 + NC2 + c3index[i][j][l]];
+    }
+  }
+
+  memory->destroy(N);
+  memory->destroy(A);
+  memory->destroy(data);
+
+return flag;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to solve a x = b by Gauss-Jordan elimination with partial pivoting;
+ * a is replaced by its inverse. Returns 1 if a is singular.
+ *------------------------------------------------------------------------------ */
+int Toec::solve(double **a, double *b, double *x, int n)
+{
+  int *piv = new int [n];
+  for (int i = 0; i < n; ++i) x[i] = b[i];
+
+  for (int k = 0; k < n; ++k){
+    int ip = k;
+    for (int i = k+1; i < n; ++i) if (fabs(a[i][k]) > fabs(a[ip][k])) ip = i;
+    if (fabs(a[ip][k]) < ZERO){
+      delete []piv;
+      return 1;
+    }
+    piv[k] = ip;
+    if (ip != k){
+      for (int j = 0; j < n; ++j){
+        double t = a[k][j]; a[k][j] = a[ip][j]; a[ip][j] = t;
+      }
+      double t = x[k]; x[k] = x[ip]; x[ip] = t;
+    }
+
+    double r = 1./a[k][k];
+    a[k][k] = 1.;
+    for (int j = 0; j < n; ++j) a[k][j] *= r;
+    x[k] *= r;
+
+    for (int i = 0; i < n; ++i){
+      if (i == k) continue;
+      double f = a[i][k];
+      a[i][k] = 0.;
+      for (int j = 0; j < n; ++j) a[i][j] -= f * a[k][j];
+      x[i] -= f * x[k];
+    }
+  }
+
+  // undo the row interchanges on the columns of the inverse
+  for (int k = n-1; k >= 0; --k){
+    if (piv[k] == k) continue;
+    for (int i = 0; i < n; ++i){
+      double t = a[i][k]; a[i][k] = a[i][piv[k]]; a[i][piv[k]] = t;
+    }
+  }
+  delete []piv;
+
+return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to report the fitted constants
+ *------------------------------------------------------------------------------ */
+void Toec::output(FILE *fp)
+{
+  fprintf(fp, "# Elastic constants fitted to %d states, each with %d symmetry images\n", nstate, nrot);
+  fprintf(fp, "# Residual of the fit: %g GPa; degrees of freedom: %d\n", rms, ndof);
+  fprintf(fp, "# PK2 stress of the reference state (GPa):");
+  for (int i = 0; i < 6; ++i) fprintf(fp, " %g", tau0[i]);
+  fprintf(fp, "\n# Second order elastic constants (GPa):\n");
+  for (int i = 0; i < 6; ++i){
+    for (int j = 0; j < 6; ++j) fprintf(fp, " %10.2f", C2[i][j]);
+    fprintf(fp, "\n");
+  }
+  fprintf(fp, "# Third order elastic constants (GPa), ijk, Cijk, error:\n");
+  for (int i = 0; i < 6; ++i)
+  for (int j = i; j < 6; ++j)
+  for (int k = j; k < 6; ++k) fprintf(fp, "  C%d%d%d %12.2f %10.2f\n", i+1, j+1, k+1, C3[i][j][k], dC3[i][j][k]);
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to write the report to file
+ *------------------------------------------------------------------------------ */
+int Toec::write(const char *fname)
+{
+  FILE *fp = fopen(fname, "w");
+  if (fp == NULL){
+    printf("\nERROR: cannot open file %s for writting!\n", fname);
+    return 1;
+  }
+  output(fp);
+  fclose(fp);
+
+return 0;
+}
+
+/*----------------------------------------------------------------------------*/
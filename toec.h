@@ -0,0 +1,41 @@
+#ifndef TOEC_H
+#define TOEC_H
+
+#include "memory.h"
+
+#define NC2 21
+#define NC3 56
+#define NPAR (6+NC2+NC3)
+
+using namespace std;
+
+class Toec {
+public:
+  Toec();
+  ~Toec();
+
+  int read(const char *);       // read the deformation gradients and stresses
+  void symmetry(int, double [][3][3]); // Cartesian rotations to augment the data
+  int fit();                    // least squares fit of tau0, C2 and C3
+  void output(FILE *);
+  int write(const char *);
+
+  double tau0[6];               // PK2 stress of the reference state (GPa)
+  double C2[6][6], dC2[6][6];   // second-order elastic constants and their errors (GPa)
+  double C3[6][6][6], dC3[6][6][6]; // third-order ones
+
+  int nstate, nrot, ndof;
+  double rms;                   // residual of the fit (GPa)
+
+private:
+  Memory *memory;
+  int nmax;
+  double **F, **p;              // deformation gradient (row major) and stress (kB, info.dat order) of each state
+  double (*R)[3][3];
+
+  int c3index[6][6][6];
+  void lagrange(double *, double *, double *, double *);
+  void design(double *, double **);
+  int solve(double **, double *, double *, int);
+};
+#endif
@@ -0,0 +1,109 @@
+#include "zfile.h"
+#include "stdlib.h"
+#include "string.h"
+#include <signal.h>
+#include <sys/wait.h>
+
+#define MAXLINE 1024
+
+/*------------------------------------------------------------------------------
+ * Constructor of ZFile, a reader that handles plain files as well as those
+ * compressed by gzip (.gz), zstd (.zst), bzip2 (.bz2) or xz (.xz); compressed
+ * ones are decompressed on the fly through a pipe, so they are never inflated
+ * on disk or in memory.
+ *------------------------------------------------------------------------------ */
+ZFile::ZFile()
+{
+  fp = NULL;
+  ispipe = 0;
+  name = NULL;
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Deconstructor, close the file if still open
+ *------------------------------------------------------------------------------ */
+ZFile::~ZFile()
+{
+  close();
+
+return;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to open file fname for reading; returns NULL on failure
+ *------------------------------------------------------------------------------ */
+FILE *ZFile::open(const char *fname)
+{
+  close();
+
+  // make sure the file exists, as popen would not tell
+  FILE *test = fopen(fname, "r");
+  if (test == NULL) return NULL;
+  name = new char [strlen(fname)+1];
+  strcpy(name, fname);
+
+  static const char *ext[] = {".gz", ".zst", ".bz2", ".xz"};
+  static const char *cmd[] = {"gzip -dc", "zstd -dcq", "bzip2 -dc", "xz -dc"};
+  const char *tool = NULL;
+  int n = strlen(fname);
+  for (int i = 0; i < 4; ++i){
+    int m = strlen(ext[i]);
+    if (n > m && strcmp(fname + n - m, ext[i]) == 0){ tool = cmd[i]; break; }
+  }
+  if (tool == NULL){
+    fp = test;
+    ispipe = 0;
+    return fp;
+  }
+  fclose(test);
+
+  // the name is single quoted for the shell, each ' in it as '\''
+  char str[4*MAXLINE+64];
+  int len = snprintf(str, sizeof(str), "%s '", tool);
+  for (const char *p = fname; *p && len < int(sizeof(str)) - 8; ++p){
+    if (*p == '\''){
+      strcpy(str + len, "'\\''");
+      len += 4;
+    } else str[len++] = *p;
+  }
+  if (len >= int(sizeof(str)) - 8){
+    close();
+    return NULL;
+  }
+  strcpy(str + len, "'");
+  fp = popen(str, "r");
+  ispipe = 1;
+  if (fp == NULL) close();
+
+return fp;
+}
+
+/*------------------------------------------------------------------------------
+ * Method to close the file; for a compressed one, the exit status of the
+ * decompressor is checked, so that a truncated or corrupt file, or a missing
+ * tool, is not taken for a short one. A decompressor stopped by SIGPIPE only
+ * means the caller did not read to the end. Returns 1 if it failed, else 0.
+ *------------------------------------------------------------------------------ */
+int ZFile::close()
+{
+  int flag = 0;
+  if (fp){
+    if (ispipe){
+      int st = pclose(fp);
+      if (st == -1 || (WIFEXITED(st) && WEXITSTATUS(st) != 0) || (WIFSIGNALED(st) && WTERMSIG(st) != SIGPIPE)){
+        printf("\nERROR: failed to decompress %s!\n", name);
+        flag = 1;
+      }
+    } else fclose(fp);
+  }
+  fp = NULL;
+  ispipe = 0;
+  if (name) delete []name;
+  name = NULL;
+
+return flag;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,21 @@
+#ifndef ZFILE_H
+#define ZFILE_H
+
+#include "stdio.h"
+
+using namespace std;
+
+class ZFile {
+public:
+  ZFile();
+  ~ZFile();
+
+  FILE *open(const char *);     // open for reading, decompress on the fly if needed
+  int close();                  // close; 1 if the decompression failed
+
+private:
+  FILE *fp;
+  int ispipe;
+  char *name;                   // name of the file open
+};
+#endif